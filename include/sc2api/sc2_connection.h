@@ -7,39 +7,108 @@
 #include <string>
 #include <mutex>
 #include <condition_variable>
-#include <deque>
 #include <functional>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 #include <ixwebsocket/IXWebSocket.h>
 
+#include "sc2utils/spsc_queue.h"
+#include "sc2api/sc2_protocol_recorder.h"
+
 namespace SC2APIProtocol
 {
     class Request;
     class Response;
 }
 
+namespace google::protobuf
+{
+    class Arena;
+}
+
 namespace sc2
 {
+    //! Recycles the memory incoming responses are parsed into. Every response is allocated on its own protobuf arena
+    //! backed by a retained block, once the last reference to a response is released its arena is reset and handed
+    //! out again. In steady state parsing a response, however many units it carries, does not touch the heap.
+    class ResponsePool : public std::enable_shared_from_this<ResponsePool>
+    {
+    public:
+        //! Allocation counters, mostly useful to verify the pool is doing its job.
+        struct Stats
+        {
+            uint64_t responses = 0; //!< Number of responses handed out.
+            uint64_t arenas_created = 0; //!< Number of arenas created, each one allocates its initial block.
+            uint64_t blocks_grown = 0; //!< Number of times a retained block was too small and had to be reallocated.
+            uint64_t bytes_retained = 0; //!< Memory currently held by the pool, in use or not.
+        };
+
+        ResponsePool();
+
+        ~ResponsePool();
+
+        //! Returns an empty response allocated on a pooled arena. Thread safe.
+        SC2APIProtocol::Response *Acquire();
+
+        //! Returns the arena of a response obtained from Acquire to the pool. Thread safe.
+        //! \param response The response to release, it must not be used afterwards.
+        void Release(const SC2APIProtocol::Response *response);
+
+        //! Wraps a response obtained from Acquire in a shared pointer that releases it back to the pool when the last
+        //! reference is gone. The pool is kept alive for as long as any such pointer exists.
+        std::shared_ptr<const SC2APIProtocol::Response> MakeShared(SC2APIProtocol::Response *response);
+
+        Stats GetStats() const;
+
+    private:
+        struct Slot;
+
+        std::unique_ptr<Slot> CreateSlot(std::size_t block_size);
+
+        mutable std::mutex mutex_;
+        std::unordered_map<const google::protobuf::Arena *, std::unique_ptr<Slot>> slots_; //!< All arenas owned by the pool.
+        std::vector<Slot *> free_; //!< Arenas that are ready to be reused.
+        Stats stats_;
+    };
+
     // TODO: honestly would probably be better named as Client
     //! This class acts as a wrapper around a websocket connection and queue responsible for both sending
     //! out and receiving protobuf messages.
     class Connection
     {
     public:
+        //! Measurements the websocket thread takes for every response it receives.
+        struct ReceiveInfo
+        {
+            std::size_t bytes = 0; //!< Serialized size of the response.
+            std::chrono::steady_clock::time_point received; //!< When the response came off the socket.
+            std::chrono::microseconds parse_time{0}; //!< Time spent parsing the response.
+        };
+
         Connection();
 
         ~Connection();
 
-        //! Connects via websocket on a given address/port.
+        //! Connects via websocket on a given address/port. Blocks until the websocket reports the connection as open
+        //! or failed, there is no polling involved so a successful connect returns as soon as the handshake completes.
         //!< \param address The address to connect to, will most commonly be used locally so 127.0.0.1.
         //!< \param port The port to connect the, the default for s2api is 9168 unless specified otherwise in settings.
         //!< \return Returns true if the connection was successful and false otherwise.
         bool Connect(const std::string &address, int port, bool verbose = true);
 
+        //! Time it took for the last successful call to Connect to establish the connection.
+        //!< \return The measured connect latency.
+        std::chrono::microseconds GetConnectLatency() const;
+
         //! Sends a request via the websocket connection. This function assumes Connect has been called and returned success.
         //! It will assert in debug if that's not the case and will early out in a build that doesn't have asserts built in.
-        //! This function also allocates a byte buffer to accommodate the request, it frees that buffer before returning.
+        //! The request is serialized into a buffer owned by the connection that only grows, so sending does not allocate
+        //! once the largest request has been seen. Must only be called from one thread at a time.
         //!< \param request A pointer to the Request object.
         void Send(const SC2APIProtocol::Request *request);
 
@@ -51,8 +120,12 @@ namespace sc2
         //! \return Returns true if a message is received, false otherwise.
         bool Receive(SC2APIProtocol::Response *&response, unsigned int timeout_ms);
 
+        //! Measurements for the response last returned by Receive or PopResponse.
+        const ReceiveInfo &GetLastReceiveInfo() const;
+
         //! PopResponse is called in the Receive function when a message has been received off of the civetweb thread. Alternatively
-        //! you could poll for responses with PollResponse and consume the message manually with this function.
+        //! you could poll for responses with PollResponse and consume the message manually with this function. Must only
+        //! be called from the thread that calls Receive, response is set to null if the queue is empty.
         //! \param response The response pointer to be filled out.
         void PopResponse(SC2APIProtocol::Response *&response);
 
@@ -73,24 +146,67 @@ namespace sc2
         //!< \return true if there is a response in the queue, false otherwise.
         bool PollResponse();
 
-        //! PushResponse is called by a civetweb thread when it receives a message off the socket. Pushing a response triggers
-        //! a condition and enqueues a message. The condition will cause anyone currently blocking for a response (if Receive is called)
-        //! to wake up and be able to consume that message.
+        //! PushResponse is called by the websocket thread when it receives a message off the socket. The response is placed
+        //! in a lock-free ring, anyone currently blocking in Receive is woken up to consume it. Must only be called from the
+        //! websocket thread.
         //! \param response A pointer to the Response to queue.
-        void PushResponse(SC2APIProtocol::Response *&response);
+        //! \param info Measurements taken while receiving the response.
+        void PushResponse(SC2APIProtocol::Response *&response, const ReceiveInfo &info = ReceiveInfo());
+
+        //! The pool responses returned by Receive are allocated from. Received responses must be handed back through
+        //! ResponsePool::Release or ResponsePool::MakeShared.
+        const std::shared_ptr<ResponsePool> &GetResponsePool() const;
+
+        //! Starts capturing every request sent and response received to a protocol trace.
+        //!< \param path Where to write the trace.
+        //!< \return True if the trace file could be created.
+        //!< \sa ProtocolRecorder
+        bool StartRecording(const std::string &path);
+
+        //! Stops capturing and closes the trace.
+        void StopRecording();
+
+        bool IsRecording() const;
 
         ix::WebSocket connection; //!< A pointer to the civetweb connection object.
     private:
+        //! State of a connection attempt, updated from the websocket thread.
+        enum class ConnectState
+        {
+            Connecting,
+            Open,
+            Failed
+        };
+
+        void SetConnectState(ConnectState state);
+
         bool verbose_; //!< Will print extra information to console if enabled.
 
         std::function<void()> timeout_callback_; //!< Timeout callback.
         std::function<void()> connection_closed_callback_; //!< Timeout callback.
 
-        std::deque<SC2APIProtocol::Response *> queue_; //!< A queue that contains responses received off the socket.
-        std::mutex mutex_; //!< Mutex used in conjunction with the condition.
-        std::condition_variable condition_;
-        //!< A condition that is signaled when a message has been received off the socket.
-
-        std::atomic_bool has_response_; //!< Thread safe bool to check whether the queue is not empty.
+        struct QueuedResponse
+        {
+            SC2APIProtocol::Response *response = nullptr;
+            ReceiveInfo info;
+        };
+
+        //! Responses received off the socket. The websocket thread is the only producer and the thread calling Receive the
+        //! only consumer.
+        SpscQueue<QueuedResponse> queue_;
+        //! Set while the connection is being stopped, a websocket thread waiting for room in a full queue gives up and
+        //! drops its response instead of keeping the stop from joining it.
+        std::atomic_bool stopping_;
+        ReceiveInfo last_receive_info_; //!< Measurements for the response last handed out, only used by the consumer.
+
+        std::shared_ptr<ResponsePool> response_pool_; //!< Memory for the responses received off the socket.
+
+        std::vector<char> send_buffer_; //!< Serialized bytes of the last request sent, reused across sends.
+        ProtocolRecorder recorder_; //!< Captures traffic to disk while recording.
+
+        ConnectState connect_state_; //!< State of the current connection attempt.
+        std::mutex connect_mutex_; //!< Mutex used in conjunction with the connect condition.
+        std::condition_variable connect_condition_; //!< Signaled when a connection attempt has opened or failed.
+        std::chrono::microseconds connect_latency_; //!< Time taken by the last successful connect.
     };
 }
@@ -49,6 +49,9 @@ public:
     virtual bool HasResponsePending() const = 0;
 
     virtual bool GetObservation() = 0;
+    // Split version of GetObservation, PollResponse tells whether WaitObservation would block.
+    virtual bool RequestObservation() = 0;
+    virtual bool WaitObservation() = 0;
     virtual bool PollResponse() = 0;
     virtual bool ConsumeResponse() = 0;
 
@@ -69,6 +72,16 @@ public:
 
     virtual void UseGeneralizedAbility(bool value) = 0;
 
+    // Unit pool.
+    virtual void SetUnitRecycleDelay(uint32_t game_loops) = 0;
+    virtual UnitPoolStats GetUnitPoolStats() const = 0;
+    // Number of threads units are converted on, including the thread stepping the client. 1 converts sequentially.
+    virtual void SetConversionThreads(size_t threads) = 0;
+    // ConversionMask flags of the parts of an observation to convert.
+    virtual void SetConversionMask(uint32_t mask) = 0;
+    // Puts off converting units until they are asked for or a unit died, see Coordinator::SetLazyUnitConversion.
+    virtual void SetLazyUnitConversion(bool value) = 0;
+
     // Save/Load.
     virtual void Save() = 0;
     virtual void Load() = 0;
@@ -90,6 +90,26 @@ public:
     //! ability ids are generalized to BUILD_TECHLAB ability id in the observation.
     void SetUseGeneralizedAbilityId(bool value);
 
+    //! Reuses the memory of dead units, and of units that left the observation, once they have not been observed for
+    //! the given number of game loops. Pointers to a unit stay valid until then, so only set this if the bot does not
+    //! hold on to such units for longer. Unit::generation tells whether a kept pointer still refers to the same unit.
+    //! \param game_loops Game loops to keep a dead unit for, kNeverRecycleUnits (the default) keeps them forever.
+    void SetUnitRecycleDelay(uint32_t game_loops);
+
+    //! Converts the units of large observations on several threads. Each client gets its own threads.
+    //! \param threads Threads per client including the one stepping it, 1 (the default) converts on that thread only.
+    void SetConversionThreads(size_t threads);
+
+    //! Only converts the given parts of each observation, e.g. ConversionMask::All & ~ConversionMask::Buffs.
+    //! \param mask ConversionMask flags of the parts to convert, all of them by default.
+    void SetConversionMask(uint32_t mask);
+
+    //! Only converts the units of an observation once they are asked for through GetUnits, GetUnit or GetChangedUnits,
+    //! or when a unit died so OnUnitDestroyed can be called. Saves the conversion of every step for bots that look at
+    //! units every few steps. Unit events are computed against the last observation whose units were converted, so
+    //! they are issued in the step after the units were converted instead of the step the change happened in.
+    void SetLazyUnitConversion(bool value);
+
     //! Sets the replay perspective. Use 0 to observe all players.
     void SetReplayPerspective(int player_id);
 
@@ -293,4 +293,45 @@ struct Effect {
 
 AbilityID GetGeneralizedAbilityID(uint32_t ability_id, const ObservationInterface& observation);
 
+//! Maps every ability id to its generalized id, see AbilityData::remaps_to_ability_id. Built once from the ability data
+//! so generalizing an id is a single indexed load, without going through ObservationInterface::GetAbilityData.
+class AbilityRemapTable {
+public:
+    AbilityRemapTable() : remap_(1, 0) {}
+
+    //! Rebuilds the table from the ability data, ids the data does not cover are left as they are.
+    void Build(const Abilities& abilities);
+    //! Forgets every remap, Remap returns ids unchanged until the table is built again.
+    void Clear() { remap_.assign(1, 0); }
+    //! True if the table was built from ability data.
+    bool IsBuilt() const { return remap_.size() > 1; }
+
+    //! Generalized id of an ability, the same as GetGeneralizedAbilityID.
+    AbilityID Remap(uint32_t ability_id) const {
+        // Ids past the end look up entry 0, which always holds 0, and are then passed through.
+        bool known = ability_id < remap_.size();
+        uint32_t remapped = remap_[known ? ability_id : 0];
+        return AbilityID(known ? remapped : ability_id);
+    }
+
+    //! Generalizes every id of an array in place. The loop body has no branches, so compilers vectorize it where the
+    //! target has gather instructions.
+    //!< \param ability_ids The ids to generalize.
+    //!< \param count Number of ids.
+    void Remap(uint32_t* ability_ids, size_t count) const {
+        const uint32_t* remap = remap_.data();
+        const size_t size = remap_.size();
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t ability_id = ability_ids[i];
+            bool known = ability_id < size;
+            uint32_t remapped = remap[known ? ability_id : 0];
+            ability_ids[i] = known ? remapped : ability_id;
+        }
+    }
+
+private:
+    // Entry 0 is always present so out of range ids have something to load.
+    std::vector<uint32_t> remap_;
+};
+
 }
@@ -0,0 +1,120 @@
+/*! \file sc2_fake_game_server.h
+    \brief A stand-in for the game that answers API requests without running StarCraft II.
+
+The fake server listens like the game does, so a client attaches to it with Coordinator::Connect(port) and then starts a
+game as usual. Responses either come from a synthetic scenario or are replayed from a protocol trace captured with
+Connection::StartRecording. It is meant for benchmarks and tests of the client side: nothing is simulated beyond what
+is needed to keep a client stepping.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sc2api/sc2_server.h"
+
+namespace SC2APIProtocol
+{
+    class Request;
+    class RequestData;
+    class Response;
+}
+
+namespace sc2
+{
+    //! Describes the synthetic game a FakeGameServer answers with.
+    struct FakeGameScenario
+    {
+        int map_width = 176; //!< Map size in cells, the whole map is pathable and placeable.
+        int map_height = 176;
+        uint32_t unit_type = 48; //!< Type of every unit, a marine by default.
+        int self_units = 100; //!< Units owned by the player.
+        int enemy_units = 100; //!< Units owned by the opponent.
+        float unit_speed = 0.25f; //!< Distance each unit wanders per game loop, so consecutive observations differ.
+        uint32_t seed = 1; //!< Seed for the initial unit placement.
+        uint32_t base_build = 0; //!< Reported by ping, 0 is accepted by any client.
+        std::string data_version; //!< Reported by ping.
+    };
+
+    //! Answers API requests like the game would, from a scenario or a recorded trace.
+    class FakeGameServer
+    {
+    public:
+        FakeGameServer();
+
+        ~FakeGameServer();
+
+        FakeGameServer(const FakeGameServer &) = delete;
+
+        FakeGameServer &operator=(const FakeGameServer &) = delete;
+
+        //! Sets the synthetic game to answer with, takes effect the next time a game is created.
+        void SetScenario(const FakeGameScenario &scenario);
+
+        //! Answers with the responses of a protocol trace instead of the scenario. Each type of request is answered
+        //! with the recorded responses of the same type in recorded order, starting over once they run out. Requests
+        //! of a type the trace has no response for are answered from the scenario.
+        //!< \param path A trace written by ProtocolRecorder.
+        //!< \return True if the trace could be read.
+        bool LoadTrace(const std::string &path);
+
+        //! Starts listening and answering requests on a background thread.
+        //!< \param port Port to listen on.
+        bool Start(int port);
+
+        void Stop();
+
+        int GetPort() const;
+
+        //! Number of requests answered so far.
+        uint64_t GetRequestsServed() const;
+
+        //! Builds the answer to a request without going through the network, e.g. to benchmark the conversion of large
+        //! observations in isolation. Must not be called while the server is started. The caller owns the returned
+        //! response.
+        SC2APIProtocol::Response *Answer(const SC2APIProtocol::Request &request);
+
+    private:
+        struct FakeUnit
+        {
+            uint64_t tag;
+            int owner;
+            float x;
+            float y;
+            float heading;
+        };
+
+        void ServeThread();
+
+        bool AnswerFromTrace(int request_case, SC2APIProtocol::Response &response);
+
+        void ResetGame();
+
+        void FillGameInfo(SC2APIProtocol::Response &response) const;
+
+        void FillData(const SC2APIProtocol::RequestData &request, SC2APIProtocol::Response &response) const;
+
+        void FillObservation(SC2APIProtocol::Response &response) const;
+
+        void AdvanceUnits(uint32_t loops);
+
+        std::unique_ptr<Server> server_;
+        std::thread thread_;
+        std::atomic_bool running_;
+        std::atomic<uint64_t> requests_served_;
+
+        FakeGameScenario scenario_;
+        std::vector<FakeUnit> units_;
+        uint32_t game_loop_;
+        int status_; //!< SC2APIProtocol::Status reported with every response.
+
+        //! Recorded responses by response case and the next one to hand out for each.
+        std::vector<std::vector<std::string>> trace_responses_;
+        std::vector<std::size_t> trace_cursors_;
+    };
+}
@@ -0,0 +1,142 @@
+/*! \file sc2_flow_field.h
+    \brief Distances from every cell of the pathing grid to the nearest of a set of cells.
+
+A distance field answers "how far is the nearest X and which way is it" for every cell at once, so any number of units
+can walk towards our bases, the enemy army or an expansion by looking up their cell. Distances use the same moves as
+PathFinder: straight moves cost 1, diagonal moves cost sqrt(2) and may not cut the corner of a blocked cell.
+
+Fields are computed with chamfer sweeps. Each sweep relaxes a whole row from its neighbouring row four cells at a time,
+then along the row, and sweeps repeat until nothing changes. FlowFieldCache keeps the fields of the latest source sets
+and repairs them when structures are placed or destroyed instead of starting over.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "sc2api/sc2_common.h"
+#include "sc2api/sc2_unit.h"
+
+namespace sc2
+{
+    class TerrainGrids;
+
+    //! Distance from every cell to the nearest source cell, see FlowFieldCache::Get.
+    class DistanceField
+    {
+    public:
+        //! Distance of the cells no source can be reached from, and of blocked cells.
+        static constexpr float Unreachable = std::numeric_limits<float>::infinity();
+
+        DistanceField();
+
+        int Width() const;
+
+        int Height() const;
+
+        //! Cells the distances are measured to, sorted.
+        const std::vector<Point2DI> &Sources() const;
+
+        //! Distance from the cell to the nearest source.
+        float Distance(const Point2DI &cell) const;
+
+        //! Distance from the cell the point is in to the nearest source.
+        float Distance(const Point2D &point) const;
+
+        //! The neighbour to move to from the cell to get closer to the nearest source.
+        //!< \return False if the cell is a source, blocked or can't reach any source.
+        bool NextCell(const Point2DI &cell, Point2DI *next) const;
+
+        //! Unit vector pointing from the point towards the center of the next cell.
+        //!< \return (0, 0) if there is no next cell, see NextCell.
+        Point2D Direction(const Point2D &point) const;
+
+    private:
+        friend class FlowFieldCache;
+
+        int Index(int x, int y) const;
+
+        // Lowers distances until every cell is at most one move away from its neighbour's distance plus the move.
+        void Relax(const std::vector<float> &penalty);
+
+        bool SweepDown(const std::vector<float> &penalty);
+
+        bool SweepUp(const std::vector<float> &penalty);
+
+        int width_;
+        int height_;
+        //! Distances with a border of unreachable cells around the grid, row after row.
+        std::vector<float> distance_;
+        std::vector<Point2DI> sources_;
+    };
+
+    //! Computes distance fields over the pathing grid and the structures on it, keeping the most recently used ones.
+    class FlowFieldCache
+    {
+    public:
+        //!< \param capacity Number of fields kept, the least recently used one is dropped first.
+        explicit FlowFieldCache(size_t capacity = 8);
+
+        //! Uses the pathing grid of the terrain and drops every field.
+        void SetTerrain(const TerrainGrids &terrain);
+
+        //! Blocks the footprints of the structures among the units and unblocks those of the structures set before, see
+        //! BlocksPathing. Only the cells that changed are repaired in the cached fields, so calling it every step with
+        //! ObservationInterface::GetUnits() is cheap and is the way to keep the obstacles right: it picks up enemy
+        //! structures as they are seen, buildings that lift off or land, and supply depots that are lowered or raised,
+        //! none of which the client reports through OnUnitCreated or OnUnitDestroyed.
+        void SetObstacles(const Units &units);
+
+        //! Blocks the footprint of a structure in its current state, for bots that track structure changes themselves.
+        //! Does nothing for units that don't block pathing, e.g. a flying building or a lowered depot.
+        void AddObstacle(const Unit &unit);
+
+        //! Unblocks the footprint of a structure, also the cells it shares with another structure. A building that lifts
+        //! off or a depot that is lowered has to be removed with the footprint it had when it was added.
+        void RemoveObstacle(const Unit &unit);
+
+        //! True if a ground unit can stand in the cell, taking obstacles into account.
+        bool IsWalkable(const Point2DI &cell) const;
+
+        //! Distance field for a set of source cells, computed unless it is cached already. The order of the sources
+        //! doesn't matter, cells outside the grid or blocked are ignored.
+        //!< \return The field, valid until the next call to Get or SetTerrain.
+        const DistanceField &Get(const std::vector<Point2DI> &sources);
+
+        //! Number of cached fields.
+        size_t Size() const;
+
+        //! Drops every field.
+        void Clear();
+
+    private:
+        struct Entry
+        {
+            DistanceField field;
+            uint64_t last_used = 0;
+            // Fields are repaired lazily on their next Get. Cells at or beyond raise_from may have lost their shortest
+            // path to a new obstacle, relax is set once an obstacle is removed.
+            float raise_from = DistanceField::Unreachable;
+            bool relax = false;
+        };
+
+        void SetBlocked(int index, bool blocked);
+
+        void SetFootprint(const Unit &unit, bool blocked);
+
+        void Repair(DistanceField &field, float raise_from) const;
+
+        int width_;
+        int height_;
+        size_t capacity_;
+        uint64_t uses_;
+        std::vector<uint8_t> pathable_; //!< Terrain without structures, in the layout of the fields.
+        std::vector<uint8_t> obstacle_;
+        std::vector<float> penalty_; //!< 0 for walkable cells, Unreachable for the others.
+        std::vector<std::unique_ptr<Entry>> entries_;
+        std::vector<uint8_t> next_obstacle_;
+    };
+}
@@ -60,6 +60,24 @@ enum class ChatChannel {
     Team = 1
 };
 
+//! Parts of an observation a bot can opt out of converting, to save the time spent on data it never reads. Combine the
+//! flags of the parts to convert with |. Fields of a part that is left out stay zero or empty.
+namespace ConversionMask {
+    enum : uint32_t {
+        None = 0,
+        Passengers = 1u << 0,   //!< Unit::passengers, cargo_space_taken and cargo_space_max.
+        Buffs = 1u << 1,        //!< Unit::buffs.
+        Ranges = 1u << 2,       //!< Unit::detect_range and radar_range.
+        Upgrades = 1u << 3,     //!< Unit::attack_upgrade_level, armor_upgrade_level and shield_upgrade_level.
+        OnScreen = 1u << 4,     //!< Unit::is_on_screen.
+        Score = 1u << 5,        //!< ObservationInterface::GetScore.
+        Chat = 1u << 6,         //!< ObservationInterface::GetChatMessages.
+        Effects = 1u << 7,      //!< ObservationInterface::GetEffects.
+        PowerSources = 1u << 8, //!< ObservationInterface::GetPowerSources.
+        All = 0xFFFFFFFFu
+    };
+}
+
 class Agent;
 
 //! Setup for a player in a game.
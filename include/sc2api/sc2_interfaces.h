@@ -14,6 +14,8 @@ be of little concern to the consumer.
 #include "sc2api/sc2_data.h"
 
 #include <vector>
+#include <functional>
+#include <optional>
 
 // Forward declarations to avoid including proto headers everywhere.
 namespace SC2APIProtocol {
@@ -28,6 +30,8 @@ enum class ABILITY_ID;
 class ObservationInterface;
 struct Score;
 struct GameInfo;
+class TerrainGrids;
+class MapStateGrids;
 
 enum class Visibility {
     Hidden = 0,
@@ -78,6 +82,11 @@ public:
     //!< \return Pointer to the Unit object.
     virtual const Unit* GetUnit(Tag tag) const = 0;
 
+    //! Get the units that differ in any way from the previous observation, including units seen for the first time.
+    //! Use this to skip the many mineral fields and finished structures that stay the same from step to step.
+    //!< \return List of units whose last_changed_game_loop is the current game loop.
+    virtual Units GetChangedUnits() const = 0;
+
     //! Gets a list of actions performed as abilities applied to units. For use with the raw option.
     //!< \return List of raw actions.
     virtual const RawActions& GetRawActions() const = 0;
@@ -224,6 +233,19 @@ public:
     //!< \return Height.
     virtual float TerrainHeight(const Point2D& point) const = 0;
 
+    //! Returns the pathing, placement and height grids of the map, decoded once per game. Sampling them directly
+    // avoids a virtual call per cell, and they can test whole rectangles at once, e.g. when searching for a place
+    // to build. Like IsPathable and IsPlacable, they don't include structures or other blockers.
+    //!< \return Terrain grids.
+    virtual const TerrainGrids& GetTerrainGrids() const = 0;
+
+    //! Returns the creep and visibility of the current observation, decoded the first time they are asked for in a
+    // step, so bots that never look at them don't pay for it. Besides point lookups they count cells in rectangles,
+    // find the first cell along a segment that isn't visible, and list the cells that became visible since the
+    // previous observation whose grids were decoded.
+    //!< \return Creep and visibility grids.
+    virtual const MapStateGrids& GetMapStateGrids() const = 0;
+
     //! A pointer to the low-level protocol data for the current observation. While it's possible to extract most in-game data from this pointer
     // it is highly discouraged. It should only be used for extracting feature layers because it would be inefficient to copy these each frame.
     //!< \return A const pointer to the Observation.
@@ -232,10 +254,96 @@ public:
 
 };
 
+//! The result of a request that has been sent to the game but whose response may not have arrived yet. Issuing the
+//! request and collecting the result separately lets a bot do other work during the round trip to the game.
+//!
+//! Responses arrive in the order requests were sent. Get must be called before any other request is made, unless the
+//! client is pipelined, in which case results have to be collected in the order they were requested. A result that is
+//! dropped without calling Get gives up its response: it is read and thrown away as soon as it is next in line, at the
+//! latest when the next request is sent, so it never holds up the requests after it.
+template<typename T>
+class AsyncResult {
+public:
+    AsyncResult() = default;
+
+    //! \param is_ready Returns whether the response has been received.
+    //! \param wait Blocks until the response has been received and converts it to the result.
+    //! \param discard Gives up the response, called when the result is dropped before Get.
+    AsyncResult(std::function<bool()> is_ready, std::function<T()> wait, std::function<void()> discard = nullptr) :
+        is_ready_(std::move(is_ready)),
+        wait_(std::move(wait)),
+        discard_(std::move(discard)) {
+    }
+
+    AsyncResult(const AsyncResult&) = delete;
+    AsyncResult& operator=(const AsyncResult&) = delete;
+
+    AsyncResult(AsyncResult&& other) noexcept :
+        is_ready_(std::move(other.is_ready_)),
+        wait_(std::move(other.wait_)),
+        discard_(std::move(other.discard_)),
+        value_(std::move(other.value_)) {
+        other.wait_ = nullptr;
+        other.discard_ = nullptr;
+    }
+
+    AsyncResult& operator=(AsyncResult&& other) noexcept {
+        if (this != &other) {
+            Discard();
+            is_ready_ = std::move(other.is_ready_);
+            wait_ = std::move(other.wait_);
+            discard_ = std::move(other.discard_);
+            value_ = std::move(other.value_);
+            other.wait_ = nullptr;
+            other.discard_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~AsyncResult() {
+        Discard();
+    }
+
+    //! A result that is available right away, e.g. because the request could not be sent.
+    explicit AsyncResult(T value) :
+        value_(std::move(value)) {
+    }
+
+    //! Whether Get will return without blocking.
+    bool IsReady() const {
+        return value_.has_value() || !wait_ || (is_ready_ && is_ready_());
+    }
+
+    //! Blocks until the response has been received and returns the result. Later calls return the same result.
+    const T& Get() {
+        if (!value_) {
+            value_ = wait_ ? wait_() : T();
+            is_ready_ = nullptr;
+            wait_ = nullptr;
+            discard_ = nullptr;
+        }
+        return *value_;
+    }
+
+private:
+    void Discard() {
+        if (discard_) {
+            discard_();
+            discard_ = nullptr;
+        }
+    }
+
+    std::function<bool()> is_ready_;
+    std::function<T()> wait_;
+    std::function<void()> discard_;
+    std::optional<T> value_;
+};
+
 //! The QueryInterface provides additional data not contained in the observation.
 //!
 //! Performance note:
 //!  - Always try and batch things up. These queries are effectively synchronous and will block until returned.
+//!  - The Async versions send the query and return immediately, the result can be collected once other work is done.
 class QueryInterface {
 public:
     virtual ~QueryInterface() = default;
@@ -298,6 +406,16 @@ public:
     //!< \param queries Placement queries.
     //!< \return Array of bools indicating if placement is possible.
     virtual std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) = 0;
+
+    //! Sends an available abilities query without waiting for the response.
+    //!< \sa GetAbilitiesForUnits AsyncResult
+    virtual AsyncResult<std::vector<AvailableAbilities>> GetAbilitiesForUnitsAsync(const Units& units, bool ignore_resource_requirements = false, bool use_generalized_ability = true) = 0;
+    //! Sends pathing queries without waiting for the response.
+    //!< \sa PathingDistance AsyncResult
+    virtual AsyncResult<std::vector<float>> PathingDistanceAsync(const std::vector<PathingQuery>& queries) = 0;
+    //! Sends placement queries without waiting for the response.
+    //!< \sa Placement AsyncResult
+    virtual AsyncResult<std::vector<bool>> PlacementAsync(const std::vector<PlacementQuery>& queries) = 0;
 };
 
 //! The ActionInterface issues actions to units in a game. Not available in replays.
@@ -8,6 +8,7 @@
 
 #include "s2clientprotocol/sc2api.pb.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -75,6 +76,8 @@ struct PlayerInfo {
         player_name(player_name) {};
 };
 
+enum class Visibility;
+
 //! Initial data for a game and map.
 struct GameInfo {
     //! Plain text name of a map. Note that this may be different from the filename of the map.
@@ -163,4 +166,256 @@ private:
     SampleImage height_map_;
 };
 
+//! An image decoded to one byte per cell, cell (x, y) is at Row(y)[x]. Rows are padded to a multiple of kRowAlignment
+//! bytes and the buffer has kRowAlignment bytes to spare past the last row, so a row can be read 16 cells at a time
+//! without reading past the end.
+class CellGrid {
+public:
+    static constexpr int kRowAlignment = 16;
+
+    CellGrid();
+
+    //! Decodes an image, 1 bit per pixel images become 0 and 1 and 8 bit images are copied as they are.
+    explicit CellGrid(const ImageData& image);
+
+    //! Creates a grid with every cell set to the given value.
+    CellGrid(int width, int height, uint8_t value = 0);
+
+    //! Decodes image data into this grid like the constructor does, reusing the memory the grid already has. Data that
+    //! doesn't fit the size or has an unsupported bits per pixel leaves the grid empty.
+    void Assign(int width, int height, int bits_per_pixel, const std::string& data);
+
+    int Width() const { return width_; }
+    int Height() const { return height_; }
+    //! Distance in bytes between the start of two rows.
+    int Stride() const { return stride_; }
+    bool Empty() const { return width_ == 0 || height_ == 0; }
+
+    bool Contains(const Point2DI& point) const {
+        return point.x >= 0 && point.y >= 0 && point.x < width_ && point.y < height_;
+    }
+
+    //! Value of a cell, 0 outside the grid.
+    uint8_t Get(const Point2DI& point) const {
+        return Contains(point) ? cells_[point.y * stride_ + point.x] : 0;
+    }
+
+    void Set(const Point2DI& point, uint8_t value) {
+        cells_[point.y * stride_ + point.x] = value;
+    }
+
+    const uint8_t* Row(int y) const { return cells_.data() + y * stride_; }
+    uint8_t* Row(int y) { return cells_.data() + y * stride_; }
+
+    //! Sum of the cells of a rectangle, cells outside the grid count as 0.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    uint32_t Sum(const Rect2DI& rect) const;
+
+    //! Number of cells of a rectangle that hold the given value, cells outside the grid are not counted.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    uint32_t Count(const Rect2DI& rect, uint8_t value) const;
+
+    //! Whole grid, to pass to Sum or Count.
+    Rect2DI Area() const { return Rect2DI(Point2DI(0, 0), Point2DI(width_, height_)); }
+
+private:
+    int width_;
+    int height_;
+    int stride_;
+    std::vector<uint8_t> cells_;
+};
+
+//! The pathing, placement and height grids of a map decoded once, so sampling them is a plain array lookup. Cells
+//! outside the map are neither pathable nor placeable. The rectangle tests process 16 cells at a time with SSE2 where
+//! it is available.
+class TerrainGrids {
+public:
+    TerrainGrids() = default;
+
+    explicit TerrainGrids(const GameInfo& info);
+
+    bool IsPathable(const Point2DI& point) const { return pathing_.Get(point) != 0; }
+    bool IsPlacable(const Point2DI& point) const { return placement_.Get(point) != 0; }
+    float TerrainHeight(const Point2DI& point) const {
+        return height_.Contains(point) ? (static_cast<float>(height_.Get(point)) - 127) / 8.f : 0.0f;
+    }
+
+    //! True if every cell of the rectangle is pathable, e.g. to test the footprint of a unit.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    bool IsPathable(const Rect2DI& rect) const;
+    //! True if every cell of the rectangle is placeable, e.g. to test the footprint of a building.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    bool IsPlacable(const Rect2DI& rect) const;
+    //! Number of pathable cells in a rectangle.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    int CountPathable(const Rect2DI& rect) const;
+    //! Number of placeable cells in a rectangle.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    int CountPlacable(const Rect2DI& rect) const;
+
+    //! 1 for pathable cells, 0 for the others.
+    const CellGrid& Pathing() const { return pathing_; }
+    //! 1 for placeable cells, 0 for the others.
+    const CellGrid& Placement() const { return placement_; }
+    //! Terrain height as encoded by the game, see TerrainHeight.
+    const CellGrid& Height() const { return height_; }
+
+private:
+    CellGrid pathing_;
+    CellGrid placement_;
+    CellGrid height_;
+};
+
+//! The creep and visibility layers of an observation, decoded at most once per observation. Besides point
+//! lookups they count cells in rectangles and list the cells that became visible since the previous observation, which
+//! process 16 cells at a time with SSE2 where it is available.
+class MapStateGrids {
+public:
+    MapStateGrids() = default;
+
+    //! Decodes the layers of a new observation. The visibility it replaces is kept to find the newly revealed cells, so
+    //! "previous observation" below means the one passed to the previous call.
+    void Update(const SC2APIProtocol::MapState& map_state);
+
+    //! Forgets both layers and the previous visibility, e.g. when a new game starts.
+    void Clear();
+
+    bool HasCreep(const Point2DI& point) const { return creep_.Get(point) != 0; }
+
+    //! Visibility of a cell, FullHidden outside the map.
+    Visibility GetVisibility(const Point2DI& point) const {
+        return static_cast<Visibility>(visibility_.Contains(point) ? visibility_.Get(point) : kFullHidden);
+    }
+
+    //! Number of cells with creep in a rectangle.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    int CountCreep(const Rect2DI& rect) const;
+
+    //! Number of cells of a rectangle with the given visibility, cells outside the map are not counted.
+    //!< \param rect Cells from rect.from up to, but not including, rect.to.
+    int CountVisibility(const Rect2DI& rect, Visibility visibility) const;
+
+    //! Walks the cells a segment passes through, in order, and finds the first one that isn't visible, either fogged
+    //! or never seen. Cells outside the map are not visible.
+    //!< \param from Start of the segment.
+    //!< \param to End of the segment.
+    //!< \param cell Set to the first cell that isn't visible, if there is one.
+    //!< \return False if every cell along the segment is visible.
+    bool FindFirstFogged(const Point2D& from, const Point2D& to, Point2DI* cell = nullptr) const;
+
+    //! Number of cells that are visible now but were not in the previous observation.
+    int CountRevealed() const { return revealed_count_; }
+
+    //! Appends the cells that are visible now but were not in the previous observation.
+    void GetRevealedCells(std::vector<Point2DI>& cells) const;
+
+    //! 1 for cells with creep, 0 for the others.
+    const CellGrid& Creep() const { return creep_; }
+    //! Visibility of every cell as the numeric value of Visibility.
+    const CellGrid& VisibilityGrid() const { return visibility_; }
+    //! 1 for the cells revealed since the previous observation, 0 for the others.
+    const CellGrid& Revealed() const { return revealed_; }
+
+private:
+    // Numeric values of Visibility, which is declared in sc2_interfaces.h.
+    static constexpr uint8_t kVisible = 2;
+    static constexpr uint8_t kFullHidden = 3;
+
+    CellGrid creep_;
+    CellGrid visibility_;
+    CellGrid previous_visibility_;
+    CellGrid revealed_;
+    int revealed_count_ = 0;
+};
+
+//! A connected part of the pathable terrain, see MapAnalysis.
+struct MapRegion {
+    //! True for ramps, false for the areas they connect.
+    bool is_ramp = false;
+    int cell_count = 0;
+    //! Average position of the cells.
+    Point2D center;
+    //! Cells from bounds.from up to, but not including, bounds.to.
+    Rect2DI bounds;
+    //! Average terrain height of the cells, in world units.
+    float height = 0.0f;
+    //! Chokes leading to other regions, as indices into MapAnalysis::Chokes.
+    std::vector<int> chokes;
+};
+
+//! Where a ramp meets a region, see MapAnalysis. Narrow passages without a ramp are not chokes.
+struct MapChoke {
+    //! The ramp, as an index into MapAnalysis::Regions.
+    int ramp = -1;
+    //! The region the ramp leads to, as an index into MapAnalysis::Regions.
+    int region = -1;
+    //! Average position of the cells where the two meet.
+    Point2D center;
+    //! Distance across the opening, in cells.
+    float width = 0.0f;
+};
+
+//! Splits the pathable terrain of a map into regions joined by ramps. Ramps are groups of cells that are pathable but
+//! not placeable and climb at least half a level of terrain height (1 world unit), the other pathable cells form the
+//! regions. Every place a ramp touches a region is a choke, so the chokes are the edges of a graph whose nodes are the
+//! regions.
+//! Only ramps split the terrain: a narrow passage between two areas on the same level, e.g. a gap between rocks or
+//! cliffs, leaves both areas in one region and is not reported as a choke.
+//! Results can be saved to and loaded from a file, keyed on a hash of the grids they were computed from.
+class MapAnalysis {
+public:
+    MapAnalysis() = default;
+
+    explicit MapAnalysis(const GameInfo& info);
+
+    //! Computes the regions and chokes of a map, replacing any computed before.
+    void Analyze(const GameInfo& info);
+
+    //! Loads the analysis of the map from the cache directory if it was saved there before, otherwise analyzes the map
+    //! and saves the result. The file name is the hash of the grids, so every map has its own. An empty directory
+    //! turns the cache off, the map is then always analyzed.
+    //!< \return True if the analysis was loaded from the cache.
+    bool AnalyzeCached(const GameInfo& info, const std::string& cache_directory);
+
+    //! Writes the analysis to a file.
+    //!< \return False if the file could not be written.
+    bool Save(const std::string& file_path) const;
+
+    //! Reads an analysis written by Save.
+    //!< \param key Hash of the grids of the map, see Hash. Files saved for other grids are rejected.
+    //!< \return False if the file is missing, damaged or was saved for other grids, the analysis is left empty then.
+    bool Load(const std::string& file_path, uint64_t key);
+
+    //! FNV-1a hash of the pathing, placement and height grids of a map.
+    static uint64_t Hash(const GameInfo& info);
+
+    //! Hash of the grids the analysis was computed from.
+    uint64_t Key() const { return key_; }
+
+    const std::vector<MapRegion>& Regions() const { return regions_; }
+    const std::vector<MapChoke>& Chokes() const { return chokes_; }
+
+    //! Index of the region a cell belongs to, -1 for cells that are not pathable or outside the map.
+    int GetRegionIndex(const Point2DI& point) const;
+
+    //! Region a cell belongs to, nullptr for cells that are not pathable or outside the map.
+    const MapRegion* GetRegion(const Point2DI& point) const;
+
+    //! Indices of the regions reachable from a region through one of its chokes.
+    std::vector<int> GetNeighbours(int region) const;
+
+private:
+    void Clear();
+    // Fills MapRegion::chokes in from the chokes.
+    void LinkChokes();
+
+    int width_ = 0;
+    int height_ = 0;
+    uint64_t key_ = 0;
+    //! Region index + 1 of every cell, row after row, 0 for cells in no region.
+    std::vector<uint16_t> cell_regions_;
+    std::vector<MapRegion> regions_;
+    std::vector<MapChoke> chokes_;
+};
+
 }
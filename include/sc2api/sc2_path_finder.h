@@ -0,0 +1,137 @@
+/*! \file sc2_path_finder.h
+    \brief Finds paths on the pathing grid of a map without asking the game.
+
+The path finder runs A* over the cells of the pathing grid, moving to any of the eight neighbours of a cell. Diagonal
+moves cost sqrt(2) and may not cut the corner of a blocked cell. The path found is then straightened wherever a
+straight line stays on walkable cells. Structures can be added as obstacles, so paths go around the buildings currently
+on the map. Paths hug the centers of the cells next to obstacles rather than their edges, so distances differ slightly
+from QueryInterface::PathingDistance, ValidatePathFinder reports by how much.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "sc2api/sc2_common.h"
+#include "sc2api/sc2_interfaces.h"
+#include "sc2api/sc2_unit.h"
+
+namespace sc2
+{
+    class TerrainGrids;
+
+    //! True if the unit blocks ground units: structures on the ground other than lowered supply depots and creep tumors.
+    //! Placeholders of planned structures don't block anything either.
+    bool BlocksPathing(const Unit &unit);
+
+    //! Cells covered by a structure, 'to' is exclusive.
+    Rect2DI GetFootprint(const Unit &unit);
+
+    //! A path between two points.
+    struct Path
+    {
+        //! Centers of the cells where the path turns, followed by the goal. The start is not included.
+        std::vector<Point2D> waypoints;
+        //! Length of the path from the start through the waypoints.
+        float distance = 0.0f;
+    };
+
+    //! A* search over the pathing grid of a map.
+    class PathFinder
+    {
+    public:
+        PathFinder();
+
+        //! Uses the pathing grid of the terrain, see ObservationInterface::GetTerrainGrids.
+        explicit PathFinder(const TerrainGrids &terrain);
+
+        //! Replaces the pathing grid, obstacles are kept.
+        void SetTerrain(const TerrainGrids &terrain);
+
+        //! Blocks the footprints of the structures among the units and unblocks those of the structures set before.
+        //! Only units BlocksPathing accepts are obstacles.
+        //!< \param units Units of the current observation, e.g. ObservationInterface::GetUnits().
+        void SetObstacles(const Units &units);
+
+        //! Unblocks every obstacle.
+        void ClearObstacles();
+
+        //! True if a ground unit can stand in the cell, taking obstacles into account.
+        bool IsWalkable(const Point2DI &cell) const;
+
+        //! Finds the shortest path between two points. The start cell may be blocked, e.g. by the structure a unit is
+        //! standing next to, the goal cell must be walkable.
+        //!< \param from Start point.
+        //!< \param to Goal point.
+        //!< \param path Set to the path found, may be null when only the distance is needed.
+        //!< \return False if the goal can't be reached.
+        bool FindPath(const Point2D &from, const Point2D &to, Path *path = nullptr);
+
+        //! Length of the shortest path between two points.
+        //!< \return The distance, or 0 if the goal can't be reached, like QueryInterface::PathingDistance.
+        float Distance(const Point2D &from, const Point2D &to);
+
+        int Width() const;
+
+        int Height() const;
+
+    private:
+        enum CellFlags : uint8_t
+        {
+            Unpathable = 1 << 0,
+            Obstacle = 1 << 1
+        };
+
+        struct OpenNode
+        {
+            float estimate;
+            int cell;
+        };
+
+        bool Blocked(int cell) const;
+
+        //! Labels every group of connected walkable cells.
+        void UpdateRegions();
+
+        //! True if every cell the segment crosses is walkable.
+        bool ClearLine(const Point2D &from, const Point2D &to) const;
+
+        void BlockFootprint(const Unit &unit);
+
+        int width_;
+        int height_;
+        std::vector<uint8_t> cells_; //!< CellFlags of every cell, row after row.
+        std::vector<int> region_; //!< Label of the connected area each walkable cell is in, 0 for blocked cells.
+        bool regions_dirty_;
+
+        // Search state. A cell's entries are only valid if its visited_ stamp matches search_, so a new search doesn't
+        // have to clear them.
+        uint32_t search_;
+        std::vector<uint32_t> visited_;
+        std::vector<uint32_t> closed_;
+        std::vector<float> cost_;
+        std::vector<int> parent_;
+        std::vector<OpenNode> open_;
+        std::vector<int> cells_on_path_;
+        std::vector<Point2D> corners_;
+        Path distance_path_; //!< Reused by Distance.
+    };
+
+    //! How the distances of the path finder compare with the ones the game computes.
+    struct PathFinderValidation
+    {
+        int samples = 0; //!< Queries compared.
+        int reachability_mismatches = 0; //!< Queries only one of the two could find a path for.
+        float mean_relative_error = 0.0f; //!< Over the queries both found a path for.
+        float max_relative_error = 0.0f;
+    };
+
+    //! Compares the path finder with QueryInterface::PathingDistance on the given queries. The game is asked for all of
+    //! them in a single request, queries with a start unit are skipped.
+    //!< \param path_finder Path finder set up for the current map and structures.
+    //!< \param query Query interface of a client in a game.
+    //!< \param queries Pairs of points to compare.
+    PathFinderValidation ValidatePathFinder(PathFinder &path_finder, QueryInterface &query,
+                                            const std::vector<QueryInterface::PathingQuery> &queries);
+}
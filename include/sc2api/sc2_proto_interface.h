@@ -1,10 +1,12 @@
 #pragma once
 
 #include "sc2_connection.h"
+#include "sc2_proto_stats.h"
 
 #include "s2clientprotocol/sc2api.pb.h"
 
 #include <functional>
+#include <deque>
 
 namespace sc2 {
 
@@ -82,10 +84,16 @@ private:
         VAR.Set(MESSAGE.GetResponse(), nullptr);
 
 // Wraps proto and connections.
+//
+// By default requests are purely sequential: a request may only be sent once the response to the previous one has been
+// consumed. In pipelined mode several requests can be in flight at once, e.g. Action + Step + Observation can be sent
+// back to back and their responses consumed afterwards, in the same order, with WaitForResponseInternal.
 class ProtoInterface {
 public:
     ProtoInterface();
     bool ConnectToGame(const std::string& address, int port, int timeout_ms);
+    // Returns an empty request. Requests are recycled once every other reference to them is gone, so callers may keep
+    // using the returned pointer as long as they like but must not hold on to raw pointers into it after releasing it.
     GameRequestPtr MakeRequest();
     bool SendRequest(GameRequestPtr& request, bool ignore_pending_requests = false);
     GameResponsePtr WaitForResponseInternal();
@@ -95,10 +103,36 @@ public:
     bool PollResponse();
     SC2APIProtocol::Status GetLastStatus() const { return latest_status_; }
     bool HasResponsePending() const;
-    SC2APIProtocol::Response::ResponseCase GetResponsePending() const { return response_pending_; }
+    SC2APIProtocol::Response::ResponseCase GetResponsePending() const;
+
+    // Pipelined mode allows sending requests while responses are still pending.
+    void SetPipelined(bool value) { pipelined_ = value; }
+    bool IsPipelined() const { return pipelined_; }
+    // Number of requests sent whose responses have not been consumed yet, and the highest value it has reached.
+    std::size_t GetPendingRequestDepth() const { return responses_pending_.size(); }
+    std::size_t GetMaxPendingRequestDepth() const { return max_pending_depth_; }
+    // Requests are numbered from 1 in the order they are sent, their responses are consumed in the same order. The
+    // response to a request is next in line once every earlier response has been consumed.
+    uint64_t GetLastRequestNumber() const { return requests_sent_; }
+    uint64_t GetResponsesConsumed() const { return requests_sent_ - responses_pending_.size(); }
+    // Nobody will wait for the response to a request anymore, e.g. its AsyncResult was dropped. The response is read
+    // and thrown away once it is next in line, by DrainDiscardedResponses.
+    void DiscardResponse(uint64_t request_number);
+    // Reads and throws away the discarded responses at the front of the line. Blocks until they arrive.
+    void DrainDiscardedResponses();
     int GetAssignedPort() const { return port_; }
+    std::chrono::microseconds GetConnectLatency() const { return connection_.GetConnectLatency(); }
+    ResponsePool::Stats GetResponsePoolStats() const { return connection_.GetResponsePool()->GetStats(); }
+
+    // Capture the raw traffic with the game to a protocol trace, see sc2_protocol_recorder.h.
+    bool StartRecording(const std::string& path) { return connection_.StartRecording(path); }
+    void StopRecording() { connection_.StopRecording(); }
+    bool IsRecording() const { return connection_.IsRecording(); }
 
     const std::vector<uint32_t>& GetStats() const { return count_uses_; }
+    // Latency, payload size and parse time for every type of request sent so far.
+    const ProtoStats& GetRequestStats() const { return request_stats_; }
+    void ResetRequestStats() { request_stats_.Reset(); }
     void SetControl(ControlInterface* control) { control_ = control; }
 
     uint32_t GetBaseBuild() const { return base_build_; }
@@ -111,8 +145,20 @@ protected:
     unsigned int default_timeout_ms_;
     std::function<void(const std::string& error_str)> error_callback_;
     SC2APIProtocol::Status latest_status_;
-    SC2APIProtocol::Response::ResponseCase response_pending_;
+    struct PendingRequest {
+        SC2APIProtocol::Response::ResponseCase response_case;
+        std::chrono::steady_clock::time_point sent;
+        bool discarded = false;
+    };
+    // Expected responses in the order their requests were sent.
+    std::deque<PendingRequest> responses_pending_;
+    bool pipelined_;
+    std::size_t max_pending_depth_;
+    uint64_t requests_sent_;
     std::vector<uint32_t> count_uses_;
+    ProtoStats request_stats_;
+    // Requests handed out by MakeRequest, the ones only referenced from here are free to be reused.
+    std::vector<GameRequestPtr> request_pool_;
     ControlInterface* control_;
 
     uint32_t base_build_;
@@ -0,0 +1,84 @@
+/*! \file sc2_proto_stats.h
+    \brief Latency and payload statistics for the requests sent to the game.
+*/
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sc2 {
+
+//! A histogram of durations with logarithmic buckets. Each power of two is split in four, so a percentile is accurate to
+//! within 25%. Recording is a handful of integer operations and the memory used is fixed.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void Record(std::chrono::microseconds value);
+    void Reset();
+
+    uint64_t Count() const { return count_; }
+    std::chrono::microseconds Max() const { return std::chrono::microseconds(max_); }
+    std::chrono::microseconds Mean() const;
+
+    //! Returns an upper bound of the given percentile of the recorded values.
+    //!< \param percentile In the range [0, 100].
+    std::chrono::microseconds Percentile(double percentile) const;
+
+private:
+    static constexpr int kSubBucketBits = 2;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    // Durations above 2^40us (roughly 12 days) are all recorded in the last bucket.
+    static constexpr int kMaxExponent = 40;
+    static constexpr int kBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    static int BucketIndex(uint64_t value);
+    static uint64_t BucketUpperBound(int index);
+
+    std::array<uint64_t, kBuckets> buckets_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+//! Statistics for one type of request.
+struct RequestStats {
+    RequestStats();
+
+    uint64_t requests;                  //!< Number of requests sent.
+    uint64_t responses;                 //!< Number of responses received.
+    uint64_t request_bytes;             //!< Total serialized size of the requests.
+    uint64_t response_bytes;            //!< Total serialized size of the responses.
+    uint64_t max_response_bytes;        //!< Largest response received.
+    LatencyHistogram latency;           //!< Time from sending a request until its response arrived off the socket.
+    LatencyHistogram parse_time;        //!< Time spent parsing the response.
+    LatencyHistogram wait_time;         //!< Time the caller was blocked waiting for the response.
+};
+
+//! Statistics for all request types, indexed by SC2APIProtocol::Request::RequestCase.
+class ProtoStats {
+public:
+    void RecordRequest(int request_case, std::size_t bytes);
+    void RecordResponse(int request_case, std::size_t bytes, std::chrono::microseconds latency, std::chrono::microseconds parse_time, std::chrono::microseconds wait_time);
+    void Reset();
+
+    //! Returns the statistics for a request type, all zero if it was never used.
+    const RequestStats& Get(int request_case) const;
+
+    //! Number of request types the statistics have room for, every index below it can be passed to Get.
+    std::size_t Size() const { return stats_.size(); }
+
+    //! Serializes the statistics of every request type used so far as a JSON object keyed by request name. Durations
+    //! are in microseconds and sizes in bytes.
+    std::string ToJson() const;
+
+private:
+    RequestStats& At(int request_case);
+
+    std::vector<RequestStats> stats_;
+};
+
+}
@@ -8,6 +8,9 @@
 
 namespace sc2 {
 
+class AbilityRemapTable;
+class WorkerPool;
+
 typedef MessageResponsePtr<SC2APIProtocol::ResponseObservation> ResponseObservationPtr;
 typedef MessageResponsePtr<SC2APIProtocol::Observation> ObservationPtr;
 typedef MessageResponsePtr<SC2APIProtocol::ObservationRaw> ObservationRawPtr;
@@ -17,7 +20,22 @@ typedef MessageResponsePtr<SC2APIProtocol::ResponseGameInfo> ResponseGameInfoPtr
 typedef MessageResponsePtr<SC2APIProtocol::ResponseQuery> ResponseQueryPtr;
 
 bool Convert(const ObservationPtr& observation_ptr, Score& score);
-bool Convert(const ObservationRawPtr& observation_ptr, UnitPool& unit_pool, uint32_t game_loop, uint32_t prev_game_loop);
+//! How Convert turns the units of an observation into Unit objects.
+struct UnitConversionOptions {
+    //! If set, ability ids in orders are generalized with it.
+    const AbilityRemapTable* ability_remap = nullptr;
+    //! If set, observations with at least two tasks worth of units are converted on these threads.
+    WorkerPool* workers = nullptr;
+    //! Units converted per task when converting in parallel.
+    size_t units_per_task = 256;
+    //! ConversionMask flags of the unit fields to convert, the others are left zero or empty.
+    uint32_t mask = ConversionMask::All;
+};
+
+//! Updates the units in the pool from an observation. Only fields that differ are written, units with any difference
+//! get their last_changed_game_loop set and are listed in UnitPool::GetChangedUnits. Slots and events come out the same
+//! whether the units are converted in parallel or not.
+bool Convert(const ObservationRawPtr& observation_ptr, UnitPool& unit_pool, uint32_t game_loop, uint32_t prev_game_loop, const UnitConversionOptions& options = {});
 bool Convert(const ObservationPtr& observation_ptr, RenderedFrame& render);
 bool Convert(const ResponseGameInfoPtr& response_game_info_ptr, GameInfo& game_info);
 
@@ -0,0 +1,118 @@
+/*! \file sc2_protocol_recorder.h
+    \brief Captures the raw protocol traffic of a connection to disk and reads it back.
+
+A trace starts with an 8 byte magic ("SC2TRACE"), a 32 bit format version and the 64 bit wall clock time the recording
+started at, in microseconds since the unix epoch. It is followed by one record per message:
+
+    uint8   direction   0 for a request sent to the game, 1 for a response received from it
+    uint64  timestamp   Microseconds since the recording started
+    uint32  length      Size of the payload
+    bytes   payload     The serialized Request or Response
+
+All integers are little endian.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sc2
+{
+    //! Direction of a message in a protocol trace.
+    enum class ProtocolDirection : uint8_t
+    {
+        Request = 0,
+        Response = 1
+    };
+
+    //! A single message read from a protocol trace.
+    struct ProtocolTraceRecord
+    {
+        ProtocolDirection direction = ProtocolDirection::Request;
+        std::chrono::microseconds timestamp{0}; //!< Time since the recording started.
+        std::string payload; //!< The serialized Request or Response.
+    };
+
+    //! Appends messages to a protocol trace. Recording only copies the message into a buffer, the file is written by a
+    //! background thread so the threads sending and receiving messages never wait on the disk.
+    class ProtocolRecorder
+    {
+    public:
+        ProtocolRecorder();
+
+        ~ProtocolRecorder();
+
+        ProtocolRecorder(const ProtocolRecorder &) = delete;
+
+        ProtocolRecorder &operator=(const ProtocolRecorder &) = delete;
+
+        //! Creates the trace file and starts the writer thread. A recording in progress is stopped first.
+        //!< \param path Where to write the trace, an existing file is overwritten.
+        //!< \return True if the file could be created.
+        bool Start(const std::string &path);
+
+        //! Writes out everything recorded so far and closes the file.
+        void Stop();
+
+        //! Whether a recording is in progress.
+        bool IsRecording() const;
+
+        //! Adds a message to the trace, does nothing unless recording. Thread safe.
+        //!< \param direction Whether the message was sent or received.
+        //!< \param data The serialized message.
+        //!< \param size The size of the message in bytes.
+        void Record(ProtocolDirection direction, const void *data, std::size_t size);
+
+    private:
+        void WriterThread();
+
+        std::atomic_bool recording_;
+        std::FILE *file_;
+        std::chrono::steady_clock::time_point start_;
+
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::vector<char> pending_; //!< Encoded records waiting to be written, filled by Record.
+        bool stop_;
+        std::thread writer_;
+    };
+
+    //! Reads the messages of a protocol trace in the order they were recorded.
+    class ProtocolTraceReader
+    {
+    public:
+        ProtocolTraceReader();
+
+        ~ProtocolTraceReader();
+
+        ProtocolTraceReader(const ProtocolTraceReader &) = delete;
+
+        ProtocolTraceReader &operator=(const ProtocolTraceReader &) = delete;
+
+        //! Opens a trace and validates its header.
+        //!< \return True if the file is a trace this version can read.
+        bool Open(const std::string &path);
+
+        void Close();
+
+        //! Reads the next message.
+        //!< \param record Filled out with the message, its payload buffer is reused between calls.
+        //!< \return False at the end of the trace or if it is truncated.
+        bool Next(ProtocolTraceRecord &record);
+
+        //! Wall clock time the recording started at.
+        std::chrono::system_clock::time_point GetStartTime() const;
+
+    private:
+        std::FILE *file_;
+        std::chrono::system_clock::time_point start_time_;
+    };
+}
@@ -9,6 +9,7 @@
 #include <vector>
 #include <mutex>
 #include <memory>
+#include <condition_variable>
 
 #include <ixwebsocket/IXWebSocketServer.h>
 
@@ -50,6 +51,15 @@ namespace sc2
 
         const ResponseData &PeekResponse();
 
+        // Removes the oldest request from the queue, the caller takes ownership of the request.
+        RequestData PopRequest();
+
+        // Blocks until a request is queued or the timeout expires, returns whether there is a request.
+        bool WaitForRequest(unsigned int timeout_ms);
+
+        // The port the server listens on, 0 if it isn't listening.
+        int GetPort() const;
+
     private:
         std::unique_ptr<ix::WebSocketServer> webSocketServer;
         std::vector<ix::WebSocket *> clients;
@@ -59,5 +69,6 @@ namespace sc2
 
         std::mutex request_mutex;
         std::mutex response_mutex;
+        std::condition_variable request_condition;
     };
 }
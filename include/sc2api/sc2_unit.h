@@ -7,7 +7,11 @@
 #include "sc2_gametypes.h"
 #include "sc2_common.h"
 #include "sc2_typeenums.h"
+#include "sc2utils/flat_tag_map.h"
+#include "sc2utils/small_vector.h"
 #include <vector>
+#include <deque>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
@@ -174,11 +178,11 @@ public:
     // Not populated for enemies/snapshots
 
     //! Orders on a unit. Only valid for this player's units.
-    std::vector<UnitOrder> orders;
+    SmallVector<UnitOrder, 4> orders;
     //! Add-on like a tech lab or reactor. Only valid for this player's units.
     Tag add_on_tag;
     //! Passengers in this transport. Only valid for this player's units.
-    std::vector<PassengerUnit> passengers;
+    SmallVector<PassengerUnit, 8> passengers;
     //! Number of cargo slots used in the transport. Only valid for this player's units.
     int cargo_space_taken;
     //! Number of cargo slots available for a transport. Only valid for this player's units.
@@ -190,7 +194,7 @@ public:
     //! Target unit of a unit. Only valid for this player's units.
     Tag engaged_target_tag;
     //! Buffs on this unit. Only valid for this player's units.
-    std::vector<BuffID> buffs;
+    SmallVector<BuffID, 8> buffs;
     //! Whether the unit is powered by a pylon.
     bool is_powered;
 
@@ -198,6 +202,12 @@ public:
     bool is_alive;
     //! The last time the unit was seen.
     uint32_t last_seen_game_loop;
+    //! The last observation in which anything about the unit other than last_seen_game_loop was different. Units that
+    //! did not change in the current step can be skipped by comparing this to ObservationInterface::GetGameLoop.
+    uint32_t last_changed_game_loop;
+    //! Incremented every time the memory of the unit is reused for another unit, see UnitPool::SetRecycleDelay. A
+    //! pointer kept together with its generation can be checked with UnitPool::GetUnit before it is used again.
+    uint32_t generation;
 
     //! Level of weapon upgrades.
     int32_t attack_upgrade_level;
@@ -231,13 +241,44 @@ struct UnitDamage {
 
 typedef std::vector<UnitDamage> UnitsDamaged;
 
+//! Memory use of the unit pool of a client.
+struct UnitPoolStats {
+    size_t capacity = 0;        //!< Number of units the pool has allocated room for.
+    size_t in_use = 0;          //!< Number of units currently tracked, alive or dead.
+    size_t free = 0;            //!< Number of slots waiting to be reused.
+    size_t high_water_mark = 0; //!< Highest number of units tracked at once.
+    uint64_t recycled = 0;      //!< Number of times a slot was reused for a new unit.
+};
+
+//! Passed to UnitPool::SetRecycleDelay to keep dead units forever, which is the default.
+static const uint32_t kNeverRecycleUnits = std::numeric_limits<uint32_t>::max();
+
+//! Owns every unit a client has seen. A unit keeps its address for as long as it is tracked, so pointers handed out
+//! stay valid across steps. Dead units are tracked until they have not been observed for the recycle delay, after
+//! that their slot is reused for a new unit. Recycling only happens in RecycleDeadUnits, which runs before an
+//! observation is converted, so no pointer is ever invalidated in the middle of a step.
 class UnitPool {
 public:
-    Unit* CreateUnit(Tag tag);
+    //! Returns the unit with the given tag, creating it if it was never seen.
+    //!< \param created Set to whether the unit was created, its fields are uninitialized then.
+    Unit* CreateUnit(Tag tag, bool* created = nullptr);
     Unit* GetUnit(Tag tag) const;
+    //! Returns the unit with the given tag only if its memory was not reused since the generation was read from it.
+    Unit* GetUnit(Tag tag, uint32_t generation) const;
     Unit* GetExistingUnit(Tag tag) const;
     void MarkDead(Tag tag);
 
+    //! Sets how many game loops a dead unit is kept around after it was last observed.
+    void SetRecycleDelay(uint32_t game_loops) { recycle_delay_ = game_loops; }
+    uint32_t GetRecycleDelay() const { return recycle_delay_; }
+
+    //! Frees the slots of units that died at least the recycle delay before the given game loop. Units that vanished
+    //! without dying, e.g. snapshots of structures that are gone, are freed once they were not observed for the delay.
+    //! A game loop lower than the previous one means a new game started, then every unit of the old game is freed.
+    void RecycleDeadUnits(uint32_t game_loop);
+
+    UnitPoolStats GetStats() const;
+
     //TODO: Change alive -> Exist
     void ForEachExistingUnit(const std::function<void(Unit& unit)>& functor) const;
     void ClearExisting();
@@ -247,6 +288,7 @@ public:
     const Units& GetUnitsEnteringVision() const noexcept { return units_entering_vision_; };
     const Units& GetCompletedBuildings() const noexcept { return buildings_constructed_; };
     const UnitsDamaged& GetDamagedUnits() const noexcept { return units_damaged_; };
+    const Units& GetChangedUnits() const noexcept { return units_changed_; };
     const std::unordered_set<const Unit*>& GetIdledUnits() const noexcept { return units_idled_; };
 
     void AddNewUnit(const Unit* u) { units_newly_created_.push_back(u); };
@@ -256,6 +298,7 @@ public:
         if (u->alliance == Unit::Alliance::Self) units_idled_.insert(u);
     }
     void AddUnitDamaged(const Unit* u, float health, float shield) { units_damaged_.push_back({u, health, shield}); }
+    void AddUnitChanged(const Unit* u) { units_changed_.push_back(u); }
 
 private:
     void IncrementIndex();
@@ -265,12 +308,21 @@ private:
     // std::array<Unit, ENTRY_SIZE>
     std::vector<std::vector<Unit> > unit_pool_;
     PoolIndex available_index_;
-    std::unordered_map<Tag, Unit *> tag_to_unit_;
-    std::unordered_map<Tag, Unit *> tag_to_existing_unit_;
+    // Dead units in the order they died, stamped with the last game loop they were observed in.
+    std::deque<std::pair<Tag, uint32_t>> dead_units_;
+    std::vector<Unit*> free_units_;
+    uint32_t recycle_delay_ = kNeverRecycleUnits;
+    uint32_t last_recycle_game_loop_ = 0;
+    uint32_t next_sweep_game_loop_ = 0;
+    size_t high_water_mark_ = 0;
+    uint64_t recycled_ = 0;
+    FlatTagMap<Unit *> tag_to_unit_;
+    FlatTagMap<Unit *> tag_to_existing_unit_;
     Units units_newly_created_;
     Units units_entering_vision_;
     Units buildings_constructed_;
     UnitsDamaged units_damaged_;
+    Units units_changed_;
     std::unordered_set<const Unit*> units_idled_;
 };
 
@@ -3,6 +3,7 @@
 #include "sc2_typeenums.h"
 #include "sc2_unit.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace sc2 {
@@ -17,13 +18,14 @@ struct IsUnit {
 };
 
 //! Determines if units matches the unit type.
+//! The types are kept as a bitset, so a test costs the same however many types are given.
 struct IsUnits {
     explicit IsUnits(const std::vector<UNIT_TYPEID>& types_);
 
     bool operator()(const Unit& unit_) const ;
 
  private:
-    std::vector<UNIT_TYPEID> m_types;
+    std::vector<uint64_t> m_types;
 };
 
 //! Determines if the unit is town hall (command center, hatchery etc).
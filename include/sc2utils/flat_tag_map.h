@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @file flat_tag_map.h
+ * @brief An open-addressing hash map keyed on 64 bit unit tags.
+ */
+namespace sc2
+{
+    /**
+     * @class FlatTagMap
+     * @brief A hash map from a 64 bit tag to a small value, stored in a single flat array.
+     *
+     * Collisions are resolved by linear probing and erasing shifts the following entries back, so there are no
+     * tombstones and a lookup never scans more than the run of occupied slots it hashes into. Clear keeps the allocated
+     * array, rebuilding a map of the same size every step allocates nothing.
+     *
+     * Tag 0 marks an empty slot, which is what the API uses for NullTag, so it can't be used as a key.
+     *
+     * @tparam Value Mapped type, it must be default constructible and cheap to move.
+     */
+    template<typename Value>
+    class FlatTagMap
+    {
+    public:
+        using Key = uint64_t;
+
+        struct Slot
+        {
+            Key key = kEmptyKey;
+            Value value{};
+        };
+
+        static constexpr Key kEmptyKey = 0;
+
+        /**
+         * @brief Iterates over the occupied slots in storage order.
+         */
+        template<typename SlotType>
+        class Iterator
+        {
+        public:
+            Iterator(SlotType *slot, SlotType *end) : slot_(slot), end_(end)
+            {
+                SkipEmpty();
+            }
+
+            SlotType &operator*() const
+            {
+                return *slot_;
+            }
+
+            SlotType *operator->() const
+            {
+                return slot_;
+            }
+
+            Iterator &operator++()
+            {
+                ++slot_;
+                SkipEmpty();
+                return *this;
+            }
+
+            bool operator==(const Iterator &other) const
+            {
+                return slot_ == other.slot_;
+            }
+
+            bool operator!=(const Iterator &other) const
+            {
+                return slot_ != other.slot_;
+            }
+
+        private:
+            void SkipEmpty()
+            {
+                while (slot_ != end_ && slot_->key == kEmptyKey)
+                {
+                    ++slot_;
+                }
+            }
+
+            SlotType *slot_;
+            SlotType *end_;
+        };
+
+        using iterator = Iterator<Slot>;
+        using const_iterator = Iterator<const Slot>;
+
+        FlatTagMap() = default;
+
+        /**
+         * @brief Number of entries in the map.
+         */
+        [[nodiscard]] std::size_t Size() const
+        {
+            return size_;
+        }
+
+        [[nodiscard]] bool Empty() const
+        {
+            return size_ == 0;
+        }
+
+        /**
+         * @brief Number of slots allocated, the map grows once it is three quarters full.
+         */
+        [[nodiscard]] std::size_t Capacity() const
+        {
+            return slots_.size();
+        }
+
+        /**
+         * @brief Makes room for at least the given number of entries without growing.
+         */
+        void Reserve(std::size_t count)
+        {
+            std::size_t capacity = kMinCapacity;
+            while (capacity * kMaxLoadNumerator < count * kMaxLoadDenominator)
+            {
+                capacity *= 2;
+            }
+            if (capacity > slots_.size())
+            {
+                Rehash(capacity);
+            }
+        }
+
+        /**
+         * @brief Removes every entry and keeps the allocated slots.
+         */
+        void Clear()
+        {
+            if (size_ == 0)
+            {
+                return;
+            }
+            for (Slot &slot : slots_)
+            {
+                slot = Slot();
+            }
+            size_ = 0;
+        }
+
+        /**
+         * @brief Looks up a key.
+         * @return The value stored for the key, or nullptr. Valid until the map is modified.
+         */
+        Value *Find(Key key)
+        {
+            return const_cast<Value *>(static_cast<const FlatTagMap *>(this)->Find(key));
+        }
+
+        const Value *Find(Key key) const
+        {
+            if (size_ == 0 || key == kEmptyKey)
+            {
+                return nullptr;
+            }
+
+            for (std::size_t i = Home(key);; i = (i + 1) & mask_)
+            {
+                const Slot &slot = slots_[i];
+                if (slot.key == key)
+                {
+                    return &slot.value;
+                }
+                if (slot.key == kEmptyKey)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        [[nodiscard]] bool Contains(Key key) const
+        {
+            return Find(key) != nullptr;
+        }
+
+        /**
+         * @brief Stores a value for a key, replacing the value already stored for it.
+         * @return True if the key was not in the map before. The reserved empty key is never stored and returns false.
+         */
+        bool Insert(Key key, Value value)
+        {
+            if (key == kEmptyKey)
+            {
+                return false;
+            }
+            if ((size_ + 1) * kMaxLoadDenominator > slots_.size() * kMaxLoadNumerator)
+            {
+                Rehash(slots_.empty() ? kMinCapacity : slots_.size() * 2);
+            }
+
+            for (std::size_t i = Home(key);; i = (i + 1) & mask_)
+            {
+                Slot &slot = slots_[i];
+                if (slot.key == key)
+                {
+                    slot.value = std::move(value);
+                    return false;
+                }
+                if (slot.key == kEmptyKey)
+                {
+                    slot.key = key;
+                    slot.value = std::move(value);
+                    ++size_;
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Removes a key.
+         * @return True if the key was in the map.
+         */
+        bool Erase(Key key)
+        {
+            if (size_ == 0 || key == kEmptyKey)
+            {
+                return false;
+            }
+
+            std::size_t hole = Home(key);
+            while (slots_[hole].key != key)
+            {
+                if (slots_[hole].key == kEmptyKey)
+                {
+                    return false;
+                }
+                hole = (hole + 1) & mask_;
+            }
+
+            // Shift back every following entry that probed past the hole, so lookups never need tombstones.
+            for (std::size_t i = (hole + 1) & mask_; slots_[i].key != kEmptyKey; i = (i + 1) & mask_)
+            {
+                std::size_t home = Home(slots_[i].key);
+                // The entry can move into the hole unless its home lies cyclically within (hole, i].
+                if (((i - home) & mask_) >= ((i - hole) & mask_))
+                {
+                    slots_[hole] = std::move(slots_[i]);
+                    hole = i;
+                }
+            }
+
+            slots_[hole] = Slot();
+            --size_;
+            return true;
+        }
+
+        iterator begin()
+        {
+            return iterator(slots_.data(), slots_.data() + slots_.size());
+        }
+
+        iterator end()
+        {
+            return iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size());
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(slots_.data(), slots_.data() + slots_.size());
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size());
+        }
+
+    private:
+        static constexpr std::size_t kMinCapacity = 16;
+        static constexpr std::size_t kMaxLoadNumerator = 3;
+        static constexpr std::size_t kMaxLoadDenominator = 4;
+
+        std::size_t Home(Key key) const
+        {
+            // Tags keep an index in the low bits and a recycle count in the high bits, mix them so both spread out.
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return static_cast<std::size_t>(key) & mask_;
+        }
+
+        void Rehash(std::size_t capacity)
+        {
+            std::vector<Slot> old = std::move(slots_);
+            slots_.assign(capacity, Slot());
+            mask_ = capacity - 1;
+            for (Slot &slot : old)
+            {
+                if (slot.key == kEmptyKey)
+                {
+                    continue;
+                }
+                std::size_t i = Home(slot.key);
+                while (slots_[i].key != kEmptyKey)
+                {
+                    i = (i + 1) & mask_;
+                }
+                slots_[i] = std::move(slot);
+            }
+        }
+
+        std::vector<Slot> slots_;
+        std::size_t mask_ = 0;
+        std::size_t size_ = 0;
+    };
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @file small_vector.h
+ * @brief A vector that keeps its first few elements inside the object.
+ */
+namespace sc2
+{
+    /**
+     * @class SmallVector
+     * @brief A sequence container with room for N elements inline, spilling over to the heap beyond that.
+     *
+     * Offers the subset of the std::vector interface the API uses. As long as the size stays at or below N nothing is
+     * allocated, and like std::vector, clear() keeps whatever capacity was reached so refilling never allocates either.
+     * Iterators are plain pointers and are invalidated by anything that can grow the vector, or by moving it.
+     *
+     * @tparam T Element type.
+     * @tparam N Number of elements stored inline.
+     */
+    template<typename T, std::size_t N>
+    class SmallVector
+    {
+        static_assert(N > 0, "Use std::vector without inline storage");
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T &;
+        using const_reference = const T &;
+        using pointer = T *;
+        using const_pointer = const T *;
+        using iterator = T *;
+        using const_iterator = const T *;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        SmallVector() = default;
+
+        SmallVector(std::initializer_list<T> values)
+        {
+            Append(values.begin(), values.end());
+        }
+
+        template<typename InputIt>
+        SmallVector(InputIt first, InputIt last)
+        {
+            Append(first, last);
+        }
+
+        SmallVector(const SmallVector &other)
+        {
+            Append(other.begin(), other.end());
+        }
+
+        SmallVector(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            TakeFrom(other);
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            Deallocate();
+        }
+
+        SmallVector &operator=(const SmallVector &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                Append(other.begin(), other.end());
+            }
+            return *this;
+        }
+
+        SmallVector &operator=(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &other)
+            {
+                clear();
+                Deallocate();
+                TakeFrom(other);
+            }
+            return *this;
+        }
+
+        SmallVector &operator=(std::initializer_list<T> values)
+        {
+            clear();
+            Append(values.begin(), values.end());
+            return *this;
+        }
+
+        [[nodiscard]] size_type size() const
+        {
+            return size_;
+        }
+
+        [[nodiscard]] size_type capacity() const
+        {
+            return capacity_;
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        /**
+         * @brief Whether the elements are stored inline, i.e. the vector never had to allocate.
+         */
+        [[nodiscard]] bool is_inline() const
+        {
+            return data_ == Inline();
+        }
+
+        T *data()
+        {
+            return data_;
+        }
+
+        const T *data() const
+        {
+            return data_;
+        }
+
+        iterator begin()
+        {
+            return data_;
+        }
+
+        iterator end()
+        {
+            return data_ + size_;
+        }
+
+        const_iterator begin() const
+        {
+            return data_;
+        }
+
+        const_iterator end() const
+        {
+            return data_ + size_;
+        }
+
+        const_iterator cbegin() const
+        {
+            return data_;
+        }
+
+        const_iterator cend() const
+        {
+            return data_ + size_;
+        }
+
+        reverse_iterator rbegin()
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend()
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rbegin() const
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        T &operator[](size_type index)
+        {
+            return data_[index];
+        }
+
+        const T &operator[](size_type index) const
+        {
+            return data_[index];
+        }
+
+        T &at(size_type index)
+        {
+            if (index >= size_)
+            {
+                throw std::out_of_range("SmallVector::at");
+            }
+            return data_[index];
+        }
+
+        const T &at(size_type index) const
+        {
+            if (index >= size_)
+            {
+                throw std::out_of_range("SmallVector::at");
+            }
+            return data_[index];
+        }
+
+        T &front()
+        {
+            return data_[0];
+        }
+
+        const T &front() const
+        {
+            return data_[0];
+        }
+
+        T &back()
+        {
+            return data_[size_ - 1];
+        }
+
+        const T &back() const
+        {
+            return data_[size_ - 1];
+        }
+
+        void push_back(const T &value)
+        {
+            emplace_back(value);
+        }
+
+        void push_back(T &&value)
+        {
+            emplace_back(std::move(value));
+        }
+
+        template<typename... Args>
+        T &emplace_back(Args &&... args)
+        {
+            if (size_ == capacity_)
+            {
+                // Constructed before growing, args may refer to an element of this vector.
+                T value(std::forward<Args>(args)...);
+                Grow(capacity_ * 2);
+                return *new(data_ + size_++) T(std::move(value));
+            }
+            return *new(data_ + size_++) T(std::forward<Args>(args)...);
+        }
+
+        void pop_back()
+        {
+            std::destroy_at(data_ + --size_);
+        }
+
+        iterator erase(const_iterator position)
+        {
+            return erase(position, position + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            iterator target = data_ + (first - data_);
+            iterator tail = data_ + (last - data_);
+            if (target != tail)
+            {
+                iterator new_end = std::move(tail, end(), target);
+                std::destroy(new_end, end());
+                size_ = static_cast<size_type>(new_end - data_);
+            }
+            return target;
+        }
+
+        /**
+         * @brief Destroys every element. The capacity is kept.
+         */
+        void clear()
+        {
+            std::destroy(begin(), end());
+            size_ = 0;
+        }
+
+        void reserve(size_type count)
+        {
+            if (count > capacity_)
+            {
+                Grow(count);
+            }
+        }
+
+        void resize(size_type count)
+        {
+            Resize(count, [](T *slot) { new(slot) T(); });
+        }
+
+        void resize(size_type count, const T &value)
+        {
+            Resize(count, [&value](T *slot) { new(slot) T(value); });
+        }
+
+        friend bool operator==(const SmallVector &lhs, const SmallVector &rhs)
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        }
+
+        friend bool operator!=(const SmallVector &lhs, const SmallVector &rhs)
+        {
+            return !(lhs == rhs);
+        }
+
+    private:
+        T *Inline()
+        {
+            return std::launder(reinterpret_cast<T *>(inline_));
+        }
+
+        const T *Inline() const
+        {
+            return std::launder(reinterpret_cast<const T *>(inline_));
+        }
+
+        template<typename InputIt>
+        void Append(InputIt first, InputIt last)
+        {
+            for (; first != last; ++first)
+            {
+                emplace_back(*first);
+            }
+        }
+
+        template<typename Construct>
+        void Resize(size_type count, Construct construct)
+        {
+            if (count < size_)
+            {
+                std::destroy(data_ + count, end());
+                size_ = count;
+                return;
+            }
+            reserve(count);
+            while (size_ < count)
+            {
+                construct(data_ + size_);
+                ++size_;
+            }
+        }
+
+        void Grow(size_type capacity)
+        {
+            capacity = std::max(capacity, N + 1);
+            T *grown = static_cast<T *>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+            std::uninitialized_move(begin(), end(), grown);
+            std::destroy(begin(), end());
+            Deallocate();
+            data_ = grown;
+            capacity_ = capacity;
+        }
+
+        void Deallocate()
+        {
+            if (!is_inline())
+            {
+                ::operator delete(data_, std::align_val_t(alignof(T)));
+                data_ = Inline();
+                capacity_ = N;
+            }
+        }
+
+        // Leaves other empty and inline, its heap buffer is taken over as is.
+        void TakeFrom(SmallVector &other)
+        {
+            if (other.is_inline())
+            {
+                std::uninitialized_move(other.begin(), other.end(), data_);
+                size_ = other.size_;
+                other.clear();
+                return;
+            }
+
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+            size_ = other.size_;
+            other.data_ = other.Inline();
+            other.capacity_ = N;
+            other.size_ = 0;
+        }
+
+        alignas(T) unsigned char inline_[N * sizeof(T)];
+        T *data_ = Inline();
+        size_type size_ = 0;
+        size_type capacity_ = N;
+    };
+}
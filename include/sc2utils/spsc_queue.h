@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+/**
+ * @file spsc_queue.h
+ * @brief A bounded single-producer/single-consumer queue used to hand messages between two threads.
+ */
+namespace sc2
+{
+    /**
+     * @class SpscQueue
+     * @brief A bounded, lock-free ring buffer for exactly one producer thread and one consumer thread.
+     *
+     * Pushing and popping only touch two atomic indices, neither side ever takes a lock while the other is running. The
+     * consumer can block for an element with a timeout. Blocking uses an event count: the consumer announces that it is
+     * about to sleep and only then does the producer pay for a notification, so a consumer that keeps up with the
+     * producer never causes a system call on either side.
+     *
+     * @tparam T Element type, it must be default constructible and movable.
+     */
+    template<typename T>
+    class SpscQueue
+    {
+    public:
+        /**
+         * @brief Constructs an empty queue.
+         * @param capacity Minimum number of elements the queue can hold, rounded up to a power of two.
+         */
+        explicit SpscQueue(std::size_t capacity = 64) : mask_(RoundUpPow2(capacity) - 1),
+                                                        buffer_(new T[mask_ + 1])
+        {
+        }
+
+        SpscQueue(const SpscQueue &) = delete;
+
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        /**
+         * @brief Number of elements the queue can hold.
+         */
+        [[nodiscard]] std::size_t Capacity() const
+        {
+            return mask_ + 1;
+        }
+
+        /**
+         * @brief Appends an element unless the queue is full. Producer only.
+         * @return True iff the element was queued, on failure the element is left untouched.
+         */
+        bool TryPush(T &value)
+        {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_cache_ > mask_)
+            {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ > mask_)
+                {
+                    return false;
+                }
+            }
+
+            buffer_[tail & mask_] = std::move(value);
+            // Sequentially consistent so it can't be reordered with the load of waiting_ below, see Pop.
+            tail_.store(tail + 1, std::memory_order_seq_cst);
+            if (waiting_.load(std::memory_order_seq_cst))
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex_);
+                }
+                condition_.notify_one();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Appends an element, yielding until there is space if the queue is full. Producer only.
+         * @param stop Gives up waiting once set, so a consumer that stops popping can still shut the producer down.
+         * @return True iff the element was queued, false if stop was set while the queue was full and the element was
+         * dropped.
+         */
+        bool Push(T value, const std::atomic_bool &stop)
+        {
+            while (!TryPush(value))
+            {
+                if (stop.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Removes the oldest element if there is one. Consumer only.
+         */
+        std::optional<T> TryPop()
+        {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_cache_)
+            {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head == tail_cache_)
+                {
+                    return std::nullopt;
+                }
+            }
+
+            std::optional<T> value(std::move(buffer_[head & mask_]));
+            head_.store(head + 1, std::memory_order_release);
+            return value;
+        }
+
+        /**
+         * @brief Removes the oldest element, blocking until one is pushed or the timeout expires. Consumer only.
+         * @param timeout Maximum time to wait for an element.
+         * @return The element or nothing if the timeout expired first.
+         */
+        template<typename Rep, typename Period>
+        std::optional<T> Pop(const std::chrono::duration<Rep, Period> &timeout)
+        {
+            if (std::optional<T> value = TryPop())
+            {
+                return value;
+            }
+
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Either the producer sees the flag and notifies under the mutex, or the new tail is seen by the check
+            // below before going to sleep, so a wakeup can't be lost.
+            waiting_.store(true, std::memory_order_seq_cst);
+            condition_.wait_until(lock, deadline, [this] {
+                return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_seq_cst);
+            });
+            waiting_.store(false, std::memory_order_relaxed);
+            lock.unlock();
+
+            return TryPop();
+        }
+
+        /**
+         * @brief Whether the queue holds no elements. Exact from the consumer, a snapshot from any other thread.
+         */
+        [[nodiscard]] bool Empty() const
+        {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Number of queued elements. Exact from the consumer, a snapshot from any other thread.
+         */
+        [[nodiscard]] std::size_t Size() const
+        {
+            const std::size_t head = head_.load(std::memory_order_acquire);
+            return tail_.load(std::memory_order_acquire) - head;
+        }
+
+    private:
+        // Keeps the indices written by each side on their own cache line so they don't false share.
+        static constexpr std::size_t kCacheLine = 64;
+
+        static std::size_t RoundUpPow2(std::size_t value)
+        {
+            std::size_t result = 1;
+            while (result < value)
+            {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        const std::size_t mask_;
+        std::unique_ptr<T[]> buffer_;
+
+        alignas(kCacheLine) std::atomic<std::size_t> head_{0}; ///< Next slot to pop, written by the consumer.
+        std::size_t tail_cache_ = 0; ///< Consumer's last view of tail_.
+
+        alignas(kCacheLine) std::atomic<std::size_t> tail_{0}; ///< Next slot to push, written by the producer.
+        std::size_t head_cache_ = 0; ///< Producer's last view of head_.
+
+        alignas(kCacheLine) std::atomic_bool waiting_{false}; ///< Set while the consumer is about to block.
+        std::mutex mutex_; ///< Only taken to sleep and to wake a sleeping consumer.
+        std::condition_variable condition_;
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file worker_pool.h
+ * @brief A fixed set of threads that split a loop between them.
+ */
+namespace sc2
+{
+    /**
+     * @class WorkerPool
+     * @brief Runs the chunks of a loop on a fixed set of threads that are kept around between loops.
+     *
+     * Meant for work that is repeated every game step, so the threads are started once instead of per step. The thread
+     * calling ParallelFor works on chunks too and only returns once every chunk is done.
+     */
+    class WorkerPool
+    {
+    public:
+        /**
+         * @brief Called with a half-open range [begin, end) of loop indices.
+         */
+        using Task = std::function<void(std::size_t begin, std::size_t end)>;
+
+        /**
+         * @brief Starts the worker threads.
+         * @param threads Total number of threads to split loops between, including the calling thread. 0 and 1 run
+         * everything on the calling thread.
+         */
+        explicit WorkerPool(std::size_t threads);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        /**
+         * @brief Number of threads loops are split between, including the calling thread.
+         */
+        [[nodiscard]] std::size_t Threads() const;
+
+        /**
+         * @brief Runs task over [0, count) in chunks of at most chunk_size indices and waits for all of them.
+         *
+         * Chunks are handed out in increasing order but may finish in any order. Not reentrant, task must not call
+         * ParallelFor on the same pool.
+         */
+        void ParallelFor(std::size_t count, std::size_t chunk_size, const Task &task);
+
+    private:
+        void WorkerThread();
+
+        // Runs chunks of the current loop until none are left.
+        void RunChunks();
+
+        std::vector<std::thread> threads_;
+
+        std::mutex mutex_;
+        std::condition_variable work_condition_;
+        std::condition_variable done_condition_;
+        bool stop_ = false;
+        std::size_t generation_ = 0; ///< Incremented for every loop so the workers can tell a new one started.
+
+        const Task *task_ = nullptr;
+        std::size_t count_ = 0;
+        std::size_t chunk_size_ = 0;
+        std::size_t chunks_ = 0;
+        std::size_t next_chunk_ = 0;
+        std::size_t chunks_done_ = 0;
+    };
+}
@@ -7,72 +7,23 @@
 #include "sc2api/sc2_game_settings.h"
 
 #include "sc2utils/platform.h"
+#include "sc2utils/worker_pool.h"
 
 #include <iostream>
 #include <limits>
 #include <cstdint>
 #include <algorithm>
+#include <bit>
 #include <iostream>
 #include <unordered_map>
 #include <cassert>
 #include <limits>
 #include <fstream>
+#include <chrono>
 
 #include "s2clientprotocol/sc2api.pb.h"
 #include "sc2utils/sc2_utils.h"
-
-namespace {
-
-struct MapState {
-    explicit MapState(const SC2APIProtocol::MapState& map);
-
-    bool HasCreep(const sc2::Point2D& point) const;
-
-    sc2::Visibility GetVisibility(const sc2::Point2D& point) const;
-
-private:
-    sc2::SampleImage creep_data_;
-    sc2::SampleImage visibility_data_;
-};
-
-MapState::MapState(const SC2APIProtocol::MapState& map):
-    creep_data_(map.creep()), visibility_data_(map.visibility()) {
-}
-
-bool MapState::HasCreep(const sc2::Point2D& point) const {
-    if (creep_data_.BPP() == 1) {
-        bool value;
-        if (!creep_data_.GetBit(point, &value))
-            return false;
-
-        return value;
-    }
-
-    unsigned char value;
-    if (!creep_data_.GetBit(point, &value))
-        return false;
-
-    return value > 0;
-}
-
-sc2::Visibility MapState::GetVisibility(const sc2::Point2D& point) const {
-    unsigned char value;
-    if (!visibility_data_.GetBit(point, &value))
-        return sc2::Visibility::FullHidden;
-
-    if (value == 0)
-        return sc2::Visibility::Hidden;
-
-    if (value == 1)
-        return sc2::Visibility::Fogged;
-
-    if (value == 2)
-        return sc2::Visibility::Visible;
-
-    return sc2::Visibility::FullHidden;
-}
-
-}  // namespace
+#include <spdlog/spdlog.h>
 
 namespace sc2 {
 
@@ -89,7 +40,9 @@ public:
     uint32_t player_id_;
 
     // Game state info.
-    UnitPool unit_pool_;
+    mutable UnitPool unit_pool_;
+    std::unique_ptr<WorkerPool> conversion_workers_;
+    uint32_t conversion_mask_ = ConversionMask::All;
     uint32_t current_game_loop_;
     uint32_t previous_game_loop;
     RawActions raw_actions_;
@@ -98,12 +51,28 @@ public:
     std::vector<PowerSource> power_sources_;
     std::vector<Effect> effects_;
     std::vector<UpgradeID> upgrades_;
-    std::vector<UpgradeID> upgrades_previous_;
+    // Upgrade ids as bitsets, of this observation and of the previous one.
+    std::vector<uint64_t> upgrade_bits_;
+    std::vector<uint64_t> upgrade_bits_previous_;
     std::vector<ChatMessage> chat_;
 
+    // Lazy unit conversion. The raw units of the latest observation are kept until something asks for units.
+    bool lazy_unit_conversion_ = false;
+    mutable ObservationRawPtr pending_units_;
+    mutable uint32_t converted_game_loop_ = 0;
+    // Set when units were converted and the events found while converting have not been issued yet.
+    mutable bool unit_events_pending_ = false;
+    // Units that died in observations whose units were not converted.
+    std::vector<Tag> pending_dead_units_;
+
     // Game info.
     mutable GameInfo game_info_;
     mutable bool game_info_cached_;
+    mutable TerrainGrids terrain_grids_;
+    mutable bool terrain_grids_cached_;
+    // The creep and visibility of the latest observation are decoded the first time they are asked for.
+    mutable MapStateGrids map_state_grids_;
+    mutable ObservationRawPtr pending_map_state_;
     mutable bool use_generalized_ability_ = true;
 
     // Player data.
@@ -122,6 +91,7 @@ public:
 
     // Game data.
     mutable Abilities abilities_;
+    mutable AbilityRemapTable ability_remap_;
     mutable UnitTypes unit_types_;
     mutable Upgrades upgrade_ids_;
     mutable Buffs buff_ids_;
@@ -132,6 +102,8 @@ public:
 
     // Cached data.
     mutable bool abilities_cached_;
+    // The last ability data request failed, GetAbilityRemap does not retry it on every observation.
+    mutable bool abilities_load_failed_;
     mutable bool unit_types_cached;
     mutable bool upgrades_cached_;
     mutable bool buffs_cached_;
@@ -148,6 +120,7 @@ public:
     Units GetUnits(Filter filter) const final;
     Units GetUnits(Unit::Alliance alliance, Filter filter = {}) const final;
     const Unit* GetUnit(Tag tag) const final;
+    Units GetChangedUnits() const final;
     const RawActions& GetRawActions() const final { return raw_actions_; }
     const SpatialActions& GetFeatureLayerActions() const final { return feature_layer_actions_; };
     const SpatialActions& GetRenderedActions() const final { return rendered_actions_; }
@@ -157,6 +130,8 @@ public:
     const std::vector<UpgradeID>& GetUpgrades() const final { return upgrades_; }
     const Score& GetScore() const final { return score_; }
     const Abilities& GetAbilityData(bool force_refresh = false) const final;
+    // Loads the ability data if it isn't yet.
+    const AbilityRemapTable& GetAbilityRemap() const;
     const UnitTypes& GetUnitTypeData(bool force_refresh = false) const final;
     const Upgrades& GetUpgradeData(bool force_refresh = false) const final;
     const Buffs& GetBuffData(bool force_refresh = false) const final;
@@ -167,6 +142,8 @@ public:
     bool IsPathable(const Point2D& point) const final;
     bool IsPlacable(const Point2D& point) const final;
     float TerrainHeight(const Point2D& point) const final;
+    const TerrainGrids& GetTerrainGrids() const final;
+    const MapStateGrids& GetMapStateGrids() const final;
 
     uint32_t GetMinerals() const final { return minerals_; }
     uint32_t GetVespene() const final { return vespene_;  }
@@ -185,6 +162,11 @@ public:
     const SC2APIProtocol::Observation* GetRawObservation() const final;
 
     bool UpdateObservation();
+
+    // Converts the units of the latest observation if that was put off, events are computed against the units of the
+    // last observation that was converted.
+    void ConvertPendingUnits() const;
+    bool HasPendingUnits() const { return pending_units_.HasResponse(); }
 };
 
 ObservationImp::ObservationImp(ProtoInterface& proto, ObservationPtr& observation, ResponseObservationPtr& response, ControlInterface& control) :
@@ -200,7 +182,11 @@ ObservationImp::ObservationImp(ProtoInterface& proto, ObservationPtr& observatio
 void ObservationImp::ClearFlags() {
     player_id_ = 0;
     game_info_cached_ = false;
+    terrain_grids_cached_ = false;
+    map_state_grids_.Clear();
+    pending_map_state_.Clear();
     abilities_cached_ = false;
+    abilities_load_failed_ = false;
     unit_types_cached = false;
     upgrades_cached_ = false;
     buffs_cached_ = false;
@@ -208,6 +194,7 @@ void ObservationImp::ClearFlags() {
 }
 
 Units ObservationImp::GetUnits() const {
+    ConvertPendingUnits();
     Units units;
     unit_pool_.ForEachExistingUnit([&](Unit& unit) {
         units.push_back(&unit);
@@ -216,10 +203,17 @@ Units ObservationImp::GetUnits() const {
 }
 
 const Unit* ObservationImp::GetUnit(Tag tag) const {
+    ConvertPendingUnits();
     return unit_pool_.GetExistingUnit(tag);
 }
 
+Units ObservationImp::GetChangedUnits() const {
+    ConvertPendingUnits();
+    return unit_pool_.GetChangedUnits();
+}
+
 Units ObservationImp::GetUnits(Unit::Alliance alliance, Filter filter) const {
+    ConvertPendingUnits();
     Units units;
     unit_pool_.ForEachExistingUnit([&](Unit& unit) {
         if (unit.alliance != alliance) {
@@ -234,6 +228,7 @@ Units ObservationImp::GetUnits(Unit::Alliance alliance, Filter filter) const {
 }
 
 Units ObservationImp::GetUnits(Filter filter) const {
+    ConvertPendingUnits();
     Units units;
     unit_pool_.ForEachExistingUnit([&](Unit& unit) {
         if (!filter || filter(unit)) {
@@ -253,6 +248,8 @@ const Abilities& ObservationImp::GetAbilityData(bool force_refresh) const {
     }
 
     abilities_.clear();
+    ability_remap_.Clear();
+    abilities_load_failed_ = true;
 
     // Send a request for ability ids.
     GameRequestPtr request = proto_.MakeRequest();
@@ -266,10 +263,6 @@ const Abilities& ObservationImp::GetAbilityData(bool force_refresh) const {
     GameResponsePtr response = control_.WaitForResponse();
     ResponseDataPtr response_data;
     SET_MESSAGE_RESPONSE(response_data, response, data);
-    if (response_data.HasErrors()) {
-        return abilities_;
-    }
-
     if (response_data.HasErrors() || response_data->abilities_size() == 0) {
         return abilities_;
     }
@@ -295,10 +288,20 @@ const Abilities& ObservationImp::GetAbilityData(bool force_refresh) const {
         abilities_[ability_data.remaps_to_ability_id].remaps_from_ability_id.push_back(ability_data.ability_id);
     }
 
+    ability_remap_.Build(abilities_);
     abilities_cached_ = true;
+    abilities_load_failed_ = false;
     return abilities_;
 }
 
+const AbilityRemapTable& ObservationImp::GetAbilityRemap() const {
+    // After a failed load the table stays empty and ids pass through, GetAbilityData(true) tries again.
+    if (!abilities_cached_ && !abilities_load_failed_) {
+        GetAbilityData();
+    }
+    return ability_remap_;
+}
+
 const UnitTypes& ObservationImp::GetUnitTypeData(bool force_refresh) const {
     if (force_refresh || unit_types_.size() < 1) {
         unit_types_cached = false;
@@ -488,40 +491,51 @@ const GameInfo& ObservationImp::GetGameInfo() const {
 }
 
 bool ObservationImp::HasCreep(const Point2D& point) const {
-    ObservationRawPtr observation_raw;
-    SET_SUBMESSAGE_RESPONSE(observation_raw, observation_, raw_data);
-    if (observation_raw.HasErrors()) {
-        return false;
-    }
-
-    return MapState(observation_raw->map_state()).HasCreep(point);
+    return GetMapStateGrids().HasCreep(point);
 }
 
 Visibility ObservationImp::GetVisibility(const Point2D& point) const {
-    ObservationRawPtr observation_raw;
-    SET_SUBMESSAGE_RESPONSE(observation_raw, observation_, raw_data);
-    if (observation_raw.HasErrors()) {
-        return Visibility::FullHidden;
-    }
-
-    return MapState(observation_raw->map_state()).GetVisibility(point);
+    return GetMapStateGrids().GetVisibility(point);
 }
 
 bool ObservationImp::IsPathable(const Point2D& point) const {
-    return PathingGrid(GetGameInfo()).IsPathable(point);
+    return GetTerrainGrids().IsPathable(point);
 }
 
 bool ObservationImp::IsPlacable(const Point2D& point) const {
-    return PlacementGrid(GetGameInfo()).IsPlacable(point);
+    return GetTerrainGrids().IsPlacable(point);
 }
 
 float ObservationImp::TerrainHeight(const Point2D& point) const {
-    return HeightMap(GetGameInfo()).TerrainHeight(point);
+    return GetTerrainGrids().TerrainHeight(point);
+}
+
+const MapStateGrids& ObservationImp::GetMapStateGrids() const {
+    if (pending_map_state_.HasResponse()) {
+        map_state_grids_.Update(pending_map_state_->map_state());
+        pending_map_state_.Clear();
+    }
+    return map_state_grids_;
+}
+
+const TerrainGrids& ObservationImp::GetTerrainGrids() const {
+    if (terrain_grids_cached_) {
+        return terrain_grids_;
+    }
+
+    const GameInfo& game_info = GetGameInfo();
+    if (!game_info_cached_) {
+        return terrain_grids_;
+    }
+
+    terrain_grids_ = TerrainGrids(game_info);
+    terrain_grids_cached_ = true;
+    return terrain_grids_;
 }
 
 bool ObservationImp::UpdateObservation() {
     // Convert observation into data.
-    if (!Convert(observation_, score_)) {
+    if ((conversion_mask_ & ConversionMask::Score) && !Convert(observation_, score_)) {
         return false;
     }
 
@@ -559,46 +573,71 @@ bool ObservationImp::UpdateObservation() {
     ConvertFeatureLayerActions(response_, feature_layer_actions_);
     ConvertRenderedActions(response_, rendered_actions_);
 
-    // Remap ability ids.
-    {
+    // Remap ability ids. The table is only loaded when there is an id to remap, and it is loaded here rather than by a
+    // conversion that runs later from a const getter.
+    bool has_orders = false;
+    if (use_generalized_ability_ && observation_->has_raw_data()) {
+        for (const SC2APIProtocol::Unit& unit : observation_->raw_data().units()) {
+            if (unit.orders_size() > 0) {
+                has_orders = true;
+                break;
+            }
+        }
+    }
+    if (has_orders || !raw_actions_.empty() || !feature_layer_actions_.unit_commands.empty() ||
+        !rendered_actions_.unit_commands.empty()) {
+        const AbilityRemapTable& ability_remap = GetAbilityRemap();
         for (ActionRaw& action : raw_actions_) {
-            action.ability_id = GetGeneralizedAbilityID(action.ability_id, *this);
+            action.ability_id = ability_remap.Remap(action.ability_id);
         }
         for (SpatialUnitCommand& spatial_action : feature_layer_actions_.unit_commands) {
-            spatial_action.ability_id = GetGeneralizedAbilityID(spatial_action.ability_id, *this);
+            spatial_action.ability_id = ability_remap.Remap(spatial_action.ability_id);
         }
         for (SpatialUnitCommand& spatial_action : rendered_actions_.unit_commands) {
-            spatial_action.ability_id = GetGeneralizedAbilityID(spatial_action.ability_id, *this);
+            spatial_action.ability_id = ability_remap.Remap(spatial_action.ability_id);
         }
     }
 
     chat_.clear();
-    for (auto& message : response_->chat()) {
-        chat_.push_back({message.player_id(), message.message()});
+    if (conversion_mask_ & ConversionMask::Chat) {
+        for (auto& message : response_->chat()) {
+            chat_.push_back({message.player_id(), message.message()});
+        }
     }
 
     ObservationRawPtr observation_raw;
     SET_SUBMESSAGE_RESPONSE(observation_raw, observation_, raw_data);
     if (observation_raw.HasErrors()) {
+        map_state_grids_.Clear();
+        pending_map_state_.Clear();
         return false;
     }
-    
-    unit_pool_.ClearExisting();
-    Convert(observation_raw, unit_pool_, current_game_loop_, previous_game_loop);
 
-    // Remap ability ids in orders.
-    unit_pool_.ForEachExistingUnit([&](Unit& unit) {
-        for (UnitOrder& unit_order : unit.orders) {
-            if (use_generalized_ability_) {
-                unit_order.ability_id = GetGeneralizedAbilityID(unit_order.ability_id, *this);
+    if (is_new_frame) {
+        pending_map_state_ = observation_raw;
+    }
+    
+    // Recycle here rather than when the units are converted, which may happen in a getter during the step, so units
+    // handed out during a step keep their address until the next observation.
+    unit_pool_.RecycleDeadUnits(current_game_loop_);
+    pending_units_ = observation_raw;
+    if (lazy_unit_conversion_) {
+        if (is_new_frame && observation_raw->has_event()) {
+            for (Tag tag : observation_raw->event().dead_units()) {
+                pending_dead_units_.push_back(tag);
             }
         }
-    });
+    }
+    else {
+        ConvertPendingUnits();
+    }
 
     effects_.clear();
-    effects_.resize(observation_raw->effects_size());
-    for (int i = 0; i < observation_raw->effects_size(); ++i) {
-        effects_[i].ReadFromProto(observation_raw->effects(i));
+    if (conversion_mask_ & ConversionMask::Effects) {
+        effects_.resize(observation_raw->effects_size());
+        for (int i = 0; i < observation_raw->effects_size(); ++i) {
+            effects_[i].ReadFromProto(observation_raw->effects(i));
+        }
     }
 
     if (!observation_raw->has_player()) {
@@ -614,16 +653,27 @@ bool ObservationImp::UpdateObservation() {
     camera_pos_.y = player_raw.camera().y();
 
     power_sources_.clear();
-    for (int i = 0, e = player_raw.power_sources_size(); i < e; ++i) {
-        const SC2APIProtocol::PowerSource& power_source = player_raw.power_sources(i);
-        power_sources_.push_back(
-            PowerSource(Point2D(power_source.pos().x(), power_source.pos().y()), power_source.radius(), power_source.tag()));
+    if (conversion_mask_ & ConversionMask::PowerSources) {
+        for (int i = 0, e = player_raw.power_sources_size(); i < e; ++i) {
+            const SC2APIProtocol::PowerSource& power_source = player_raw.power_sources(i);
+            power_sources_.push_back(
+                PowerSource(Point2D(power_source.pos().x(), power_source.pos().y()), power_source.radius(), power_source.tag()));
+        }
     }
 
-    upgrades_previous_ = upgrades_;
-    upgrades_.clear();
-    for (int i = 0; i < player_raw.upgrade_ids_size(); ++i) {
-        upgrades_.push_back(player_raw.upgrade_ids(i));
+    upgrade_bits_previous_.swap(upgrade_bits_);
+    std::fill(upgrade_bits_.begin(), upgrade_bits_.end(), 0);
+    for (uint32_t upgrade_id : player_raw.upgrade_ids()) {
+        if (upgrade_id / 64 >= upgrade_bits_.size()) {
+            upgrade_bits_.resize(upgrade_id / 64 + 1, 0);
+        }
+        upgrade_bits_[upgrade_id / 64] |= uint64_t(1) << (upgrade_id % 64);
+    }
+    if (upgrade_bits_ != upgrade_bits_previous_) {
+        upgrades_.clear();
+        for (int i = 0; i < player_raw.upgrade_ids_size(); ++i) {
+            upgrades_.push_back(player_raw.upgrade_ids(i));
+        }
     }
 
     player_results_.clear();
@@ -634,6 +684,27 @@ bool ObservationImp::UpdateObservation() {
     return true;
 }
 
+void ObservationImp::ConvertPendingUnits() const {
+    if (!pending_units_.HasResponse()) {
+        return;
+    }
+    ObservationRawPtr observation_raw = pending_units_;
+    pending_units_.Clear();
+
+    unit_pool_.ClearExisting();
+    // Orders are generalized during the conversion, so they compare equal to the ones from the previous step.
+    UnitConversionOptions conversion_options;
+    // UpdateObservation already fetched the ability data to remap the actions, a getter must not send a request.
+    conversion_options.ability_remap = use_generalized_ability_ ? &ability_remap_ : nullptr;
+    conversion_options.workers = conversion_workers_.get();
+    conversion_options.mask = conversion_mask_;
+    // Compared against the last converted observation rather than the previous one, which may have been skipped.
+    uint32_t previous_converted_game_loop = lazy_unit_conversion_ ? converted_game_loop_ : previous_game_loop;
+    Convert(observation_raw, unit_pool_, current_game_loop_, previous_converted_game_loop, conversion_options);
+    converted_game_loop_ = current_game_loop_;
+    unit_events_pending_ = true;
+}
+
 const SC2APIProtocol::Observation* ObservationImp::GetRawObservation() const {
     return observation_.get();
 }
@@ -659,6 +730,23 @@ public:
 
     bool Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit = nullptr) final;
     std::vector<bool> Placement(const std::vector<PlacementQuery>& queries) final;
+
+    AsyncResult<std::vector<AvailableAbilities>> GetAbilitiesForUnitsAsync(const Units& units, bool ignore_resource_requirements, bool use_generalized_ability_id = true) final;
+    AsyncResult<std::vector<float>> PathingDistanceAsync(const std::vector<PathingQuery>& queries) final;
+    AsyncResult<std::vector<bool>> PlacementAsync(const std::vector<PlacementQuery>& queries) final;
+
+    // Wraps the response to the request that was just sent, parse converts it once it has been received.
+    template<typename T>
+    AsyncResult<T> AwaitResponse(std::function<T(const GameResponsePtr&)> parse, T failed);
+
+    // Build and send the queries, the blocking calls then wait for the response directly and the async ones defer it.
+    bool SendAbilitiesQuery(const Units& units, bool ignore_resource_requirements);
+    bool SendPathingQuery(const std::vector<PathingQuery>& queries);
+    bool SendPlacementQuery(const std::vector<PlacementQuery>& queries);
+
+    std::vector<AvailableAbilities> ParseAbilities(const GameResponsePtr& response, const Units& units, bool use_generalized_ability_id);
+    std::vector<float> ParsePathingDistances(const GameResponsePtr& response, std::size_t count);
+    std::vector<bool> ParsePlacements(const GameResponsePtr& response, std::size_t count);
 };
 
 QueryImp::QueryImp(ProtoInterface& proto, ControlInterface& control, ObservationInterface& observation) :
@@ -676,30 +764,46 @@ AvailableAbilities QueryImp::GetAbilitiesForUnit(const Unit* unit, bool ignore_r
     return available_abilities[0];
 }
 
-std::vector<AvailableAbilities> QueryImp::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements, bool use_generalized_ability_id) {
-    std::vector<AvailableAbilities> available_abilities_out;
-
-    // Make the request.
-    {
-        if (units.empty()) {
-            return available_abilities_out;
-        }
-
-        GameRequestPtr request = proto_.MakeRequest();
-        SC2APIProtocol::RequestQuery* query = request->mutable_query();
-        query->set_ignore_resource_requirements(ignore_resource_requirements);
-        for (const auto unit : units) {
-            SC2APIProtocol::RequestQueryAvailableAbilities* request_abilities = query->add_abilities();
-            request_abilities->set_unit_tag(unit->tag);
-        }
+template<typename T>
+AsyncResult<T> QueryImp::AwaitResponse(std::function<T(const GameResponsePtr&)> parse, T failed) {
+    const uint64_t request_number = proto_.GetLastRequestNumber();
+    return AsyncResult<T>(
+        [this, request_number]() {
+            return proto_.GetResponsesConsumed() + 1 == request_number && proto_.PollResponse();
+        },
+        [this, request_number, parse = std::move(parse), failed = std::move(failed)]() -> T {
+            // Responses of earlier results that were dropped may still be in the way.
+            proto_.DrainDiscardedResponses();
+            if (proto_.GetResponsesConsumed() >= request_number) {
+                // Nothing left to wait for, the connection was dropped while an earlier response was outstanding.
+                return failed;
+            }
+            if (proto_.GetResponsesConsumed() + 1 != request_number) {
+                // Waiting now would hand this query the response to an earlier request.
+                control_.Error(ClientError::ResponseNotConsumed);
+                return failed;
+            }
+            return parse(control_.WaitForResponse());
+        },
+        [this, request_number]() {
+            proto_.DiscardResponse(request_number);
+        });
+}
 
-        if (!proto_.SendRequest(request)) {
-            return available_abilities_out;
-        }
+bool QueryImp::SendAbilitiesQuery(const Units& units, bool ignore_resource_requirements) {
+    GameRequestPtr request = proto_.MakeRequest();
+    SC2APIProtocol::RequestQuery* query = request->mutable_query();
+    query->set_ignore_resource_requirements(ignore_resource_requirements);
+    for (const auto unit : units) {
+        SC2APIProtocol::RequestQueryAvailableAbilities* request_abilities = query->add_abilities();
+        request_abilities->set_unit_tag(unit->tag);
     }
 
-    // Process the response.
-    GameResponsePtr response = control_.WaitForResponse();
+    return proto_.SendRequest(request);
+}
+
+std::vector<AvailableAbilities> QueryImp::ParseAbilities(const GameResponsePtr& response, const Units& units, bool use_generalized_ability_id) {
+    std::vector<AvailableAbilities> available_abilities_out;
     if (!response.get()) {
         return available_abilities_out;
     }
@@ -738,6 +842,24 @@ std::vector<AvailableAbilities> QueryImp::GetAbilitiesForUnits(const Units& unit
     return available_abilities_out;
 }
 
+std::vector<AvailableAbilities> QueryImp::GetAbilitiesForUnits(const Units& units, bool ignore_resource_requirements, bool use_generalized_ability_id) {
+    if (units.empty() || !SendAbilitiesQuery(units, ignore_resource_requirements)) {
+        return std::vector<AvailableAbilities>();
+    }
+    return ParseAbilities(control_.WaitForResponse(), units, use_generalized_ability_id);
+}
+
+AsyncResult<std::vector<AvailableAbilities>> QueryImp::GetAbilitiesForUnitsAsync(const Units& units, bool ignore_resource_requirements, bool use_generalized_ability_id) {
+    if (units.empty() || !SendAbilitiesQuery(units, ignore_resource_requirements)) {
+        return AsyncResult<std::vector<AvailableAbilities>>(std::vector<AvailableAbilities>());
+    }
+
+    auto parse = [this, units, use_generalized_ability_id](const GameResponsePtr& response) {
+        return ParseAbilities(response, units, use_generalized_ability_id);
+    };
+    return AwaitResponse<std::vector<AvailableAbilities>>(parse, std::vector<AvailableAbilities>());
+}
+
 float QueryImp::PathingDistance(const Point2D& start, const Point2D& end) {
     std::vector<PathingQuery> queries;
 
@@ -762,7 +884,7 @@ float QueryImp::PathingDistance(const Unit* start_unit, const Point2D& end) {
     return distances[0];
 }
 
-std::vector<float> QueryImp::PathingDistance(const std::vector<PathingQuery>& queries) {
+bool QueryImp::SendPathingQuery(const std::vector<PathingQuery>& queries) {
     GameRequestPtr request = proto_.MakeRequest();
     SC2APIProtocol::RequestQuery* request_query = request->mutable_query();
 
@@ -781,23 +903,22 @@ std::vector<float> QueryImp::PathingDistance(const std::vector<PathingQuery>& qu
         endPos->set_y(query.end_.y);
     }
 
-    if (!proto_.SendRequest(request)) {
-        return std::vector<float>(queries.size(), 0.0f);
-    }
+    return proto_.SendRequest(request);
+}
 
-    GameResponsePtr response = control_.WaitForResponse();
+std::vector<float> QueryImp::ParsePathingDistances(const GameResponsePtr& response, std::size_t count) {
     ResponseQueryPtr response_query;
     SET_MESSAGE_RESPONSE(response_query, response, query);
     if (response_query.HasErrors()) {
-        return std::vector<float>(queries.size(), 0.0f);
+        return std::vector<float>(count, 0.0f);
     }
 
-    if (response_query->pathing_size() != queries.size()) {
-        return std::vector<float>(queries.size(), 0.0f);
+    if (response_query->pathing_size() != count) {
+        return std::vector<float>(count, 0.0f);
     }
 
     std::vector<float> distances;
-    distances.reserve(queries.size());
+    distances.reserve(count);
 
     for (int i = 0; i < response_query->pathing_size(); ++i) {
         const SC2APIProtocol::ResponseQueryPathing& result = response_query->pathing(i);
@@ -808,6 +929,25 @@ std::vector<float> QueryImp::PathingDistance(const std::vector<PathingQuery>& qu
     return distances;
 }
 
+std::vector<float> QueryImp::PathingDistance(const std::vector<PathingQuery>& queries) {
+    if (!SendPathingQuery(queries)) {
+        return std::vector<float>(queries.size(), 0.0f);
+    }
+    return ParsePathingDistances(control_.WaitForResponse(), queries.size());
+}
+
+AsyncResult<std::vector<float>> QueryImp::PathingDistanceAsync(const std::vector<PathingQuery>& queries) {
+    const std::size_t count = queries.size();
+    if (!SendPathingQuery(queries)) {
+        return AsyncResult<std::vector<float>>(std::vector<float>(count, 0.0f));
+    }
+
+    auto parse = [this, count](const GameResponsePtr& response) {
+        return ParsePathingDistances(response, count);
+    };
+    return AwaitResponse<std::vector<float>>(parse, std::vector<float>(count, 0.0f));
+}
+
 bool QueryImp::Placement(const AbilityID& ability, const Point2D& target_pos, const Unit* unit) {
     std::vector<PlacementQuery> queries;
 
@@ -821,7 +961,7 @@ bool QueryImp::Placement(const AbilityID& ability, const Point2D& target_pos, co
     return results[0];
 }
 
-std::vector<bool> QueryImp::Placement(const std::vector<PlacementQuery>& queries) {
+bool QueryImp::SendPlacementQuery(const std::vector<PlacementQuery>& queries) {
     GameRequestPtr request = proto_.MakeRequest();
     SC2APIProtocol::RequestQuery* request_query = request->mutable_query();
 
@@ -836,23 +976,22 @@ std::vector<bool> QueryImp::Placement(const std::vector<PlacementQuery>& queries
         target->set_y(query.target_pos.y);
     }
 
-    if (!proto_.SendRequest(request)) {
-        return std::vector<bool>(queries.size() ,false);
-    }
+    return proto_.SendRequest(request);
+}
 
-    GameResponsePtr response = control_.WaitForResponse();
+std::vector<bool> QueryImp::ParsePlacements(const GameResponsePtr& response, std::size_t count) {
     ResponseQueryPtr response_query;
     SET_MESSAGE_RESPONSE(response_query, response, query);
     if (response_query.HasErrors()) {
-        return std::vector<bool>(queries.size() ,false);
+        return std::vector<bool>(count, false);
     }
 
-    if (response_query->placements_size() != queries.size()) {
-        return std::vector<bool>(queries.size() ,false);
+    if (response_query->placements_size() != count) {
+        return std::vector<bool>(count, false);
     }
 
     std::vector<bool> results;
-    results.reserve(queries.size());
+    results.reserve(count);
 
     for (int i = 0; i < response_query->placements_size(); ++i) {
         const SC2APIProtocol::ResponseQueryBuildingPlacement& result = response_query->placements(i);
@@ -862,6 +1001,25 @@ std::vector<bool> QueryImp::Placement(const std::vector<PlacementQuery>& queries
     return results;
 }
 
+std::vector<bool> QueryImp::Placement(const std::vector<PlacementQuery>& queries) {
+    if (!SendPlacementQuery(queries)) {
+        return std::vector<bool>(queries.size(), false);
+    }
+    return ParsePlacements(control_.WaitForResponse(), queries.size());
+}
+
+AsyncResult<std::vector<bool>> QueryImp::PlacementAsync(const std::vector<PlacementQuery>& queries) {
+    const std::size_t count = queries.size();
+    if (!SendPlacementQuery(queries)) {
+        return AsyncResult<std::vector<bool>>(std::vector<bool>(count, false));
+    }
+
+    auto parse = [this, count](const GameResponsePtr& response) {
+        return ParsePlacements(response, count);
+    };
+    return AwaitResponse<std::vector<bool>>(parse, std::vector<bool>(count, false));
+}
+
 
 //-------------------------------------------------------------------------------------------------
 // DebugImp: An implementation of DebugInterface.
@@ -1414,6 +1572,8 @@ public:
     bool HasResponsePending() const override;
 
     bool GetObservation() override;
+    bool RequestObservation() override;
+    bool WaitObservation() override;
     bool PollResponse() override;
     bool ConsumeResponse() override;
 
@@ -1443,6 +1603,12 @@ public:
     void ClearProtocolErrors() override { protocol_errors_.clear(); };
     void UseGeneralizedAbility(bool value) override { observation_imp_->use_generalized_ability_ = value; };
 
+    void SetUnitRecycleDelay(uint32_t game_loops) override { observation_imp_->unit_pool_.SetRecycleDelay(game_loops); };
+    void SetConversionThreads(size_t threads) override;
+    void SetConversionMask(uint32_t mask) override { observation_imp_->conversion_mask_ = mask; };
+    void SetLazyUnitConversion(bool value) override;
+    UnitPoolStats GetUnitPoolStats() const override { return observation_imp_->unit_pool_.GetStats(); };
+
     void Save() override;
     void Load() override;
 };
@@ -1469,35 +1635,52 @@ ProtoInterface& ControlImp::Proto() {
 }
 
 bool ControlImp::Connect(const std::string& address, int port, int timeout_ms) {
-    // Keep retrying the connection until the timeout is hit.
-    bool connected = false;
-    unsigned int timeout_seconds = ((unsigned int)timeout_ms + 1500) / 1000;
-    if (timeout_seconds < 1) {
-        timeout_seconds = 1;
-    }
+    // Keep retrying the connection until the timeout is hit. The game usually opens its port shortly after launch,
+    // so start with a short delay between attempts and back off exponentially up to a second.
+    static const unsigned int kMinRetryDelayMs = 5;
+    static const unsigned int kMaxRetryDelayMs = 1000;
 
+    bool connected = false;
+    unsigned int retry_delay_ms = kMinRetryDelayMs;
+    unsigned int attempts = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(std::max(timeout_ms, 1000));
 
-    for (unsigned int count_seconds = 0; count_seconds < timeout_seconds; ++count_seconds) {
+    for (;;) {
+        ++attempts;
         if (proto_.ConnectToGame(address, port, timeout_ms)) {
             connected = true;
             break;
         }
-        SleepFor(1000);
 
-        if (count_seconds == 0) {
+        if (std::chrono::steady_clock::now() + std::chrono::milliseconds(retry_delay_ms) >= deadline) {
+            break;
+        }
+
+        if (attempts == 1) {
             std::cout << "Waiting for connection";
         } else {
             std::cout << ".";
         }
+
+        SleepFor(retry_delay_ms);
+        retry_delay_ms = std::min(retry_delay_ms * 2, kMaxRetryDelayMs);
+    }
+    if (attempts > 1) {
+        std::cout << std::endl;
     }
-    std::cout << std::endl;
 
     if (!connected) {
+        // Individual attempts only log at trace level, report the attempt that gives up.
+        SPDLOG_ERROR("[CLIENT] Failed to connect to {}:{} after {} attempts", address, port, attempts);
         std::cerr << "Unable to connect to game" << std::endl;
         return false;
     }
 
-    std::cout << "Connected to " << address << ":" << port << std::endl;
+    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "Connected to " << address << ":" << port << " in " << elapsed_ms.count() << " ms ("
+        << attempts << (attempts == 1 ? " attempt" : " attempts") << ", websocket handshake "
+        << proto_.GetConnectLatency().count() / 1000.0 << " ms)" << std::endl;
 
     return true;
 }
@@ -1952,15 +2135,19 @@ bool ControlImp::HasResponsePending() const {
 }
 
 bool ControlImp::GetObservation() {
+    return RequestObservation() && WaitObservation();
+}
+
+bool ControlImp::RequestObservation() {
     if (app_state_ != AppState::normal)
         return false;
 
     GameRequestPtr request = proto_.MakeRequest();
     request->mutable_observation();
-    if (!proto_.SendRequest(request)) {
-        return false;
-    }
+    return proto_.SendRequest(request);
+}
 
+bool ControlImp::WaitObservation() {
     GameResponsePtr response = WaitForResponse();
     ResponseObservationPtr response_observation;
     SET_MESSAGE_RESPONSE(response_observation, response, observation);
@@ -2033,7 +2220,42 @@ bool ControlImp::ConsumeResponse() {
     return true;
 }
 
+void ControlImp::SetConversionThreads(size_t threads) {
+    if (threads > 1) {
+        if (!observation_imp_->conversion_workers_ || observation_imp_->conversion_workers_->Threads() != threads) {
+            observation_imp_->conversion_workers_ = std::make_unique<WorkerPool>(threads);
+        }
+    }
+    else {
+        observation_imp_->conversion_workers_.reset();
+    }
+}
+
+void ControlImp::SetLazyUnitConversion(bool value) {
+    observation_imp_->lazy_unit_conversion_ = value;
+    if (!value) {
+        // Nothing may stay behind, eager conversion reads dead units straight from each observation.
+        observation_imp_->ConvertPendingUnits();
+        observation_imp_->pending_dead_units_.clear();
+    }
+}
+
 void ControlImp::IssueUnitDestroyedEvents() {
+    if (observation_imp_->lazy_unit_conversion_) {
+        for (Tag tag : observation_imp_->pending_dead_units_) {
+            const Unit* unit = observation_imp_->unit_pool_.GetUnit(tag);
+
+            if (!unit) {
+                continue;
+            }
+
+            observation_imp_->unit_pool_.MarkDead(tag);
+            client_.OnUnitDestroyed(unit);
+        }
+        observation_imp_->pending_dead_units_.clear();
+        return;
+    }
+
     if (!observation_->has_raw_data()) {
         return;
     }
@@ -2105,33 +2327,37 @@ void ControlImp::IssueBuildingCompletedEvents() {
 }
 
 void ControlImp::IssueAlertEvents() {
-    // Iterate the alerts and issue relevant events.
+    if (observation_->alerts().empty()) {
+        return;
+    }
+
+    // An alert repeated within one observation is only issued once.
+    uint64_t alerts = 0;
     for (const auto alert : observation_->alerts()) {
-        switch (alert) {
-            case SC2APIProtocol::Alert::NuclearLaunchDetected: {
-                client_.OnNuclearLaunchDetected();
-                break;
-            }
-            case SC2APIProtocol::Alert::NydusWormDetected: {
-                client_.OnNydusDetected();
-                break;
-            }
-            default: {
-                break;
-            }
+        if (alert >= 0 && alert < 64) {
+            alerts |= uint64_t(1) << alert;
         }
     }
-}
 
-void ControlImp::IssueUpgradeEvents() {
-    std::set<uint32_t> previous;
-    for (auto up : observation_imp_->upgrades_previous_) {
-        previous.insert(up);
+    if (alerts & (uint64_t(1) << SC2APIProtocol::Alert::NuclearLaunchDetected)) {
+        client_.OnNuclearLaunchDetected();
+    }
+    if (alerts & (uint64_t(1) << SC2APIProtocol::Alert::NydusWormDetected)) {
+        client_.OnNydusDetected();
     }
+}
 
-    for (auto up : observation_imp_->upgrades_) {
-        if (previous.find(up) == previous.end()) {
-            client_.OnUpgradeCompleted(up);
+void ControlImp::IssueUpgradeEvents() {
+    const std::vector<uint64_t>& current = observation_imp_->upgrade_bits_;
+    const std::vector<uint64_t>& previous = observation_imp_->upgrade_bits_previous_;
+    for (size_t word = 0; word < current.size(); ++word) {
+        uint64_t previous_word = word < previous.size() ? previous[word] : 0;
+        // Bits that changed and are set now are upgrades completed since the previous observation.
+        uint64_t completed = (current[word] ^ previous_word) & current[word];
+        while (completed) {
+            int bit = std::countr_zero(completed);
+            completed &= completed - 1;
+            client_.OnUpgradeCompleted(UpgradeID(static_cast<uint32_t>(word * 64 + bit)));
         }
     }
 }
@@ -2141,13 +2367,36 @@ bool ControlImp::IssueEvents(const Tags& commands) {
         return false;
     }
 
+    // With lazy conversion, units that died have to be converted so they can be handed to OnUnitDestroyed. Events of
+    // an earlier conversion, e.g. one done by GetUnits in the previous OnStep, go out before they are replaced.
+    if (!observation_imp_->pending_dead_units_.empty() && observation_imp_->HasPendingUnits()) {
+        if (observation_imp_->unit_events_pending_) {
+            IssueUnitAddedEvents();
+            IssueBuildingCompletedEvents();
+            IssueIdleEvents({});
+            IssueUnitDamagedEvents();
+        }
+        observation_imp_->ConvertPendingUnits();
+    }
+
+    // Unit events are only known for observations whose units were converted.
+    bool unit_events = observation_imp_->unit_events_pending_;
+    observation_imp_->unit_events_pending_ = false;
+    // The commands were issued after the previous observation, so only the current one tells whether a commanded unit
+    // went idle. An earlier conversion still shows the orders the commands were meant to change.
+    bool current_units = observation_imp_->converted_game_loop_ == observation_imp_->current_game_loop_;
+
     IssueUnitDestroyedEvents();
-    IssueUnitAddedEvents();
-    IssueBuildingCompletedEvents();
-    IssueIdleEvents(commands);
+    if (unit_events) {
+        IssueUnitAddedEvents();
+        IssueBuildingCompletedEvents();
+        IssueIdleEvents(current_units ? commands : Tags());
+    }
     IssueUpgradeEvents();
     IssueAlertEvents();
-    IssueUnitDamagedEvents();
+    if (unit_events) {
+        IssueUnitDamagedEvents();
+    }
 
     // Run the users OnStep function after events have been issued.
     client_.OnStep();
@@ -2206,6 +2455,23 @@ void ControlImp::DumpProtoUsage() {
         std::cout << std::to_string(i) << ": " << std::to_string(stats[i]) << std::endl;
     }
 
+    const ProtoStats& request_stats = proto_.GetRequestStats();
+    std::cout << "Round trips by message type (us):" << std::endl;
+    for (std::size_t i = 0; i < request_stats.Size(); ++i) {
+        const RequestStats& request = request_stats.Get(static_cast<int>(i));
+        if (request.responses == 0)
+            continue;
+
+        std::cout << RequestResponseIDToName(static_cast<int>(i))
+            << ": p50 " << request.latency.Percentile(50.0).count()
+            << ", p99 " << request.latency.Percentile(99.0).count()
+            << ", max " << request.latency.Max().count()
+            << ", parse p50 " << request.parse_time.Percentile(50.0).count()
+            << ", avg response " << request.response_bytes / request.responses << " bytes" << std::endl;
+    }
+
+    std::cout << "Pending requests: " << proto_.GetPendingRequestDepth()
+        << " (max " << proto_.GetMaxPendingRequestDepth() << ", pipelined " << (proto_.IsPipelined() ? "on" : "off") << ")" << std::endl;
     std::cout << "******************************************************" << std::endl;
 }
 
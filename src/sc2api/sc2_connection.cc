@@ -3,21 +3,159 @@
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <optional>
 #include <IXNetSystem.h>
 #include <string>
 #include <spdlog/spdlog.h>
 
+#include <google/protobuf/arena.h>
+
 #include "s2clientprotocol/sc2api.pb.h"
-#include "sc2utils/platform.h"
 
 namespace sc2
 {
+    // Upper bound on how long a single connection attempt may take before it is abandoned.
+    static const unsigned int kConnectTimeoutMs = 30000;
+
+    // Size of the block a fresh arena starts with, enough for pings, steps and action results.
+    static const std::size_t kInitialArenaBlockSize = 64 * 1024;
+    // Arenas that grew past this size (e.g. after a replay or map download) are not kept around.
+    static const std::size_t kMaxRetainedArenaBlockSize = 64 * 1024 * 1024;
+    // Number of responses that can be queued before the websocket thread has to wait for the agent to catch up.
+    static const std::size_t kResponseQueueCapacity = 256;
+    // Number of idle arenas kept by the pool, pipelining is the only reason to need more than a couple.
+    static const std::size_t kMaxFreeArenas = 8;
+
+    struct ResponsePool::Slot
+    {
+        std::unique_ptr<char[]> block;
+        std::size_t block_size = 0;
+        std::unique_ptr<google::protobuf::Arena> arena;
+    };
+
+    ResponsePool::ResponsePool() = default;
+
+    ResponsePool::~ResponsePool() = default;
+
+    std::unique_ptr<ResponsePool::Slot> ResponsePool::CreateSlot(std::size_t block_size)
+    {
+        auto slot = std::make_unique<Slot>();
+        slot->block.reset(new char[block_size]);
+        slot->block_size = block_size;
+
+        google::protobuf::ArenaOptions options;
+        options.initial_block = slot->block.get();
+        options.initial_block_size = block_size;
+        slot->arena = std::make_unique<google::protobuf::Arena>(options);
+
+        ++stats_.arenas_created;
+        stats_.bytes_retained += block_size;
+        return slot;
+    }
+
+    SC2APIProtocol::Response *ResponsePool::Acquire()
+    {
+        google::protobuf::Arena *arena;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            ++stats_.responses;
+            if (free_.empty())
+            {
+                std::unique_ptr<Slot> slot = CreateSlot(kInitialArenaBlockSize);
+                arena = slot->arena.get();
+                slots_.emplace(arena, std::move(slot));
+            }
+            else
+            {
+                arena = free_.back()->arena.get();
+                free_.pop_back();
+            }
+        }
+
+        return google::protobuf::Arena::Create<SC2APIProtocol::Response>(arena);
+    }
+
+    void ResponsePool::Release(const SC2APIProtocol::Response *response)
+    {
+        if (!response)
+        {
+            return;
+        }
+
+        google::protobuf::Arena *arena = response->GetArena();
+        if (!arena)
+        {
+            delete response;
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto found = slots_.find(arena);
+        assert(found != slots_.end());
+        if (found == slots_.end())
+        {
+            return;
+        }
+
+        Slot *slot = found->second.get();
+        std::size_t used = static_cast<std::size_t>(arena->SpaceAllocated());
+        if (used > kMaxRetainedArenaBlockSize || free_.size() >= kMaxFreeArenas)
+        {
+            stats_.bytes_retained -= slot->block_size;
+            slots_.erase(found);
+            return;
+        }
+
+        if (used <= slot->block_size)
+        {
+            // Everything fit in the retained block, resetting keeps it.
+            arena->Reset();
+            free_.push_back(slot);
+            return;
+        }
+
+        // The response spilled into blocks allocated by the arena itself, grow the retained block so the next
+        // response of this size fits.
+        std::size_t block_size = slot->block_size;
+        while (block_size < used)
+        {
+            block_size *= 2;
+        }
+
+        stats_.bytes_retained -= slot->block_size;
+        slots_.erase(found);
+        std::unique_ptr<Slot> grown = CreateSlot(block_size);
+        ++stats_.blocks_grown;
+        free_.push_back(grown.get());
+        google::protobuf::Arena *grown_arena = grown->arena.get();
+        slots_.emplace(grown_arena, std::move(grown));
+    }
+
+    std::shared_ptr<const SC2APIProtocol::Response> ResponsePool::MakeShared(SC2APIProtocol::Response *response)
+    {
+        if (!response)
+        {
+            return nullptr;
+        }
+
+        return std::shared_ptr<const SC2APIProtocol::Response>(
+            response,
+            [pool = shared_from_this()](const SC2APIProtocol::Response *r) { pool->Release(r); });
+    }
+
+    ResponsePool::Stats ResponsePool::GetStats() const
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return stats_;
+    }
+
     Connection::Connection() : connection(),
                                verbose_(false),
-                               queue_(),
-                               mutex_(),
-                               condition_(),
-                               has_response_(false) {}
+                               queue_(kResponseQueueCapacity),
+                               stopping_(false),
+                               response_pool_(std::make_shared<ResponsePool>()),
+                               connect_state_(ConnectState::Connecting),
+                               connect_latency_(0) {}
 
 
     bool Connection::Connect(const std::string &address, int port, bool verbose)
@@ -36,16 +174,33 @@ namespace sc2
         {
             if (msg->type == ix::WebSocketMessageType::Message)
             {
-                SC2APIProtocol::Response *response = new SC2APIProtocol::Response();
+                ReceiveInfo info;
+                info.received = std::chrono::steady_clock::now();
+                info.bytes = msg->str.size();
+                recorder_.Record(ProtocolDirection::Response, msg->str.data(), msg->str.size());
+
+                SC2APIProtocol::Response *response = response_pool_->Acquire();
                 if (!response->ParseFromString(msg->str))
                 {
                     SPDLOG_WARN("[SERVER] Invalid Request: {}", msg->str);
+                    response_pool_->Release(response);
                 }
                 else
                 {
-                    PushResponse(response);
+                    info.parse_time = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - info.received);
+                    PushResponse(response, info);
                 }
             }
+            else if (msg->type == ix::WebSocketMessageType::Open)
+            {
+                SetConnectState(ConnectState::Open);
+            }
+            else if (msg->type == ix::WebSocketMessageType::Error)
+            {
+                SPDLOG_TRACE("[CLIENT] Connection error: {}", msg->errorInfo.reason);
+                SetConnectState(ConnectState::Failed);
+            }
             else if (msg->type == ix::WebSocketMessageType::Close)
             {
                 if (connection_closed_callback_)
@@ -55,30 +210,70 @@ namespace sc2
             }
         });
 
-        connection.start();
+        {
+            std::lock_guard<std::mutex> guard(connect_mutex_);
+            connect_state_ = ConnectState::Connecting;
+        }
 
-        int loop = 0;
+        auto start = std::chrono::steady_clock::now();
+        connection.start();
 
-        do
+        // Wait for the websocket thread to report the outcome of the handshake.
+        bool opened;
         {
-            SleepFor(1000);
-            ++loop;
-        } while (connection.getReadyState() == ix::ReadyState::Connecting && loop < 30);
+            std::unique_lock<std::mutex> lock(connect_mutex_);
+            connect_condition_.wait_for(
+                lock,
+                std::chrono::milliseconds(kConnectTimeoutMs),
+                [this] { return connect_state_ != ConnectState::Connecting; });
+            opened = connect_state_ == ConnectState::Open;
+        }
 
-        if (connection.getReadyState() != ix::ReadyState::Open)
+        if (!opened || connection.getReadyState() != ix::ReadyState::Open)
         {
-            SPDLOG_ERROR("[CLIENT] Failed to connect {}", static_cast<int>(connection.getReadyState()));
-            Disconnect();
+            SPDLOG_TRACE("[CLIENT] Failed to connect {}", static_cast<int>(connection.getReadyState()));
+            // Stop unconditionally, a failed attempt leaves the websocket thread running its reconnection loop.
+            connection.stop();
             return false;
         }
 
-        SPDLOG_TRACE("[CLIENT] Connected");
+        connect_latency_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        SPDLOG_TRACE("[CLIENT] Connected in {} us", connect_latency_.count());
         return true;
     }
 
+    std::chrono::microseconds Connection::GetConnectLatency() const
+    {
+        return connect_latency_;
+    }
+
+    void Connection::SetConnectState(ConnectState state)
+    {
+        {
+            std::lock_guard<std::mutex> guard(connect_mutex_);
+            // Only the first outcome of an attempt counts, automatic reconnection may report more.
+            if (connect_state_ != ConnectState::Connecting)
+            {
+                return;
+            }
+            connect_state_ = state;
+        }
+        connect_condition_.notify_all();
+    }
+
     Connection::~Connection()
     {
         Disconnect();
+
+        while (std::optional<QueuedResponse> queued = queue_.TryPop())
+        {
+            response_pool_->Release(queued->response);
+        }
+    }
+
+    const std::shared_ptr<ResponsePool> &Connection::GetResponsePool() const
+    {
+        return response_pool_;
     }
 
     void Connection::Send(const SC2APIProtocol::Request *request)
@@ -94,10 +289,16 @@ namespace sc2
             return;
         }
 
-        std::string output;
-        request->SerializeToString(&output);
+        const std::size_t size = request->ByteSizeLong();
+        if (send_buffer_.size() < size)
+        {
+            send_buffer_.resize(size);
+        }
+        request->SerializeToArray(send_buffer_.data(), static_cast<int>(size));
+        recorder_.Record(ProtocolDirection::Request, send_buffer_.data(), size);
 
-        connection.send(output, true);
+        // The send data only references the buffer, ixwebsocket frames it straight from there.
+        connection.sendBinary(ix::IXWebSocketSendData(send_buffer_.data(), size));
 
         if (verbose_)
         {
@@ -109,27 +310,25 @@ namespace sc2
         SC2APIProtocol::Response *&response,
         unsigned int timeout_ms)
     {
-        std::unique_lock<std::mutex> lock(mutex_);
         // Block until a message is recieved.
         if (verbose_)
         {
             std::cout << "Waiting for response..." << std::endl;
         }
-        auto now = std::chrono::system_clock::now();
-        if (condition_.wait_until(
-            lock,
-            now + std::chrono::milliseconds(timeout_ms),
-            [&] { return queue_.size() != 0; }))
+        if (std::optional<QueuedResponse> received = queue_.Pop(std::chrono::milliseconds(timeout_ms)))
         {
-            lock.unlock();
-            PopResponse(response);
+            response = received->response;
+            last_receive_info_ = received->info;
             return true;
         }
 
-        lock.unlock();
         response = nullptr;
         Disconnect();
-        queue_.clear();
+        // The websocket thread is stopped, nothing can be pushed while the queue is drained.
+        while (std::optional<QueuedResponse> queued = queue_.TryPop())
+        {
+            response_pool_->Release(queued->response);
+        }
 
         // Execute the timeout callback if it exists.
         if (timeout_callback_)
@@ -140,24 +339,46 @@ namespace sc2
         return false;
     }
 
-    void Connection::PushResponse(SC2APIProtocol::Response *&response)
+    void Connection::PushResponse(SC2APIProtocol::Response *&response, const ReceiveInfo &info)
     {
-        std::lock_guard<std::mutex> guard(mutex_);
-        queue_.push_back(response);
-        condition_.notify_one();
-        has_response_ = true;
+        if (!queue_.Push(QueuedResponse{response, info}, stopping_))
+        {
+            // Nobody will pop it anymore, the connection is going away.
+            response_pool_->Release(response);
+        }
     }
 
     void Connection::PopResponse(SC2APIProtocol::Response *&response)
     {
-        if (queue_.empty()) return;
-        std::lock_guard<std::mutex> guard(mutex_);
-        response = queue_.front();
-        queue_.pop_front();
-        if (queue_.empty())
+        std::optional<QueuedResponse> popped = queue_.TryPop();
+        if (!popped)
         {
-            has_response_ = false;
+            response = nullptr;
+            return;
         }
+
+        response = popped->response;
+        last_receive_info_ = popped->info;
+    }
+
+    bool Connection::StartRecording(const std::string &path)
+    {
+        return recorder_.Start(path);
+    }
+
+    void Connection::StopRecording()
+    {
+        recorder_.Stop();
+    }
+
+    bool Connection::IsRecording() const
+    {
+        return recorder_.IsRecording();
+    }
+
+    const Connection::ReceiveInfo &Connection::GetLastReceiveInfo() const
+    {
+        return last_receive_info_;
     }
 
     void Connection::SetTimeoutCallback(std::function<void()> callback)
@@ -180,12 +401,14 @@ namespace sc2
         if (connection.getReadyState() != ix::ReadyState::Closing && connection.getReadyState() != ix::ReadyState::Closed)
         {
             SPDLOG_INFO("[CLIENT] Disconnecting...");
+            stopping_ = true;
             connection.stop();
+            stopping_ = false;
         }
     }
 
     bool Connection::PollResponse()
     {
-        return has_response_;
+        return !queue_.Empty();
     }
 }
@@ -198,6 +198,10 @@ public:
     int last_port_ = 0;
 
     bool use_generalized_ability_id = true;
+    uint32_t unit_recycle_delay = kNeverRecycleUnits;
+    size_t conversion_threads = 1;
+    uint32_t conversion_mask = ConversionMask::All;
+    bool lazy_unit_conversion = false;
 };
 
 CoordinatorImp::CoordinatorImp() :
@@ -274,6 +278,10 @@ void CoordinatorImp::StartReplay() {
         }
 
         r->ReplayControl()->UseGeneralizedAbility(use_generalized_ability_id);
+        r->Control()->SetUnitRecycleDelay(unit_recycle_delay);
+        r->Control()->SetConversionThreads(conversion_threads);
+        r->Control()->SetConversionMask(conversion_mask);
+        r->Control()->SetLazyUnitConversion(lazy_unit_conversion);
 
         auto& replays = replay_settings_.replay_file;
         while (replays.size() != 0) {
@@ -602,6 +610,10 @@ bool CoordinatorImp::JoinGame() {
         }
 
         c->Control()->UseGeneralizedAbility(use_generalized_ability_id);
+        c->Control()->SetUnitRecycleDelay(unit_recycle_delay);
+        c->Control()->SetConversionThreads(conversion_threads);
+        c->Control()->SetConversionMask(conversion_mask);
+        c->Control()->SetLazyUnitConversion(lazy_unit_conversion);
     }
 
     if (errors_occurred) {
@@ -934,6 +946,26 @@ void Coordinator::SetUseGeneralizedAbilityId(bool value) {
     imp_->use_generalized_ability_id = value;
 }
 
+void Coordinator::SetUnitRecycleDelay(uint32_t game_loops) {
+    assert(!imp_->starcraft_started_);
+    imp_->unit_recycle_delay = game_loops;
+}
+
+void Coordinator::SetConversionThreads(size_t threads) {
+    assert(!imp_->starcraft_started_);
+    imp_->conversion_threads = threads;
+}
+
+void Coordinator::SetConversionMask(uint32_t mask) {
+    assert(!imp_->starcraft_started_);
+    imp_->conversion_mask = mask;
+}
+
+void Coordinator::SetLazyUnitConversion(bool value) {
+    assert(!imp_->starcraft_started_);
+    imp_->lazy_unit_conversion = value;
+}
+
 void Coordinator::SetReplayPerspective(int player_id) {
     imp_->replay_settings_.player_id = player_id;
 }
@@ -2,6 +2,7 @@
 #include "sc2api/sc2_interfaces.h"
 #include "sc2api/sc2_proto_to_pods.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 
@@ -390,4 +391,13 @@ AbilityID GetGeneralizedAbilityID(uint32_t ability_id, const ObservationInterfac
     return AbilityID(ability_id);
 }
 
+void AbilityRemapTable::Build(const Abilities& abilities) {
+    remap_.resize(std::max<size_t>(abilities.size(), 1));
+    remap_[0] = 0;
+    for (size_t i = 1; i < abilities.size(); ++i) {
+        uint32_t remaps_to = abilities[i].remaps_to_ability_id;
+        remap_[i] = remaps_to != 0 ? remaps_to : static_cast<uint32_t>(i);
+    }
+}
+
 }
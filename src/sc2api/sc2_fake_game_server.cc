@@ -0,0 +1,413 @@
+#include "sc2api/sc2_fake_game_server.h"
+#include "sc2api/sc2_protocol_recorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <spdlog/spdlog.h>
+
+#include "s2clientprotocol/sc2api.pb.h"
+
+namespace sc2
+{
+    // Tags handed to fake units start here so they look like the tags the game hands out.
+    static const uint64_t kFirstUnitTag = 0x100000001ULL;
+    // How long the serving thread waits for a request before checking whether it should stop.
+    static const unsigned int kServePollMs = 50;
+
+    // The abilities the data answer lists, enough for the client to build its ability tables once. The ids are those of
+    // ABILITY_ID, the game lists every id up to the highest one so the answer does too.
+    struct FakeAbility
+    {
+        uint32_t ability_id;
+        const char *name;
+    };
+    static const FakeAbility kFakeAbilities[] = {
+        {1, "Smart"},
+        {4, "Stop"},
+        {16, "Move"},
+        {23, "Attack"},
+    };
+
+    static void FillImage(SC2APIProtocol::ImageData *image, int width, int height, int bits_per_pixel, char value)
+    {
+        image->set_bits_per_pixel(bits_per_pixel);
+        image->mutable_size()->set_x(width);
+        image->mutable_size()->set_y(height);
+        image->set_data(std::string((static_cast<std::size_t>(width) * height * bits_per_pixel + 7) / 8, value));
+    }
+
+    FakeGameServer::FakeGameServer() : running_(false),
+                                       requests_served_(0),
+                                       game_loop_(0),
+                                       status_(SC2APIProtocol::Status::launched)
+    {
+        ResetGame();
+    }
+
+    FakeGameServer::~FakeGameServer()
+    {
+        Stop();
+    }
+
+    void FakeGameServer::SetScenario(const FakeGameScenario &scenario)
+    {
+        scenario_ = scenario;
+        ResetGame();
+    }
+
+    bool FakeGameServer::LoadTrace(const std::string &path)
+    {
+        ProtocolTraceReader reader;
+        if (!reader.Open(path))
+        {
+            return false;
+        }
+
+        trace_responses_.clear();
+        ProtocolTraceRecord record;
+        SC2APIProtocol::Response response;
+        std::size_t loaded = 0;
+        while (reader.Next(record))
+        {
+            if (record.direction != ProtocolDirection::Response || !response.ParseFromString(record.payload))
+            {
+                continue;
+            }
+
+            std::size_t response_case = static_cast<std::size_t>(response.response_case());
+            if (response_case >= trace_responses_.size())
+            {
+                trace_responses_.resize(response_case + 1);
+            }
+            trace_responses_[response_case].push_back(std::move(record.payload));
+            ++loaded;
+        }
+
+        trace_cursors_.assign(trace_responses_.size(), 0);
+        SPDLOG_INFO("[FAKE SERVER] Loaded {} responses from {}", loaded, path);
+        return loaded > 0;
+    }
+
+    bool FakeGameServer::Start(int port)
+    {
+        Stop();
+
+        server_ = std::make_unique<Server>();
+        if (!server_->Listen(port, "10000", "10000", "1"))
+        {
+            server_.reset();
+            return false;
+        }
+
+        running_ = true;
+        thread_ = std::thread(&FakeGameServer::ServeThread, this);
+        return true;
+    }
+
+    void FakeGameServer::Stop()
+    {
+        running_ = false;
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+        server_.reset();
+    }
+
+    int FakeGameServer::GetPort() const
+    {
+        return server_ ? server_->GetPort() : 0;
+    }
+
+    uint64_t FakeGameServer::GetRequestsServed() const
+    {
+        return requests_served_;
+    }
+
+    void FakeGameServer::ServeThread()
+    {
+        while (running_)
+        {
+            if (!server_->WaitForRequest(kServePollMs))
+            {
+                continue;
+            }
+
+            RequestData request = server_->PopRequest();
+            if (!request.second)
+            {
+                continue;
+            }
+
+            SC2APIProtocol::Response *response = Answer(*request.second);
+            delete request.second;
+
+            server_->QueueResponse(request.first, response);
+            server_->SendResponse(request.first);
+        }
+    }
+
+    bool FakeGameServer::AnswerFromTrace(int request_case, SC2APIProtocol::Response &response)
+    {
+        // Requests and responses share their case numbers.
+        std::size_t response_case = static_cast<std::size_t>(request_case);
+        if (response_case >= trace_responses_.size() || trace_responses_[response_case].empty())
+        {
+            return false;
+        }
+
+        const std::vector<std::string> &recorded = trace_responses_[response_case];
+        std::size_t &cursor = trace_cursors_[response_case];
+        bool parsed = response.ParseFromString(recorded[cursor]);
+        cursor = (cursor + 1) % recorded.size();
+        return parsed;
+    }
+
+    void FakeGameServer::ResetGame()
+    {
+        game_loop_ = 0;
+        units_.clear();
+
+        std::mt19937 random(scenario_.seed);
+        std::uniform_real_distribution<float> x(0.0f, static_cast<float>(scenario_.map_width));
+        std::uniform_real_distribution<float> y(0.0f, static_cast<float>(scenario_.map_height));
+        std::uniform_real_distribution<float> heading(0.0f, 6.2831853f);
+
+        uint64_t tag = kFirstUnitTag;
+        for (int owner = 1; owner <= 2; ++owner)
+        {
+            int count = owner == 1 ? scenario_.self_units : scenario_.enemy_units;
+            for (int i = 0; i < count; ++i)
+            {
+                units_.push_back({tag++, owner, x(random), y(random), heading(random)});
+            }
+        }
+    }
+
+    void FakeGameServer::AdvanceUnits(uint32_t loops)
+    {
+        const float width = static_cast<float>(scenario_.map_width);
+        const float height = static_cast<float>(scenario_.map_height);
+        const float distance = scenario_.unit_speed * static_cast<float>(loops);
+        for (FakeUnit &unit : units_)
+        {
+            unit.x += std::cos(unit.heading) * distance;
+            unit.y += std::sin(unit.heading) * distance;
+            // Turn around at the edges of the map.
+            if (unit.x < 0.0f || unit.x > width || unit.y < 0.0f || unit.y > height)
+            {
+                unit.x = std::clamp(unit.x, 0.0f, width);
+                unit.y = std::clamp(unit.y, 0.0f, height);
+                unit.heading += 3.1415927f;
+            }
+        }
+        game_loop_ += loops;
+    }
+
+    void FakeGameServer::FillGameInfo(SC2APIProtocol::Response &response) const
+    {
+        SC2APIProtocol::ResponseGameInfo *game_info = response.mutable_game_info();
+        game_info->set_map_name("Fake Game Server");
+
+        SC2APIProtocol::StartRaw *start_raw = game_info->mutable_start_raw();
+        start_raw->mutable_map_size()->set_x(scenario_.map_width);
+        start_raw->mutable_map_size()->set_y(scenario_.map_height);
+        // In the 8 bit pathing grid 0 is pathable, in the 1 bit placement grid a set bit is placeable.
+        FillImage(start_raw->mutable_pathing_grid(), scenario_.map_width, scenario_.map_height, 8, 0);
+        FillImage(start_raw->mutable_placement_grid(), scenario_.map_width, scenario_.map_height, 1, static_cast<char>(0xFF));
+        FillImage(start_raw->mutable_terrain_height(), scenario_.map_width, scenario_.map_height, 8, static_cast<char>(127));
+        start_raw->mutable_playable_area()->mutable_p0()->set_x(0);
+        start_raw->mutable_playable_area()->mutable_p0()->set_y(0);
+        start_raw->mutable_playable_area()->mutable_p1()->set_x(scenario_.map_width);
+        start_raw->mutable_playable_area()->mutable_p1()->set_y(scenario_.map_height);
+        SC2APIProtocol::Point2D *enemy_start = start_raw->add_start_locations();
+        enemy_start->set_x(static_cast<float>(scenario_.map_width) * 0.9f);
+        enemy_start->set_y(static_cast<float>(scenario_.map_height) * 0.9f);
+
+        for (int player_id = 1; player_id <= 2; ++player_id)
+        {
+            SC2APIProtocol::PlayerInfo *player = game_info->add_player_info();
+            player->set_player_id(player_id);
+            player->set_type(player_id == 1 ? SC2APIProtocol::Participant : SC2APIProtocol::Computer);
+            player->set_race_requested(SC2APIProtocol::Terran);
+            player->set_race_actual(SC2APIProtocol::Terran);
+        }
+
+        game_info->mutable_options()->set_raw(true);
+    }
+
+    void FakeGameServer::FillData(const SC2APIProtocol::RequestData &request, SC2APIProtocol::Response &response) const
+    {
+        SC2APIProtocol::ResponseData *data = response.mutable_data();
+        if (!request.ability_id())
+        {
+            return;
+        }
+
+        const FakeAbility &last = kFakeAbilities[std::size(kFakeAbilities) - 1];
+        for (uint32_t ability_id = 0; ability_id <= last.ability_id; ++ability_id)
+        {
+            SC2APIProtocol::AbilityData *ability = data->add_abilities();
+            ability->set_ability_id(ability_id);
+            ability->set_available(false);
+        }
+        for (const FakeAbility &fake : kFakeAbilities)
+        {
+            SC2APIProtocol::AbilityData *ability = data->mutable_abilities(static_cast<int>(fake.ability_id));
+            ability->set_available(true);
+            ability->set_link_name(fake.name);
+            ability->set_button_name(fake.name);
+            ability->set_friendly_name(fake.name);
+        }
+    }
+
+    void FakeGameServer::FillObservation(SC2APIProtocol::Response &response) const
+    {
+        SC2APIProtocol::Observation *observation = response.mutable_observation()->mutable_observation();
+        observation->set_game_loop(game_loop_);
+
+        SC2APIProtocol::PlayerCommon *player_common = observation->mutable_player_common();
+        player_common->set_player_id(1);
+        player_common->set_minerals(50);
+        player_common->set_food_cap(200);
+        player_common->set_food_used(std::min(scenario_.self_units, 200));
+
+        SC2APIProtocol::ObservationRaw *raw = observation->mutable_raw_data();
+        SC2APIProtocol::Point *camera = raw->mutable_player()->mutable_camera();
+        camera->set_x(static_cast<float>(scenario_.map_width) / 2.0f);
+        camera->set_y(static_cast<float>(scenario_.map_height) / 2.0f);
+
+        raw->mutable_units()->Reserve(static_cast<int>(units_.size()));
+        for (const FakeUnit &fake : units_)
+        {
+            SC2APIProtocol::Unit *unit = raw->add_units();
+            unit->set_display_type(SC2APIProtocol::Visible);
+            unit->set_alliance(fake.owner == 1 ? SC2APIProtocol::Self : SC2APIProtocol::Enemy);
+            unit->set_tag(fake.tag);
+            unit->set_unit_type(scenario_.unit_type);
+            unit->set_owner(fake.owner);
+            unit->mutable_pos()->set_x(fake.x);
+            unit->mutable_pos()->set_y(fake.y);
+            unit->mutable_pos()->set_z(8.0f);
+            unit->set_facing(fake.heading);
+            unit->set_radius(0.375f);
+            unit->set_build_progress(1.0f);
+            unit->set_health(45.0f);
+            unit->set_health_max(45.0f);
+        }
+    }
+
+    SC2APIProtocol::Response *FakeGameServer::Answer(const SC2APIProtocol::Request &request)
+    {
+        ++requests_served_;
+        auto *response = new SC2APIProtocol::Response();
+
+        // Lifecycle requests always go through the scenario so the reported status follows what the client did.
+        switch (request.request_case())
+        {
+            case SC2APIProtocol::Request::kCreateGame:
+                ResetGame();
+                status_ = SC2APIProtocol::Status::init_game;
+                response->mutable_create_game();
+                break;
+            case SC2APIProtocol::Request::kJoinGame:
+                status_ = SC2APIProtocol::Status::in_game;
+                response->mutable_join_game()->set_player_id(1);
+                break;
+            case SC2APIProtocol::Request::kRestartGame:
+                ResetGame();
+                status_ = SC2APIProtocol::Status::in_game;
+                response->mutable_restart_game();
+                break;
+            case SC2APIProtocol::Request::kLeaveGame:
+                status_ = SC2APIProtocol::Status::launched;
+                response->mutable_leave_game();
+                break;
+            case SC2APIProtocol::Request::kQuit:
+                status_ = SC2APIProtocol::Status::quit;
+                response->mutable_quit();
+                break;
+            case SC2APIProtocol::Request::kStep:
+            {
+                uint32_t count = std::max<uint32_t>(request.step().count(), 1);
+                AdvanceUnits(count);
+                if (!AnswerFromTrace(request.request_case(), *response))
+                {
+                    response->mutable_step()->set_simulation_loop(game_loop_);
+                }
+                break;
+            }
+            default:
+                if (AnswerFromTrace(request.request_case(), *response))
+                {
+                    break;
+                }
+
+                switch (request.request_case())
+                {
+                    case SC2APIProtocol::Request::kPing:
+                    {
+                        SC2APIProtocol::ResponsePing *ping = response->mutable_ping();
+                        ping->set_game_version("fake");
+                        ping->set_data_version(scenario_.data_version);
+                        ping->set_data_build(scenario_.base_build);
+                        ping->set_base_build(scenario_.base_build);
+                        break;
+                    }
+                    case SC2APIProtocol::Request::kGameInfo:
+                        FillGameInfo(*response);
+                        break;
+                    case SC2APIProtocol::Request::kData:
+                        FillData(request.data(), *response);
+                        break;
+                    case SC2APIProtocol::Request::kObservation:
+                        FillObservation(*response);
+                        break;
+                    case SC2APIProtocol::Request::kAction:
+                    {
+                        SC2APIProtocol::ResponseAction *action = response->mutable_action();
+                        for (int i = 0; i < request.action().actions_size(); ++i)
+                        {
+                            action->add_result(SC2APIProtocol::ActionResult::Success);
+                        }
+                        break;
+                    }
+                    case SC2APIProtocol::Request::kQuery:
+                    {
+                        const SC2APIProtocol::RequestQuery &query = request.query();
+                        SC2APIProtocol::ResponseQuery *result = response->mutable_query();
+                        for (const SC2APIProtocol::RequestQueryPathing &pathing : query.pathing())
+                        {
+                            // No terrain to path around, straight lines it is.
+                            float dx = pathing.end_pos().x() - pathing.start_pos().x();
+                            float dy = pathing.end_pos().y() - pathing.start_pos().y();
+                            result->add_pathing()->set_distance(std::sqrt(dx * dx + dy * dy));
+                        }
+                        for (int i = 0; i < query.placements_size(); ++i)
+                        {
+                            result->add_placements()->set_result(SC2APIProtocol::ActionResult::Success);
+                        }
+                        for (const SC2APIProtocol::RequestQueryAvailableAbilities &abilities : query.abilities())
+                        {
+                            SC2APIProtocol::ResponseQueryAvailableAbilities *available = result->add_abilities();
+                            available->set_unit_tag(abilities.unit_tag());
+                            available->set_unit_type_id(scenario_.unit_type);
+                        }
+                        break;
+                    }
+                    case SC2APIProtocol::Request::kDebug:
+                        response->mutable_debug();
+                        break;
+                    default:
+                        response->add_error("Request not supported by the fake game server");
+                        break;
+                }
+                break;
+        }
+
+        response->set_status(static_cast<SC2APIProtocol::Status>(status_));
+        return response;
+    }
+}
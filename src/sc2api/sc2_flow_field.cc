@@ -0,0 +1,513 @@
+#include "sc2api/sc2_flow_field.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "sc2api/sc2_map_info.h"
+#include "sc2api/sc2_path_finder.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SC2_FLOW_FIELD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace sc2
+{
+    static const float kDiagonalCost = 1.41421356f;
+
+    static const int kNeighbourX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int kNeighbourY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+    // Relaxes the cells of a row from the row next to it, through the straight and both diagonal moves. Diagonal moves
+    // are only allowed if the cells beside them are walkable, blocked cells have an infinite penalty so any move into or
+    // past them costs infinity.
+    static bool RelaxFromRow(float *row, const float *next, const float *row_penalty, const float *next_penalty,
+                             int width)
+    {
+        int x = 1;
+        bool changed = false;
+#ifdef SC2_FLOW_FIELD_SSE2
+        const __m128 straight = _mm_set1_ps(1.0f);
+        const __m128 diagonal = _mm_set1_ps(kDiagonalCost);
+        int lowered = 0;
+        for (; x + 4 <= width + 1; x += 4)
+        {
+            __m128 beside = _mm_loadu_ps(next_penalty + x);
+            __m128 candidate = _mm_add_ps(_mm_loadu_ps(next + x), straight);
+            __m128 left = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(next + x - 1), diagonal),
+                                     _mm_add_ps(_mm_loadu_ps(row_penalty + x - 1), beside));
+            __m128 right = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(next + x + 1), diagonal),
+                                      _mm_add_ps(_mm_loadu_ps(row_penalty + x + 1), beside));
+            candidate = _mm_add_ps(_mm_min_ps(candidate, _mm_min_ps(left, right)), _mm_loadu_ps(row_penalty + x));
+            __m128 current = _mm_loadu_ps(row + x);
+            lowered |= _mm_movemask_ps(_mm_cmplt_ps(candidate, current));
+            _mm_storeu_ps(row + x, _mm_min_ps(candidate, current));
+        }
+        changed = lowered != 0;
+#endif
+        for (; x <= width; ++x)
+        {
+            float left = next[x - 1] + kDiagonalCost + row_penalty[x - 1] + next_penalty[x];
+            float right = next[x + 1] + kDiagonalCost + row_penalty[x + 1] + next_penalty[x];
+            float candidate = std::min(next[x] + 1.0f, std::min(left, right)) + row_penalty[x];
+            if (candidate < row[x])
+            {
+                row[x] = candidate;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+#ifdef SC2_FLOW_FIELD_SSE2
+    // Moves every lane one or two lanes up (Up) or down (Down), filling the lanes left empty with 'fill'.
+    static __m128 ShiftUp1(__m128 value, __m128 fill)
+    {
+        return _mm_or_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(value), 4)), fill);
+    }
+
+    static __m128 ShiftUp2(__m128 value, __m128 fill)
+    {
+        return _mm_or_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(value), 8)), fill);
+    }
+
+    static __m128 ShiftDown1(__m128 value, __m128 fill)
+    {
+        return _mm_or_ps(_mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(value), 4)), fill);
+    }
+
+    static __m128 ShiftDown2(__m128 value, __m128 fill)
+    {
+        return _mm_or_ps(_mm_castsi128_ps(_mm_srli_si128(_mm_castps_si128(value), 8)), fill);
+    }
+#endif
+
+    // Relaxes each cell of a row from its left neighbour, carrying distances rightwards. Four cells at a time this is a
+    // prefix minimum: lane i takes the smallest distance of lanes j <= i plus i - j, as long as every cell from j + 1 to i
+    // is walkable, and finally the distance carried in from the cell before the four.
+    static bool RelaxAlongRowRight(float *row, const float *penalty, int width)
+    {
+        int x = 1;
+        bool changed = false;
+#ifdef SC2_FLOW_FIELD_SSE2
+        const float infinity = DistanceField::Unreachable;
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 infinity_low1 = _mm_setr_ps(infinity, 0.0f, 0.0f, 0.0f);
+        const __m128 infinity_low2 = _mm_setr_ps(infinity, infinity, 0.0f, 0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 steps = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f);
+        __m128 carry = _mm_set1_ps(row[0]);
+        int lowered = 0;
+        for (; x + 3 <= width; x += 4)
+        {
+            __m128 cell_penalty = _mm_loadu_ps(penalty + x);
+            __m128 pair_penalty = _mm_add_ps(cell_penalty, ShiftUp1(cell_penalty, zero));
+            __m128 prefix_penalty = _mm_add_ps(pair_penalty, ShiftUp2(pair_penalty, zero));
+
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 value = _mm_min_ps(current,
+                                      _mm_add_ps(ShiftUp1(current, infinity_low1), _mm_add_ps(one, cell_penalty)));
+            value = _mm_min_ps(value, _mm_add_ps(ShiftUp2(value, infinity_low2), _mm_add_ps(two, pair_penalty)));
+            value = _mm_min_ps(value, _mm_add_ps(carry, _mm_add_ps(steps, prefix_penalty)));
+
+            lowered |= _mm_movemask_ps(_mm_cmplt_ps(value, current));
+            _mm_storeu_ps(row + x, value);
+            carry = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        changed = lowered != 0;
+#endif
+        for (; x <= width; ++x)
+        {
+            float candidate = row[x - 1] + 1.0f + penalty[x];
+            if (candidate < row[x])
+            {
+                row[x] = candidate;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // The mirror image of RelaxAlongRowRight, carrying distances leftwards.
+    static bool RelaxAlongRowLeft(float *row, const float *penalty, int width)
+    {
+        int x = width;
+        bool changed = false;
+#ifdef SC2_FLOW_FIELD_SSE2
+        const float infinity = DistanceField::Unreachable;
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 infinity_high1 = _mm_setr_ps(0.0f, 0.0f, 0.0f, infinity);
+        const __m128 infinity_high2 = _mm_setr_ps(0.0f, 0.0f, infinity, infinity);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 steps = _mm_setr_ps(4.0f, 3.0f, 2.0f, 1.0f);
+        __m128 carry = _mm_set1_ps(row[width + 1]);
+        int lowered = 0;
+        // x is the last cell of the four.
+        for (; x - 3 >= 1; x -= 4)
+        {
+            __m128 cell_penalty = _mm_loadu_ps(penalty + x - 3);
+            __m128 pair_penalty = _mm_add_ps(cell_penalty, ShiftDown1(cell_penalty, zero));
+            __m128 suffix_penalty = _mm_add_ps(pair_penalty, ShiftDown2(pair_penalty, zero));
+
+            __m128 current = _mm_loadu_ps(row + x - 3);
+            __m128 value = _mm_min_ps(current,
+                                      _mm_add_ps(ShiftDown1(current, infinity_high1), _mm_add_ps(one, cell_penalty)));
+            value = _mm_min_ps(value, _mm_add_ps(ShiftDown2(value, infinity_high2), _mm_add_ps(two, pair_penalty)));
+            value = _mm_min_ps(value, _mm_add_ps(carry, _mm_add_ps(steps, suffix_penalty)));
+
+            lowered |= _mm_movemask_ps(_mm_cmplt_ps(value, current));
+            _mm_storeu_ps(row + x - 3, value);
+            carry = _mm_shuffle_ps(value, value, _MM_SHUFFLE(0, 0, 0, 0));
+        }
+        changed = lowered != 0;
+#endif
+        for (; x >= 1; --x)
+        {
+            float candidate = row[x + 1] + 1.0f + penalty[x];
+            if (candidate < row[x])
+            {
+                row[x] = candidate;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    DistanceField::DistanceField() : width_(0),
+                                     height_(0) {}
+
+    int DistanceField::Width() const
+    {
+        return width_;
+    }
+
+    int DistanceField::Height() const
+    {
+        return height_;
+    }
+
+    const std::vector<Point2DI> &DistanceField::Sources() const
+    {
+        return sources_;
+    }
+
+    int DistanceField::Index(int x, int y) const
+    {
+        return (y + 1) * (width_ + 2) + x + 1;
+    }
+
+    float DistanceField::Distance(const Point2DI &cell) const
+    {
+        if (cell.x < 0 || cell.y < 0 || cell.x >= width_ || cell.y >= height_)
+        {
+            return Unreachable;
+        }
+        return distance_[Index(cell.x, cell.y)];
+    }
+
+    float DistanceField::Distance(const Point2D &point) const
+    {
+        return Distance(Point2DI(static_cast<int>(std::floor(point.x)), static_cast<int>(std::floor(point.y))));
+    }
+
+    bool DistanceField::NextCell(const Point2DI &cell, Point2DI *next) const
+    {
+        float distance = Distance(cell);
+        if (distance == 0.0f || distance == Unreachable)
+        {
+            return false;
+        }
+
+        // The neighbours of a reachable cell are only unreachable if they are blocked.
+        const int index = Index(cell.x, cell.y);
+        const int stride = width_ + 2;
+        float best = distance;
+        for (int i = 0; i < 8; ++i)
+        {
+            const bool diagonal = kNeighbourX[i] != 0 && kNeighbourY[i] != 0;
+            if (diagonal && (distance_[index + kNeighbourX[i]] == Unreachable ||
+                             distance_[index + kNeighbourY[i] * stride] == Unreachable))
+            {
+                continue;
+            }
+
+            float neighbour = distance_[index + kNeighbourY[i] * stride + kNeighbourX[i]];
+            if (neighbour < best)
+            {
+                best = neighbour;
+                if (next)
+                {
+                    *next = Point2DI(cell.x + kNeighbourX[i], cell.y + kNeighbourY[i]);
+                }
+            }
+        }
+        return best < distance;
+    }
+
+    Point2D DistanceField::Direction(const Point2D &point) const
+    {
+        Point2DI next;
+        if (!NextCell(Point2DI(static_cast<int>(std::floor(point.x)), static_cast<int>(std::floor(point.y))), &next))
+        {
+            return Point2D(0.0f, 0.0f);
+        }
+
+        Point2D direction(next.x + 0.5f - point.x, next.y + 0.5f - point.y);
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        return Point2D(direction.x / length, direction.y / length);
+    }
+
+    void DistanceField::Relax(const std::vector<float> &penalty)
+    {
+        // Every sweep pair carries the distances across the grid once in each direction, only paths that wind back
+        // and forth need more than one.
+        bool changed = true;
+        while (changed)
+        {
+            changed = SweepDown(penalty);
+            changed = SweepUp(penalty) || changed;
+        }
+    }
+
+    bool DistanceField::SweepDown(const std::vector<float> &penalty)
+    {
+        const int stride = width_ + 2;
+        bool changed = false;
+        for (int y = 1; y <= height_; ++y)
+        {
+            float *row = distance_.data() + y * stride;
+            const float *row_penalty = penalty.data() + y * stride;
+            changed = RelaxFromRow(row, row - stride, row_penalty, row_penalty - stride, width_) || changed;
+            changed = RelaxAlongRowRight(row, row_penalty, width_) || changed;
+        }
+        return changed;
+    }
+
+    bool DistanceField::SweepUp(const std::vector<float> &penalty)
+    {
+        const int stride = width_ + 2;
+        bool changed = false;
+        for (int y = height_; y >= 1; --y)
+        {
+            float *row = distance_.data() + y * stride;
+            const float *row_penalty = penalty.data() + y * stride;
+            changed = RelaxFromRow(row, row + stride, row_penalty, row_penalty + stride, width_) || changed;
+            changed = RelaxAlongRowLeft(row, row_penalty, width_) || changed;
+        }
+        return changed;
+    }
+
+    FlowFieldCache::FlowFieldCache(size_t capacity) : width_(0),
+                                                      height_(0),
+                                                      capacity_(std::max<size_t>(capacity, 1)),
+                                                      uses_(0) {}
+
+    void FlowFieldCache::SetTerrain(const TerrainGrids &terrain)
+    {
+        const CellGrid &pathing = terrain.Pathing();
+        width_ = pathing.Width();
+        height_ = pathing.Height();
+        const size_t cell_count = static_cast<size_t>(width_ + 2) * (height_ + 2);
+        pathable_.assign(cell_count, 0);
+        obstacle_.assign(cell_count, 0);
+        penalty_.assign(cell_count, DistanceField::Unreachable);
+        for (int y = 0; y < height_; ++y)
+        {
+            const uint8_t *row = pathing.Row(y);
+            for (int x = 0; x < width_; ++x)
+            {
+                const int index = (y + 1) * (width_ + 2) + x + 1;
+                pathable_[index] = row[x] ? 1 : 0;
+                penalty_[index] = row[x] ? 0.0f : DistanceField::Unreachable;
+            }
+        }
+        Clear();
+    }
+
+    void FlowFieldCache::SetObstacles(const Units &units)
+    {
+        next_obstacle_.assign(obstacle_.size(), 0);
+        for (const Unit *unit : units)
+        {
+            if (!unit || !BlocksPathing(*unit))
+            {
+                continue;
+            }
+            Rect2DI footprint = GetFootprint(*unit);
+            for (int y = std::max(footprint.from.y, 0); y < std::min(footprint.to.y, height_); ++y)
+            {
+                for (int x = std::max(footprint.from.x, 0); x < std::min(footprint.to.x, width_); ++x)
+                {
+                    next_obstacle_[(y + 1) * (width_ + 2) + x + 1] = 1;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < obstacle_.size(); ++i)
+        {
+            if (obstacle_[i] != next_obstacle_[i])
+            {
+                SetBlocked(static_cast<int>(i), next_obstacle_[i] != 0);
+            }
+        }
+    }
+
+    void FlowFieldCache::AddObstacle(const Unit &unit)
+    {
+        if (BlocksPathing(unit))
+        {
+            SetFootprint(unit, true);
+        }
+    }
+
+    void FlowFieldCache::RemoveObstacle(const Unit &unit)
+    {
+        SetFootprint(unit, false);
+    }
+
+    void FlowFieldCache::SetFootprint(const Unit &unit, bool blocked)
+    {
+        Rect2DI footprint = GetFootprint(unit);
+        for (int y = std::max(footprint.from.y, 0); y < std::min(footprint.to.y, height_); ++y)
+        {
+            for (int x = std::max(footprint.from.x, 0); x < std::min(footprint.to.x, width_); ++x)
+            {
+                const int index = (y + 1) * (width_ + 2) + x + 1;
+                if ((obstacle_[index] != 0) != blocked)
+                {
+                    SetBlocked(index, blocked);
+                }
+            }
+        }
+    }
+
+    void FlowFieldCache::SetBlocked(int index, bool blocked)
+    {
+        obstacle_[index] = blocked ? 1 : 0;
+        if (!pathable_[index])
+        {
+            return;
+        }
+
+        penalty_[index] = blocked ? DistanceField::Unreachable : 0.0f;
+        for (std::unique_ptr<Entry> &entry : entries_)
+        {
+            if (blocked)
+            {
+                entry->raise_from = std::min(entry->raise_from, entry->field.distance_[index]);
+            }
+            else
+            {
+                entry->relax = true;
+            }
+        }
+    }
+
+    bool FlowFieldCache::IsWalkable(const Point2DI &cell) const
+    {
+        if (cell.x < 0 || cell.y < 0 || cell.x >= width_ || cell.y >= height_)
+        {
+            return false;
+        }
+        return penalty_[(cell.y + 1) * (width_ + 2) + cell.x + 1] == 0.0f;
+    }
+
+    void FlowFieldCache::Repair(DistanceField &field, float raise_from) const
+    {
+        // Distances only grow along a shortest path, so a cell closer than every newly blocked cell can't have had
+        // one of them on its path. Everything else is computed again from those cells.
+        if (raise_from != DistanceField::Unreachable)
+        {
+            for (float &distance : field.distance_)
+            {
+                if (distance >= raise_from)
+                {
+                    distance = DistanceField::Unreachable;
+                }
+            }
+        }
+
+        for (const Point2DI &source : field.sources_)
+        {
+            const int index = field.Index(source.x, source.y);
+            if (penalty_[index] == 0.0f)
+            {
+                field.distance_[index] = 0.0f;
+            }
+        }
+        field.Relax(penalty_);
+    }
+
+    const DistanceField &FlowFieldCache::Get(const std::vector<Point2DI> &sources)
+    {
+        std::vector<Point2DI> key;
+        key.reserve(sources.size());
+        for (const Point2DI &source : sources)
+        {
+            if (source.x >= 0 && source.y >= 0 && source.x < width_ && source.y < height_)
+            {
+                key.push_back(source);
+            }
+        }
+        std::sort(key.begin(), key.end(), [](const Point2DI &a, const Point2DI &b)
+        {
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+        key.erase(std::unique(key.begin(), key.end()), key.end());
+
+        ++uses_;
+        for (std::unique_ptr<Entry> &entry : entries_)
+        {
+            if (entry->field.sources_ == key)
+            {
+                entry->last_used = uses_;
+                if (entry->relax || entry->raise_from != DistanceField::Unreachable)
+                {
+                    Repair(entry->field, entry->raise_from);
+                    entry->raise_from = DistanceField::Unreachable;
+                    entry->relax = false;
+                }
+                return entry->field;
+            }
+        }
+
+        // Reuses the least recently used entry once the cache is full, so its buffer is not allocated again.
+        Entry *entry = nullptr;
+        if (entries_.size() < capacity_)
+        {
+            entries_.push_back(std::make_unique<Entry>());
+            entry = entries_.back().get();
+        }
+        else
+        {
+            entry = std::min_element(entries_.begin(), entries_.end(),
+                                     [](const std::unique_ptr<Entry> &a, const std::unique_ptr<Entry> &b)
+                                     {
+                                         return a->last_used < b->last_used;
+                                     })->get();
+        }
+
+        entry->last_used = uses_;
+        entry->raise_from = DistanceField::Unreachable;
+        entry->relax = false;
+        DistanceField &field = entry->field;
+        field.width_ = width_;
+        field.height_ = height_;
+        field.sources_ = std::move(key);
+        field.distance_.assign(penalty_.size(), DistanceField::Unreachable);
+        Repair(field, DistanceField::Unreachable);
+        return field;
+    }
+
+    size_t FlowFieldCache::Size() const
+    {
+        return entries_.size();
+    }
+
+    void FlowFieldCache::Clear()
+    {
+        entries_.clear();
+    }
+}
@@ -1,6 +1,19 @@
 #include "sc2api/sc2_map_info.h"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
+#include <limits>
+#include <map>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SC2_CELL_GRID_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace sc2 {
 
@@ -145,4 +158,693 @@ void HeightMap::Dump(const std::string& file_path) const {
     }
 }
 
+CellGrid::CellGrid() :
+    width_(0),
+    height_(0),
+    stride_(0)
+{
+}
+
+CellGrid::CellGrid(int width, int height, uint8_t value) :
+    width_(std::max(width, 0)),
+    height_(std::max(height, 0)),
+    stride_((width_ + kRowAlignment - 1) / kRowAlignment * kRowAlignment),
+    cells_(static_cast<size_t>(stride_) * height_ + kRowAlignment, 0)
+{
+    for (int y = 0; y < height_; ++y)
+        std::fill(Row(y), Row(y) + width_, value);
+}
+
+CellGrid::CellGrid(const ImageData& image) :
+    CellGrid()
+{
+    Assign(image.width, image.height, image.bits_per_pixel, image.data);
+}
+
+void CellGrid::Assign(int width, int height, int bits_per_pixel, const std::string& data) {
+    size_t cell_count = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0);
+    size_t expected_size = bits_per_pixel == 1 ? (cell_count + 7) / 8 : cell_count;
+    if (cell_count == 0 || (bits_per_pixel != 1 && bits_per_pixel != 8) || data.size() < expected_size) {
+        width_ = 0;
+        height_ = 0;
+        stride_ = 0;
+        cells_.clear();
+        return;
+    }
+
+    width_ = width;
+    height_ = height;
+    stride_ = (width_ + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+    cells_.resize(static_cast<size_t>(stride_) * height_ + kRowAlignment);
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    for (int y = 0; y < height_; ++y) {
+        uint8_t* row = Row(y);
+        size_t index = static_cast<size_t>(y) * width_;
+        if (bits_per_pixel == 8) {
+            std::copy(bytes + index, bytes + index + width_, row);
+            continue;
+        }
+
+        for (int x = 0; x < width_; ++x, ++index)
+            row[x] = (bytes[index / 8] >> (7 - index % 8)) & 1;
+    }
+}
+
+#ifdef SC2_CELL_GRID_SSE2
+// Loading 16 bytes from kTailMask + 16 - n gives a mask of the first n lanes.
+alignas(16) static const uint8_t kTailMask[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static __m128i LoadCells(const uint8_t* cells) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells));
+}
+#endif
+
+// Adds up the cells of a rectangle after mapping them with the given functions, one that maps 16 cells to 16 bytes
+// at a time and one that maps a single cell.
+template <typename MapLanes, typename MapCell>
+static uint32_t SumRect(const CellGrid& grid, const Rect2DI& rect, MapLanes map_lanes, MapCell map_cell) {
+    int x0 = std::max(rect.from.x, 0);
+    int y0 = std::max(rect.from.y, 0);
+    int x1 = std::min(rect.to.x, grid.Width());
+    int y1 = std::min(rect.to.y, grid.Height());
+    if (x0 >= x1 || y0 >= y1)
+        return 0;
+
+    const int width = x1 - x0;
+#ifdef SC2_CELL_GRID_SSE2
+    (void)map_cell;
+    // Rows are followed by padding or by the next row, reading a whole 16 bytes for the last cells of a row stays in
+    // the buffer and the cells past the rectangle are masked out.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i tail_mask = LoadCells(kTailMask + 16 - width % 16);
+    __m128i total = zero;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* cells = grid.Row(y) + x0;
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+            total = _mm_add_epi64(total, _mm_sad_epu8(map_lanes(LoadCells(cells + x)), zero));
+        if (x < width)
+            total = _mm_add_epi64(total, _mm_sad_epu8(_mm_and_si128(map_lanes(LoadCells(cells + x)), tail_mask), zero));
+    }
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(total)) +
+        static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+#else
+    (void)map_lanes;
+    uint32_t sum = 0;
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* cells = grid.Row(y) + x0;
+        for (int x = 0; x < width; ++x)
+            sum += map_cell(cells[x]);
+    }
+    return sum;
+#endif
+}
+
+uint32_t CellGrid::Sum(const Rect2DI& rect) const {
+    return SumRect(*this, rect,
+        [](auto lanes) { return lanes; },
+        [](uint8_t cell) { return static_cast<uint32_t>(cell); });
+}
+
+uint32_t CellGrid::Count(const Rect2DI& rect, uint8_t value) const {
+#ifdef SC2_CELL_GRID_SSE2
+    const __m128i target = _mm_set1_epi8(static_cast<char>(value));
+    const __m128i ones = _mm_set1_epi8(1);
+    auto map_lanes = [target, ones](__m128i lanes) { return _mm_and_si128(_mm_cmpeq_epi8(lanes, target), ones); };
+#else
+    auto map_lanes = [](int lanes) { return lanes; };
+#endif
+    return SumRect(*this, rect, map_lanes, [value](uint8_t cell) { return cell == value ? 1u : 0u; });
+}
+
+// Maps every cell of an 8 bit grid to 1 if it passes the test and to 0 otherwise.
+template <typename Test>
+static void Binarize(CellGrid& grid, Test test) {
+    for (int y = 0; y < grid.Height(); ++y) {
+        uint8_t* row = grid.Row(y);
+        for (int x = 0; x < grid.Width(); ++x)
+            row[x] = test(row[x]) ? 1 : 0;
+    }
+}
+
+static bool IsInside(const CellGrid& grid, const Rect2DI& rect) {
+    return rect.from.x >= 0 && rect.from.y >= 0 && rect.to.x <= grid.Width() && rect.to.y <= grid.Height();
+}
+
+static bool IsAllSet(const CellGrid& grid, const Rect2DI& rect) {
+    if (rect.Width() <= 0 || rect.Height() <= 0)
+        return true;
+
+    if (!IsInside(grid, rect))
+        return false;
+
+    return grid.Sum(rect) == static_cast<uint32_t>(rect.Width()) * static_cast<uint32_t>(rect.Height());
+}
+
+TerrainGrids::TerrainGrids(const GameInfo& info) :
+    pathing_(info.pathing_grid),
+    placement_(info.placement_grid),
+    height_(info.terrain_height)
+{
+    // Same meaning as PathingGrid and PlacementGrid give to 8 bit grids.
+    if (info.pathing_grid.bits_per_pixel == 8)
+        Binarize(pathing_, [](uint8_t value) { return value != 255; });
+    if (info.placement_grid.bits_per_pixel == 8)
+        Binarize(placement_, [](uint8_t value) { return value == 255; });
+}
+
+bool TerrainGrids::IsPathable(const Rect2DI& rect) const {
+    return IsAllSet(pathing_, rect);
+}
+
+bool TerrainGrids::IsPlacable(const Rect2DI& rect) const {
+    return IsAllSet(placement_, rect);
+}
+
+int TerrainGrids::CountPathable(const Rect2DI& rect) const {
+    return static_cast<int>(pathing_.Sum(rect));
+}
+
+int TerrainGrids::CountPlacable(const Rect2DI& rect) const {
+    return static_cast<int>(placement_.Sum(rect));
+}
+
+void MapStateGrids::Update(const SC2APIProtocol::MapState& map_state) {
+    std::swap(visibility_, previous_visibility_);
+
+    const SC2APIProtocol::ImageData& visibility = map_state.visibility();
+    visibility_.Assign(visibility.size().x(), visibility.size().y(), visibility.bits_per_pixel(), visibility.data());
+    // Values the game doesn't document read as FullHidden, like MapState did.
+    for (int y = 0; y < visibility_.Height(); ++y) {
+        uint8_t* row = visibility_.Row(y);
+        for (int x = 0; x < visibility_.Width(); ++x)
+            row[x] = std::min(row[x], kFullHidden);
+    }
+
+    const SC2APIProtocol::ImageData& creep = map_state.creep();
+    creep_.Assign(creep.size().x(), creep.size().y(), creep.bits_per_pixel(), creep.data());
+    if (creep.bits_per_pixel() == 8)
+        Binarize(creep_, [](uint8_t value) { return value > 0; });
+
+    // Cells are revealed when they are visible now and were not before, a previous grid of another size counts as
+    // never seen.
+    bool has_previous = previous_visibility_.Width() == visibility_.Width() &&
+        previous_visibility_.Height() == visibility_.Height();
+    if (revealed_.Width() != visibility_.Width() || revealed_.Height() != visibility_.Height())
+        revealed_ = CellGrid(visibility_.Width(), visibility_.Height());
+
+    for (int y = 0; y < visibility_.Height(); ++y) {
+        const uint8_t* current = visibility_.Row(y);
+        const uint8_t* previous = has_previous ? previous_visibility_.Row(y) : nullptr;
+        uint8_t* revealed = revealed_.Row(y);
+        int x = 0;
+#ifdef SC2_CELL_GRID_SSE2
+        const __m128i visible = _mm_set1_epi8(static_cast<char>(kVisible));
+        const __m128i ones = _mm_set1_epi8(1);
+        for (; x + 16 <= visibility_.Width(); x += 16) {
+            __m128i now_visible = _mm_cmpeq_epi8(LoadCells(current + x), visible);
+            __m128i was_visible = previous ? _mm_cmpeq_epi8(LoadCells(previous + x), visible) : _mm_setzero_si128();
+            __m128i cells = _mm_and_si128(_mm_andnot_si128(was_visible, now_visible), ones);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(revealed + x), cells);
+        }
+#endif
+        for (; x < visibility_.Width(); ++x) {
+            bool was_visible = previous && previous[x] == kVisible;
+            revealed[x] = current[x] == kVisible && !was_visible ? 1 : 0;
+        }
+    }
+    revealed_count_ = static_cast<int>(revealed_.Sum(revealed_.Area()));
+}
+
+void MapStateGrids::Clear() {
+    creep_ = CellGrid();
+    visibility_ = CellGrid();
+    previous_visibility_ = CellGrid();
+    revealed_ = CellGrid();
+    revealed_count_ = 0;
+}
+
+int MapStateGrids::CountCreep(const Rect2DI& rect) const {
+    return static_cast<int>(creep_.Sum(rect));
+}
+
+int MapStateGrids::CountVisibility(const Rect2DI& rect, Visibility visibility) const {
+    return static_cast<int>(visibility_.Count(rect, static_cast<uint8_t>(visibility)));
+}
+
+bool MapStateGrids::FindFirstFogged(const Point2D& from, const Point2D& to, Point2DI* cell) const {
+    // Steps from cell to cell along the segment, always crossing whichever cell border comes first.
+    int x = static_cast<int>(std::floor(from.x));
+    int y = static_cast<int>(std::floor(from.y));
+    const int end_x = static_cast<int>(std::floor(to.x));
+    const int end_y = static_cast<int>(std::floor(to.y));
+    const float dx = to.x - from.x;
+    const float dy = to.y - from.y;
+    const int step_x = dx > 0 ? 1 : -1;
+    const int step_y = dy > 0 ? 1 : -1;
+    const float infinity = std::numeric_limits<float>::infinity();
+    const float delta_x = dx != 0 ? 1.0f / std::abs(dx) : infinity;
+    const float delta_y = dy != 0 ? 1.0f / std::abs(dy) : infinity;
+    float next_x = dx != 0 ? (step_x > 0 ? x + 1 - from.x : from.x - x) * delta_x : infinity;
+    float next_y = dy != 0 ? (step_y > 0 ? y + 1 - from.y : from.y - y) * delta_y : infinity;
+
+    const int steps = std::abs(end_x - x) + std::abs(end_y - y);
+    for (int i = 0; ; ++i) {
+        if (visibility_.Get(Point2DI(x, y)) != kVisible) {
+            if (cell)
+                *cell = Point2DI(x, y);
+            return true;
+        }
+        if (i == steps)
+            return false;
+
+        // Rounding must not carry the walk past the last cell on either axis.
+        if (y == end_y || (x != end_x && next_x < next_y)) {
+            x += step_x;
+            next_x += delta_x;
+        }
+        else {
+            y += step_y;
+            next_y += delta_y;
+        }
+    }
+}
+
+void MapStateGrids::GetRevealedCells(std::vector<Point2DI>& cells) const {
+    if (revealed_count_ == 0)
+        return;
+
+    for (int y = 0; y < revealed_.Height(); ++y) {
+        const uint8_t* row = revealed_.Row(y);
+        int x = 0;
+#ifdef SC2_CELL_GRID_SSE2
+        // Skips 16 cells at a time while none of them was revealed.
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= revealed_.Width(); x += 16) {
+            int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(LoadCells(row + x), zero)) & 0xFFFF;
+            while (mask) {
+                int lane = std::countr_zero(static_cast<unsigned>(mask));
+                mask &= mask - 1;
+                cells.push_back(Point2DI(x + lane, y));
+            }
+        }
+#endif
+        for (; x < revealed_.Width(); ++x) {
+            if (row[x])
+                cells.push_back(Point2DI(x, y));
+        }
+    }
+}
+
+// Terrain height is encoded in steps of 1/8 world unit, and levels of terrain are 2 world units apart. A group of
+// unplaceable cells that climbs less than half a level is flat ground nothing can be built on, not a ramp.
+static const int kMinRampRise = 8;
+
+static const char kAnalysisMagic[8] = {'S', 'C', '2', 'M', 'A', 'P', 'A', 'N'};
+static const uint32_t kAnalysisVersion = 1;
+
+// Visits the 4-connected cells reachable from seed for which inside() holds. visit() is called once per cell and must
+// make inside() false for it. Every cell visited is appended to cells.
+template<typename Inside, typename Visit>
+static void FloodFill(int width, int height, int seed, Inside inside, Visit visit, std::vector<int>& cells) {
+    cells.clear();
+    visit(seed);
+    cells.push_back(seed);
+    for (size_t i = 0; i < cells.size(); ++i) {
+        int x = cells[i] % width;
+        int y = cells[i] / width;
+        const int neighbours[4] = {
+            x > 0 ? cells[i] - 1 : -1,
+            x + 1 < width ? cells[i] + 1 : -1,
+            y > 0 ? cells[i] - width : -1,
+            y + 1 < height ? cells[i] + width : -1
+        };
+        for (int neighbour : neighbours) {
+            if (neighbour >= 0 && inside(neighbour)) {
+                visit(neighbour);
+                cells.push_back(neighbour);
+            }
+        }
+    }
+}
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t HashImage(uint64_t hash, const ImageData& image) {
+    const int32_t header[3] = {image.width, image.height, image.bits_per_pixel};
+    hash = Fnv1a(hash, header, sizeof(header));
+    return Fnv1a(hash, image.data.data(), image.data.size());
+}
+
+template<typename T>
+static void WriteValue(std::ostream& stream, const T& value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+static bool ReadValue(std::istream& stream, T& value) {
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+MapAnalysis::MapAnalysis(const GameInfo& info) {
+    Analyze(info);
+}
+
+void MapAnalysis::Clear() {
+    width_ = 0;
+    height_ = 0;
+    key_ = 0;
+    cell_regions_.clear();
+    regions_.clear();
+    chokes_.clear();
+}
+
+void MapAnalysis::Analyze(const GameInfo& info) {
+    Clear();
+    TerrainGrids grids(info);
+    const CellGrid& pathing = grids.Pathing();
+    const CellGrid& placement = grids.Placement();
+    const CellGrid& height = grids.Height();
+    const int width = pathing.Width();
+    key_ = Hash(info);
+    width_ = width;
+    height_ = pathing.Height();
+    cell_regions_.assign(static_cast<size_t>(width_) * height_, 0);
+
+    auto at = [width](int index) { return Point2DI(index % width, index / width); };
+    auto unplaceable = [&](int index) {
+        Point2DI point = at(index);
+        return pathing.Get(point) != 0 && placement.Get(point) == 0;
+    };
+
+    // Region ids are stored in 16 bits, 0 meaning no region.
+    const size_t max_regions = std::numeric_limits<uint16_t>::max();
+    std::vector<int> cells;
+    auto add_region = [&](bool is_ramp) {
+        MapRegion region;
+        region.is_ramp = is_ramp;
+        region.cell_count = static_cast<int>(cells.size());
+        region.bounds = Rect2DI(at(cells.front()), at(cells.front()));
+        float x_sum = 0.0f;
+        float y_sum = 0.0f;
+        float height_sum = 0.0f;
+        for (int index : cells) {
+            Point2DI point = at(index);
+            cell_regions_[index] = static_cast<uint16_t>(regions_.size() + 1);
+            x_sum += point.x + 0.5f;
+            y_sum += point.y + 0.5f;
+            height_sum += grids.TerrainHeight(point);
+            region.bounds.from.x = std::min(region.bounds.from.x, point.x);
+            region.bounds.from.y = std::min(region.bounds.from.y, point.y);
+            region.bounds.to.x = std::max(region.bounds.to.x, point.x);
+            region.bounds.to.y = std::max(region.bounds.to.y, point.y);
+        }
+        region.bounds.to.x += 1;
+        region.bounds.to.y += 1;
+        region.center = Point2D(x_sum / region.cell_count, y_sum / region.cell_count);
+        region.height = height_sum / region.cell_count;
+        regions_.push_back(region);
+    };
+
+    // Ramps first, so the regions can't spread over them.
+    std::vector<uint8_t> visited(cell_regions_.size(), 0);
+    for (int seed = 0; seed < static_cast<int>(visited.size()) && regions_.size() < max_regions; ++seed) {
+        if (visited[seed] || !unplaceable(seed))
+            continue;
+
+        FloodFill(width_, height_, seed,
+            [&](int index) { return !visited[index] && unplaceable(index); },
+            [&](int index) { visited[index] = 1; },
+            cells);
+
+        int lowest = std::numeric_limits<int>::max();
+        int highest = std::numeric_limits<int>::min();
+        for (int index : cells) {
+            int level = height.Get(at(index));
+            lowest = std::min(lowest, level);
+            highest = std::max(highest, level);
+        }
+        if (highest - lowest >= kMinRampRise)
+            add_region(true);
+    }
+
+    for (int seed = 0; seed < static_cast<int>(cell_regions_.size()) && regions_.size() < max_regions; ++seed) {
+        if (cell_regions_[seed] != 0 || !pathing.Get(at(seed)))
+            continue;
+
+        // Marks the cells with a placeholder until the region is added, which gives them their id.
+        FloodFill(width_, height_, seed,
+            [&](int index) { return cell_regions_[index] == 0 && pathing.Get(at(index)) != 0; },
+            [&](int index) { cell_regions_[index] = std::numeric_limits<uint16_t>::max(); },
+            cells);
+        add_region(false);
+    }
+
+    // Cells of each ramp next to each region, in the order the cells are scanned.
+    std::map<std::pair<int, int>, std::vector<Point2DI>> openings;
+    for (int y = 0; y < height_; ++y) {
+        for (int x = 0; x < width_; ++x) {
+            int ramp = GetRegionIndex(Point2DI(x, y));
+            if (ramp < 0 || !regions_[ramp].is_ramp)
+                continue;
+
+            const Point2DI neighbours[4] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+            for (const Point2DI& neighbour : neighbours) {
+                int region = GetRegionIndex(neighbour);
+                if (region < 0 || regions_[region].is_ramp)
+                    continue;
+
+                std::vector<Point2DI>& opening = openings[std::make_pair(ramp, region)];
+                if (opening.empty() || opening.back() != Point2DI(x, y))
+                    opening.push_back(Point2DI(x, y));
+            }
+        }
+    }
+
+    for (const auto& opening : openings) {
+        const std::vector<Point2DI>& opening_cells = opening.second;
+        MapChoke choke;
+        choke.ramp = opening.first.first;
+        choke.region = opening.first.second;
+        float x_sum = 0.0f;
+        float y_sum = 0.0f;
+        float widest = 0.0f;
+        for (size_t i = 0; i < opening_cells.size(); ++i) {
+            x_sum += opening_cells[i].x + 0.5f;
+            y_sum += opening_cells[i].y + 0.5f;
+            for (size_t j = i + 1; j < opening_cells.size(); ++j) {
+                float dx = static_cast<float>(opening_cells[i].x - opening_cells[j].x);
+                float dy = static_cast<float>(opening_cells[i].y - opening_cells[j].y);
+                widest = std::max(widest, dx * dx + dy * dy);
+            }
+        }
+        choke.center = Point2D(x_sum / opening_cells.size(), y_sum / opening_cells.size());
+        // The cells at either end of the opening count in full.
+        choke.width = std::sqrt(widest) + 1.0f;
+        chokes_.push_back(choke);
+    }
+
+    LinkChokes();
+}
+
+void MapAnalysis::LinkChokes() {
+    for (size_t i = 0; i < chokes_.size(); ++i) {
+        regions_[chokes_[i].ramp].chokes.push_back(static_cast<int>(i));
+        regions_[chokes_[i].region].chokes.push_back(static_cast<int>(i));
+    }
+}
+
+bool MapAnalysis::AnalyzeCached(const GameInfo& info, const std::string& cache_directory) {
+    if (cache_directory.empty()) {
+        Analyze(info);
+        return false;
+    }
+
+    uint64_t key = Hash(info);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.analysis", static_cast<unsigned long long>(key));
+    std::string file_path = (std::filesystem::path(cache_directory) / name).string();
+    if (Load(file_path, key))
+        return true;
+
+    Analyze(info);
+    Save(file_path);
+    return false;
+}
+
+bool MapAnalysis::Save(const std::string& file_path) const {
+    // Written next to the destination and renamed over it, so a bot reading the file never sees half of it.
+    std::string temporary_path = file_path + ".tmp";
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!stream)
+            return false;
+
+        stream.write(kAnalysisMagic, sizeof(kAnalysisMagic));
+        WriteValue(stream, kAnalysisVersion);
+        WriteValue(stream, key_);
+        WriteValue(stream, static_cast<int32_t>(width_));
+        WriteValue(stream, static_cast<int32_t>(height_));
+
+        WriteValue(stream, static_cast<uint32_t>(regions_.size()));
+        for (const MapRegion& region : regions_) {
+            WriteValue(stream, static_cast<uint8_t>(region.is_ramp));
+            WriteValue(stream, static_cast<int32_t>(region.cell_count));
+            WriteValue(stream, region.center.x);
+            WriteValue(stream, region.center.y);
+            WriteValue(stream, static_cast<int32_t>(region.bounds.from.x));
+            WriteValue(stream, static_cast<int32_t>(region.bounds.from.y));
+            WriteValue(stream, static_cast<int32_t>(region.bounds.to.x));
+            WriteValue(stream, static_cast<int32_t>(region.bounds.to.y));
+            WriteValue(stream, region.height);
+        }
+
+        WriteValue(stream, static_cast<uint32_t>(chokes_.size()));
+        for (const MapChoke& choke : chokes_) {
+            WriteValue(stream, static_cast<int32_t>(choke.ramp));
+            WriteValue(stream, static_cast<int32_t>(choke.region));
+            WriteValue(stream, choke.center.x);
+            WriteValue(stream, choke.center.y);
+            WriteValue(stream, choke.width);
+        }
+
+        stream.write(reinterpret_cast<const char*>(cell_regions_.data()),
+            static_cast<std::streamsize>(cell_regions_.size() * sizeof(uint16_t)));
+        if (!stream.flush()) {
+            stream.close();
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+    }
+
+    // Unlike POSIX, rename on Windows fails if the destination exists.
+    std::remove(file_path.c_str());
+    if (std::rename(temporary_path.c_str(), file_path.c_str()) != 0) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MapAnalysis::Load(const std::string& file_path, uint64_t key) {
+    Clear();
+    std::ifstream stream(file_path, std::ios::binary);
+    char magic[sizeof(kAnalysisMagic)];
+    uint32_t version = 0;
+    uint64_t file_key = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    if (!stream.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kAnalysisMagic) ||
+        !ReadValue(stream, version) || version != kAnalysisVersion ||
+        !ReadValue(stream, file_key) || file_key != key ||
+        !ReadValue(stream, width) || !ReadValue(stream, height) ||
+        width < 0 || height < 0 || width > 4096 || height > 4096) {
+        return false;
+    }
+
+    uint32_t region_count = 0;
+    if (!ReadValue(stream, region_count) || region_count > std::numeric_limits<uint16_t>::max())
+        return false;
+
+    std::vector<MapRegion> regions(region_count);
+    for (MapRegion& region : regions) {
+        uint8_t is_ramp = 0;
+        int32_t cell_count = 0;
+        int32_t bounds[4] = {};
+        if (!ReadValue(stream, is_ramp) || !ReadValue(stream, cell_count) ||
+            !ReadValue(stream, region.center.x) || !ReadValue(stream, region.center.y) ||
+            !ReadValue(stream, bounds) || !ReadValue(stream, region.height)) {
+            return false;
+        }
+        region.is_ramp = is_ramp != 0;
+        region.cell_count = cell_count;
+        region.bounds = Rect2DI(Point2DI(bounds[0], bounds[1]), Point2DI(bounds[2], bounds[3]));
+    }
+
+    uint32_t choke_count = 0;
+    if (!ReadValue(stream, choke_count))
+        return false;
+
+    std::vector<MapChoke> chokes;
+    for (uint32_t i = 0; i < choke_count; ++i) {
+        MapChoke choke;
+        int32_t ramp = 0;
+        int32_t region = 0;
+        if (!ReadValue(stream, ramp) || !ReadValue(stream, region) ||
+            !ReadValue(stream, choke.center.x) || !ReadValue(stream, choke.center.y) ||
+            !ReadValue(stream, choke.width)) {
+            return false;
+        }
+        if (ramp < 0 || region < 0 || ramp >= static_cast<int32_t>(region_count) ||
+            region >= static_cast<int32_t>(region_count)) {
+            return false;
+        }
+        choke.ramp = ramp;
+        choke.region = region;
+        chokes.push_back(choke);
+    }
+
+    std::vector<uint16_t> cell_regions(static_cast<size_t>(width) * height);
+    if (!stream.read(reinterpret_cast<char*>(cell_regions.data()),
+            static_cast<std::streamsize>(cell_regions.size() * sizeof(uint16_t)))) {
+        return false;
+    }
+    for (uint16_t cell_region : cell_regions) {
+        if (cell_region > region_count)
+            return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    key_ = key;
+    cell_regions_ = std::move(cell_regions);
+    regions_ = std::move(regions);
+    chokes_ = std::move(chokes);
+    LinkChokes();
+    return true;
+}
+
+uint64_t MapAnalysis::Hash(const GameInfo& info) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = HashImage(hash, info.pathing_grid);
+    hash = HashImage(hash, info.placement_grid);
+    return HashImage(hash, info.terrain_height);
+}
+
+int MapAnalysis::GetRegionIndex(const Point2DI& point) const {
+    if (point.x < 0 || point.y < 0 || point.x >= width_ || point.y >= height_)
+        return -1;
+
+    return static_cast<int>(cell_regions_[point.y * width_ + point.x]) - 1;
+}
+
+const MapRegion* MapAnalysis::GetRegion(const Point2DI& point) const {
+    int index = GetRegionIndex(point);
+    return index < 0 ? nullptr : &regions_[index];
+}
+
+std::vector<int> MapAnalysis::GetNeighbours(int region) const {
+    std::vector<int> neighbours;
+    if (region < 0 || region >= static_cast<int>(regions_.size()))
+        return neighbours;
+
+    for (int choke : regions_[region].chokes) {
+        int other = chokes_[choke].ramp == region ? chokes_[choke].region : chokes_[choke].ramp;
+        if (std::find(neighbours.begin(), neighbours.end(), other) == neighbours.end())
+            neighbours.push_back(other);
+    }
+    return neighbours;
+}
+
 }
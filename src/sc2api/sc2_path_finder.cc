@@ -0,0 +1,445 @@
+#include "sc2api/sc2_path_finder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "sc2api/sc2_map_info.h"
+#include "sc2api/sc2_unit_filters.h"
+
+namespace sc2
+{
+    static const float kDiagonalCost = 1.41421356f;
+
+    static const int kNeighbourX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int kNeighbourY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+    static Point2DI CellOf(const Point2D &point)
+    {
+        return Point2DI(static_cast<int>(std::floor(point.x)), static_cast<int>(std::floor(point.y)));
+    }
+
+    // Shortest distance between two cells when every move is straight or diagonal.
+    static float OctileDistance(int dx, int dy)
+    {
+        dx = std::abs(dx);
+        dy = std::abs(dy);
+        return static_cast<float>(std::max(dx, dy)) + (kDiagonalCost - 1.0f) * static_cast<float>(std::min(dx, dy));
+    }
+
+    bool BlocksPathing(const Unit &unit)
+    {
+        if (unit.display_type == Unit::Placeholder || unit.is_flying || !IsBuilding()(unit.unit_type))
+        {
+            return false;
+        }
+
+        switch (static_cast<UNIT_TYPEID>(unit.unit_type))
+        {
+            case UNIT_TYPEID::TERRAN_SUPPLYDEPOTLOWERED:
+            case UNIT_TYPEID::ZERG_CREEPTUMOR:
+            case UNIT_TYPEID::ZERG_CREEPTUMORBURROWED:
+            case UNIT_TYPEID::ZERG_CREEPTUMORQUEEN:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    Rect2DI GetFootprint(const Unit &unit)
+    {
+        // Structures are squares whose radius is a little more than half their size, e.g. 2.75 for a 5x5 town hall.
+        int size = std::max(1, static_cast<int>(unit.radius * 2.0f));
+        int x0 = static_cast<int>(std::floor(unit.pos.x - size / 2.0f + 0.5f));
+        int y0 = static_cast<int>(std::floor(unit.pos.y - size / 2.0f + 0.5f));
+        return Rect2DI(Point2DI(x0, y0), Point2DI(x0 + size, y0 + size));
+    }
+
+    PathFinder::PathFinder() : width_(0),
+                               height_(0),
+                               regions_dirty_(true),
+                               search_(0) {}
+
+    PathFinder::PathFinder(const TerrainGrids &terrain) : PathFinder()
+    {
+        SetTerrain(terrain);
+    }
+
+    void PathFinder::SetTerrain(const TerrainGrids &terrain)
+    {
+        const CellGrid &pathing = terrain.Pathing();
+        if (pathing.Width() != width_ || pathing.Height() != height_)
+        {
+            width_ = pathing.Width();
+            height_ = pathing.Height();
+            size_t cell_count = static_cast<size_t>(width_) * height_;
+            cells_.assign(cell_count, 0);
+            visited_.assign(cell_count, 0);
+            closed_.assign(cell_count, 0);
+            cost_.assign(cell_count, 0.0f);
+            parent_.assign(cell_count, -1);
+            region_.assign(cell_count, 0);
+            search_ = 0;
+        }
+        regions_dirty_ = true;
+
+        for (int y = 0; y < height_; ++y)
+        {
+            const uint8_t *row = pathing.Row(y);
+            for (int x = 0; x < width_; ++x)
+            {
+                uint8_t &cell = cells_[y * width_ + x];
+                cell = static_cast<uint8_t>((cell & ~Unpathable) | (row[x] ? 0 : Unpathable));
+            }
+        }
+    }
+
+    void PathFinder::SetObstacles(const Units &units)
+    {
+        ClearObstacles();
+        regions_dirty_ = true;
+        for (const Unit *unit : units)
+        {
+            if (unit && BlocksPathing(*unit))
+            {
+                BlockFootprint(*unit);
+            }
+        }
+    }
+
+    void PathFinder::ClearObstacles()
+    {
+        for (uint8_t &cell : cells_)
+        {
+            cell &= static_cast<uint8_t>(~Obstacle);
+        }
+        regions_dirty_ = true;
+    }
+
+    void PathFinder::UpdateRegions()
+    {
+        // Diagonal moves can't cut corners, so two cells are connected exactly when a path of straight moves joins them.
+        std::fill(region_.begin(), region_.end(), 0);
+        std::vector<int> &stack = cells_on_path_;
+        int next_region = 0;
+        for (int seed = 0; seed < static_cast<int>(cells_.size()); ++seed)
+        {
+            if (Blocked(seed) || region_[seed] != 0)
+            {
+                continue;
+            }
+
+            region_[seed] = ++next_region;
+            stack.assign(1, seed);
+            while (!stack.empty())
+            {
+                const int cell = stack.back();
+                stack.pop_back();
+                const int x = cell % width_;
+                const int y = cell / width_;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const int nx = x + kNeighbourX[i];
+                    const int ny = y + kNeighbourY[i];
+                    if (nx < 0 || ny < 0 || nx >= width_ || ny >= height_)
+                    {
+                        continue;
+                    }
+                    const int neighbour = ny * width_ + nx;
+                    if (!Blocked(neighbour) && region_[neighbour] == 0)
+                    {
+                        region_[neighbour] = next_region;
+                        stack.push_back(neighbour);
+                    }
+                }
+            }
+        }
+        regions_dirty_ = false;
+    }
+
+    void PathFinder::BlockFootprint(const Unit &unit)
+    {
+        Rect2DI footprint = GetFootprint(unit);
+        for (int y = std::max(footprint.from.y, 0); y < std::min(footprint.to.y, height_); ++y)
+        {
+            for (int x = std::max(footprint.from.x, 0); x < std::min(footprint.to.x, width_); ++x)
+            {
+                cells_[y * width_ + x] |= Obstacle;
+            }
+        }
+    }
+
+    bool PathFinder::Blocked(int cell) const
+    {
+        return cells_[cell] != 0;
+    }
+
+    bool PathFinder::IsWalkable(const Point2DI &cell) const
+    {
+        return cell.x >= 0 && cell.y >= 0 && cell.x < width_ && cell.y < height_ && !Blocked(cell.y * width_ + cell.x);
+    }
+
+    bool PathFinder::ClearLine(const Point2D &from, const Point2D &to) const
+    {
+        // Steps from cell to cell along the segment like MapStateGrids::FindFirstFogged. Where it passes exactly through
+        // a corner both cells beside it must be free, the same rule diagonal moves follow.
+        int x = static_cast<int>(std::floor(from.x));
+        int y = static_cast<int>(std::floor(from.y));
+        const int end_x = static_cast<int>(std::floor(to.x));
+        const int end_y = static_cast<int>(std::floor(to.y));
+        const float dx = to.x - from.x;
+        const float dy = to.y - from.y;
+        const int step_x = dx > 0 ? 1 : -1;
+        const int step_y = dy > 0 ? 1 : -1;
+        const float infinity = std::numeric_limits<float>::infinity();
+        const float delta_x = dx != 0 ? 1.0f / std::abs(dx) : infinity;
+        const float delta_y = dy != 0 ? 1.0f / std::abs(dy) : infinity;
+        float next_x = dx != 0 ? (step_x > 0 ? x + 1 - from.x : from.x - x) * delta_x : infinity;
+        float next_y = dy != 0 ? (step_y > 0 ? y + 1 - from.y : from.y - y) * delta_y : infinity;
+
+        while (x != end_x || y != end_y)
+        {
+            if (x != end_x && y != end_y && std::abs(next_x - next_y) < 1e-5f)
+            {
+                if (!IsWalkable(Point2DI(x + step_x, y)) || !IsWalkable(Point2DI(x, y + step_y)))
+                {
+                    return false;
+                }
+                x += step_x;
+                y += step_y;
+                next_x += delta_x;
+                next_y += delta_y;
+            }
+            else if (y == end_y || (x != end_x && next_x < next_y))
+            {
+                x += step_x;
+                next_x += delta_x;
+            }
+            else
+            {
+                y += step_y;
+                next_y += delta_y;
+            }
+
+            if (!IsWalkable(Point2DI(x, y)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int PathFinder::Width() const
+    {
+        return width_;
+    }
+
+    int PathFinder::Height() const
+    {
+        return height_;
+    }
+
+    bool PathFinder::FindPath(const Point2D &from, const Point2D &to, Path *path)
+    {
+        Point2DI start_cell = CellOf(from);
+        Point2DI goal_cell = CellOf(to);
+        if (start_cell.x < 0 || start_cell.y < 0 || start_cell.x >= width_ || start_cell.y >= height_ ||
+            !IsWalkable(goal_cell))
+        {
+            return false;
+        }
+
+        const int start = start_cell.y * width_ + start_cell.x;
+        const int goal = goal_cell.y * width_ + goal_cell.x;
+
+        // A search for an unreachable goal would visit every cell it can reach before giving up. Blocked starts have no
+        // region and always run the search.
+        if (regions_dirty_)
+        {
+            UpdateRegions();
+        }
+        if (!Blocked(start) && region_[start] != region_[goal])
+        {
+            return false;
+        }
+
+        if (++search_ == 0)
+        {
+            std::fill(visited_.begin(), visited_.end(), 0);
+            std::fill(closed_.begin(), closed_.end(), 0);
+            search_ = 1;
+        }
+
+        auto later = [](const OpenNode &a, const OpenNode &b) { return a.estimate > b.estimate; };
+        open_.clear();
+        visited_[start] = search_;
+        cost_[start] = 0.0f;
+        parent_[start] = -1;
+        open_.push_back({OctileDistance(goal_cell.x - start_cell.x, goal_cell.y - start_cell.y), start});
+
+        bool found = false;
+        while (!open_.empty())
+        {
+            std::pop_heap(open_.begin(), open_.end(), later);
+            const int cell = open_.back().cell;
+            open_.pop_back();
+            // A cell is pushed again whenever a cheaper way to it is found, only the first pop counts.
+            if (closed_[cell] == search_)
+            {
+                continue;
+            }
+            closed_[cell] = search_;
+            if (cell == goal)
+            {
+                found = true;
+                break;
+            }
+
+            const int x = cell % width_;
+            const int y = cell / width_;
+            for (int i = 0; i < 8; ++i)
+            {
+                const int nx = x + kNeighbourX[i];
+                const int ny = y + kNeighbourY[i];
+                if (nx < 0 || ny < 0 || nx >= width_ || ny >= height_)
+                {
+                    continue;
+                }
+
+                const int neighbour = ny * width_ + nx;
+                if (Blocked(neighbour) || closed_[neighbour] == search_)
+                {
+                    continue;
+                }
+
+                const bool diagonal = kNeighbourX[i] != 0 && kNeighbourY[i] != 0;
+                // Diagonal moves may not squeeze between two blocked cells or cut the corner of one.
+                if (diagonal && (Blocked(y * width_ + nx) || Blocked(ny * width_ + x)))
+                {
+                    continue;
+                }
+
+                const float cost = cost_[cell] + (diagonal ? kDiagonalCost : 1.0f);
+                if (visited_[neighbour] == search_ && cost_[neighbour] <= cost)
+                {
+                    continue;
+                }
+
+                visited_[neighbour] = search_;
+                cost_[neighbour] = cost;
+                parent_[neighbour] = cell;
+                open_.push_back({cost + OctileDistance(goal_cell.x - nx, goal_cell.y - ny), neighbour});
+                std::push_heap(open_.begin(), open_.end(), later);
+            }
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+
+        if (!path)
+        {
+            return true;
+        }
+
+        cells_on_path_.clear();
+        for (int cell = goal; cell != -1; cell = parent_[cell])
+        {
+            cells_on_path_.push_back(cell);
+        }
+        std::reverse(cells_on_path_.begin(), cells_on_path_.end());
+
+        // Keeps the cells where the direction changes, the segments in between are straight.
+        corners_.clear();
+        for (size_t i = 1; i + 1 < cells_on_path_.size(); ++i)
+        {
+            if (cells_on_path_[i] - cells_on_path_[i - 1] != cells_on_path_[i + 1] - cells_on_path_[i])
+            {
+                const int cell = cells_on_path_[i];
+                corners_.push_back(Point2D(cell % width_ + 0.5f, cell / width_ + 0.5f));
+            }
+        }
+        corners_.push_back(to);
+
+        // Octile paths zigzag between equally long alternatives and bend at 45 degrees where units walk straight.
+        // Skipping every corner the previous waypoint can see past removes both.
+        path->waypoints.clear();
+        Point2D anchor = from;
+        for (size_t i = 0; i + 1 < corners_.size(); ++i)
+        {
+            if (!ClearLine(anchor, corners_[i + 1]))
+            {
+                anchor = corners_[i];
+                path->waypoints.push_back(anchor);
+            }
+        }
+        path->waypoints.push_back(to);
+
+        path->distance = 0.0f;
+        Point2D previous = from;
+        for (const Point2D &waypoint : path->waypoints)
+        {
+            path->distance += Distance2D(previous, waypoint);
+            previous = waypoint;
+        }
+        return true;
+    }
+
+    float PathFinder::Distance(const Point2D &from, const Point2D &to)
+    {
+        if (!FindPath(from, to, &distance_path_))
+        {
+            return 0.0f;
+        }
+        return distance_path_.distance;
+    }
+
+    PathFinderValidation ValidatePathFinder(PathFinder &path_finder, QueryInterface &query,
+                                            const std::vector<QueryInterface::PathingQuery> &queries)
+    {
+        std::vector<QueryInterface::PathingQuery> point_queries;
+        for (const QueryInterface::PathingQuery &pathing_query : queries)
+        {
+            if (pathing_query.start_unit_tag_ == NullTag)
+            {
+                point_queries.push_back(pathing_query);
+            }
+        }
+
+        PathFinderValidation validation;
+        if (point_queries.empty())
+        {
+            return validation;
+        }
+
+        std::vector<float> expected = query.PathingDistance(point_queries);
+        int compared = 0;
+        double total_error = 0.0;
+        for (size_t i = 0; i < point_queries.size() && i < expected.size(); ++i)
+        {
+            float distance = path_finder.Distance(point_queries[i].start_, point_queries[i].end_);
+            ++validation.samples;
+            if ((distance > 0.0f) != (expected[i] > 0.0f))
+            {
+                ++validation.reachability_mismatches;
+                continue;
+            }
+            if (expected[i] <= 0.0f)
+            {
+                continue;
+            }
+
+            float error = std::abs(distance - expected[i]) / expected[i];
+            validation.max_relative_error = std::max(validation.max_relative_error, error);
+            total_error += error;
+            ++compared;
+        }
+
+        if (compared > 0)
+        {
+            validation.mean_relative_error = static_cast<float>(total_error / compared);
+        }
+        return validation;
+    }
+}
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 // This assert reflects a guarantee that each request is matched by the correct response.
 static_assert(
@@ -28,6 +29,9 @@ static_assert(
 
 namespace sc2 {
 
+// Requests kept for reuse by MakeRequest, more than this are only in flight when a caller holds on to requests.
+static const std::size_t kMaxPooledRequests = 16;
+
 const char* RequestResponseIDToName(int type) {
     switch (type) {
         case 1: return "CreateGame";
@@ -60,7 +64,9 @@ ProtoInterface::ProtoInterface() :
     port_(5000),
     default_timeout_ms_(kDefaultProtoInterfaceTimeout),
     latest_status_(SC2APIProtocol::Status::unknown),
-    response_pending_(SC2APIProtocol::Response::RESPONSE_NOT_SET) {
+    pipelined_(false),
+    max_pending_depth_(0),
+    requests_sent_(0) {
 }
 
 bool ProtoInterface::ConnectToGame(const std::string& address, int port, int timeout_ms) {
@@ -80,7 +86,19 @@ bool ProtoInterface::ConnectToGame(const std::string& address, int port, int tim
 }
 
 GameRequestPtr ProtoInterface::MakeRequest() {
-    return std::make_shared<SC2APIProtocol::Request>(SC2APIProtocol::Request());
+    // A pooled request is free once the pool holds the only reference to it.
+    for (GameRequestPtr& pooled : request_pool_) {
+        if (pooled.use_count() == 1) {
+            pooled->Clear();
+            return pooled;
+        }
+    }
+
+    GameRequestPtr request = std::make_shared<SC2APIProtocol::Request>();
+    if (request_pool_.size() < kMaxPooledRequests) {
+        request_pool_.push_back(request);
+    }
+    return request;
 }
 
 bool ProtoInterface::SendRequest(GameRequestPtr& request, bool ignore_pending_requests) {
@@ -106,28 +124,43 @@ bool ProtoInterface::SendRequest(GameRequestPtr& request, bool ignore_pending_re
         return false;
     }
 
-    // Technically there can be new requests while responses are pending, but this library is not written for that.
-    // For now, make everything purely sequential.
-    if (!ignore_pending_requests && HasResponsePending()) {
+    DrainDiscardedResponses();
+
+    // Unless pipelining was requested everything is purely sequential.
+    if (!ignore_pending_requests && !pipelined_ && HasResponsePending()) {
         control_->Error(ClientError::ResponseNotConsumed);
         return false;
     }
 
     connection_.Send(request.get());
+    ++requests_sent_;
+    // Send serialized the request, the size it computed is still cached.
+    request_stats_.RecordRequest(request->request_case(), request->GetCachedSize());
 
-    // Expect a certain response.
-    response_pending_ = SC2APIProtocol::Response::ResponseCase(request->request_case());
+    // Expect a certain response. The game answers requests in the order they were sent.
+    // A request that ignores pending ones takes over the queue, as the single pending response did before pipelining,
+    // so its response is not matched against stale entries nothing will wait for anymore.
+    if (ignore_pending_requests) {
+        responses_pending_.clear();
+    }
+    responses_pending_.push_back({SC2APIProtocol::Response::ResponseCase(request->request_case()), std::chrono::steady_clock::now()});
+    max_pending_depth_ = std::max(max_pending_depth_, responses_pending_.size());
     return true;
 }
 
 GameResponsePtr ProtoInterface::WaitForResponseInternal() {
     latest_status_ = SC2APIProtocol::Status::unknown;
     SC2APIProtocol::Response* response = nullptr;
+    auto wait_start = std::chrono::steady_clock::now();
     if (!connection_.Receive(response, default_timeout_ms_)) {
-        // If the receive fails, it means a timeout has occurred.
+        // If the receive fails, it means a timeout has occurred and the connection was dropped,
+        // nothing that is still in flight will arrive.
+        responses_pending_.clear();
         return nullptr;
     }
 
+    SC2APIProtocol::Response::ResponseCase response_pending = GetResponsePending();
+
     for (int i = 0; error_callback_ && response && i < response->error_size(); ++i) {
         error_callback_(response->error(i));
     }
@@ -137,23 +170,50 @@ GameResponsePtr ProtoInterface::WaitForResponseInternal() {
             latest_status_ = response->status();
         }
         if (response->error_size() > 0) {
-            std::cerr << "While waiting for Response" << RequestResponseIDToName(response_pending_) << " received an error." << std::endl;
+            std::cerr << "While waiting for Response" << RequestResponseIDToName(response_pending) << " received an error." << std::endl;
             for (int i = 0; i < response->error_size(); ++i) {
                 std::cerr << "Error: " << response->error(i) << std::endl;
             }
         }
         else {
             SC2APIProtocol::Response::ResponseCase actual_response = response->response_case();
-            if (response_pending_ != actual_response) {
+            if (response_pending != actual_response) {
                 // This is bad, it means we did not get the response that matches the last request.
                 control_->Error(ClientError::ResponseMismatch);
             }
         }
     }
 
-    // No longer expecting a specific response.
-    response_pending_ = SC2APIProtocol::Response::RESPONSE_NOT_SET;
-    return GameResponsePtr(response);
+    // No longer expecting this response.
+    if (!responses_pending_.empty()) {
+        if (response) {
+            const Connection::ReceiveInfo& info = connection_.GetLastReceiveInfo();
+            request_stats_.RecordResponse(
+                responses_pending_.front().response_case,
+                info.bytes,
+                std::chrono::duration_cast<std::chrono::microseconds>(info.received - responses_pending_.front().sent),
+                info.parse_time,
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait_start));
+        }
+        responses_pending_.pop_front();
+    }
+    return connection_.GetResponsePool()->MakeShared(response);
+}
+
+void ProtoInterface::DiscardResponse(uint64_t request_number) {
+    const uint64_t consumed = GetResponsesConsumed();
+    if (request_number <= consumed || request_number > requests_sent_) {
+        return;
+    }
+    responses_pending_[request_number - consumed - 1].discarded = true;
+    DrainDiscardedResponses();
+}
+
+void ProtoInterface::DrainDiscardedResponses() {
+    while (!responses_pending_.empty() && responses_pending_.front().discarded) {
+        // A dropped connection clears the queue, nothing is left to wait for then.
+        WaitForResponseInternal();
+    }
 }
 
 bool ProtoInterface::PingGame() {
@@ -197,7 +257,14 @@ bool ProtoInterface::PollResponse() {
 }
 
 bool ProtoInterface::HasResponsePending() const {
-    return response_pending_ != SC2APIProtocol::Response::ResponseCase::RESPONSE_NOT_SET;
+    return !responses_pending_.empty();
+}
+
+SC2APIProtocol::Response::ResponseCase ProtoInterface::GetResponsePending() const {
+    if (responses_pending_.empty()) {
+        return SC2APIProtocol::Response::RESPONSE_NOT_SET;
+    }
+    return responses_pending_.front().response_case;
 }
 
 }
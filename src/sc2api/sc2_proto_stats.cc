@@ -0,0 +1,169 @@
+#include "sc2api/sc2_proto_stats.h"
+#include "sc2api/sc2_proto_interface.h"
+
+#include <algorithm>
+#include <bit>
+#include <sstream>
+
+namespace sc2 {
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<int>(value);
+    }
+
+    int exponent = std::bit_width(value) - 1;
+    if (exponent > kMaxExponent) {
+        return kBuckets - 1;
+    }
+
+    int sub_bucket = static_cast<int>((value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+    if (index < kSubBuckets) {
+        return static_cast<uint64_t>(index);
+    }
+
+    int exponent = index / kSubBuckets + kSubBucketBits - 1;
+    uint64_t sub_bucket = static_cast<uint64_t>(index % kSubBuckets);
+    uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+    return ((kSubBuckets + sub_bucket) << (exponent - kSubBucketBits)) + width - 1;
+}
+
+void LatencyHistogram::Record(std::chrono::microseconds value) {
+    uint64_t us = static_cast<uint64_t>(std::max<int64_t>(value.count(), 0));
+    ++buckets_[BucketIndex(us)];
+    ++count_;
+    sum_ += us;
+    max_ = std::max(max_, us);
+}
+
+void LatencyHistogram::Reset() {
+    buckets_.fill(0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
+
+std::chrono::microseconds LatencyHistogram::Mean() const {
+    if (count_ == 0) {
+        return std::chrono::microseconds(0);
+    }
+    return std::chrono::microseconds(sum_ / count_);
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double percentile) const {
+    if (count_ == 0) {
+        return std::chrono::microseconds(0);
+    }
+
+    // Rank of the value asked for, counting from 1.
+    double clamped = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count_) + 0.5));
+    rank = std::min(rank, count_);
+
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::chrono::microseconds(std::min(BucketUpperBound(i), max_));
+        }
+    }
+
+    return std::chrono::microseconds(max_);
+}
+
+RequestStats::RequestStats() :
+    requests(0),
+    responses(0),
+    request_bytes(0),
+    response_bytes(0),
+    max_response_bytes(0) {
+}
+
+RequestStats& ProtoStats::At(int request_case) {
+    std::size_t index = static_cast<std::size_t>(std::max(request_case, 0));
+    if (index >= stats_.size()) {
+        stats_.resize(index + 1);
+    }
+    return stats_[index];
+}
+
+void ProtoStats::RecordRequest(int request_case, std::size_t bytes) {
+    RequestStats& stats = At(request_case);
+    ++stats.requests;
+    stats.request_bytes += bytes;
+}
+
+void ProtoStats::RecordResponse(int request_case, std::size_t bytes, std::chrono::microseconds latency, std::chrono::microseconds parse_time, std::chrono::microseconds wait_time) {
+    RequestStats& stats = At(request_case);
+    ++stats.responses;
+    stats.response_bytes += bytes;
+    stats.max_response_bytes = std::max<uint64_t>(stats.max_response_bytes, bytes);
+    stats.latency.Record(latency);
+    stats.parse_time.Record(parse_time);
+    stats.wait_time.Record(wait_time);
+}
+
+void ProtoStats::Reset() {
+    stats_.clear();
+}
+
+const RequestStats& ProtoStats::Get(int request_case) const {
+    static const RequestStats empty;
+    if (request_case < 0 || static_cast<std::size_t>(request_case) >= stats_.size()) {
+        return empty;
+    }
+    return stats_[request_case];
+}
+
+static void WriteHistogram(std::ostringstream& out, const char* name, const LatencyHistogram& histogram) {
+    out << "\"" << name << "\":{"
+        << "\"count\":" << histogram.Count()
+        << ",\"mean\":" << histogram.Mean().count()
+        << ",\"p50\":" << histogram.Percentile(50.0).count()
+        << ",\"p99\":" << histogram.Percentile(99.0).count()
+        << ",\"max\":" << histogram.Max().count()
+        << "}";
+}
+
+std::string ProtoStats::ToJson() const {
+    std::ostringstream out;
+    out << "{";
+    bool first = true;
+    for (std::size_t i = 0; i < stats_.size(); ++i) {
+        const RequestStats& stats = stats_[i];
+        if (stats.requests == 0 && stats.responses == 0) {
+            continue;
+        }
+
+        if (!first) {
+            out << ",";
+        }
+        first = false;
+
+        out << "\"" << RequestResponseIDToName(static_cast<int>(i)) << "\":{"
+            << "\"requests\":" << stats.requests
+            << ",\"responses\":" << stats.responses
+            << ",\"request_bytes\":" << stats.request_bytes
+            << ",\"response_bytes\":" << stats.response_bytes
+            << ",\"max_response_bytes\":" << stats.max_response_bytes
+            << ",";
+        WriteHistogram(out, "latency_us", stats.latency);
+        out << ",";
+        WriteHistogram(out, "parse_us", stats.parse_time);
+        out << ",";
+        WriteHistogram(out, "wait_us", stats.wait_time);
+        out << "}";
+    }
+    out << "}";
+    return out.str();
+}
+
+}
@@ -1,6 +1,10 @@
 #include "sc2api/sc2_proto_to_pods.h"
 #include "sc2api/sc2_unit_filters.h"
+#include "sc2api/sc2_data.h"
+#include "sc2utils/worker_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <cassert>
 
@@ -160,142 +164,314 @@ bool Convert(const SC2APIProtocol::CloakState& cloak_proto, Unit::CloakState& cl
     return false;
 }
 
-bool Convert(const ObservationRawPtr& observation_raw, UnitPool& unit_pool, uint32_t game_loop, uint32_t prev_game_loop) {
-    for (int i = 0; i < observation_raw->units_size(); ++i) {
-        const SC2APIProtocol::Unit& observation_unit = observation_raw->units(i);
-        Unit* unit = unit_pool.CreateUnit(observation_unit.tag());
+// Assigns only if the value differs, so the caller can tell whether anything about a unit changed.
+template<typename T>
+static bool Update(T& field, const T& value) {
+    if (field == value) {
+        return false;
+    }
+    field = value;
+    return true;
+}
 
-        if (!unit) {
-            continue;
-        }
+static bool Update(UnitOrder& order, const SC2APIProtocol::UnitOrder& order_proto, const AbilityRemapTable* ability_remap) {
+    AbilityID ability_id = order_proto.ability_id();
+    if (ability_remap) {
+        ability_id = ability_remap->Remap(ability_id);
+    }
 
-        if (!Convert(observation_unit.display_type(), unit->display_type)) {
-            return false;
-        }
-        if (!Convert(observation_unit.alliance(), unit->alliance)) {
-            return false;
+    bool changed = Update(order.ability_id, ability_id);
+    changed |= Update(order.target_unit_tag, Tag(order_proto.target_unit_tag()));
+    changed |= Update(order.target_pos.x, order_proto.target_world_space_pos().x());
+    changed |= Update(order.target_pos.y, order_proto.target_world_space_pos().y());
+    changed |= Update(order.progress, order_proto.progress());
+    return changed;
+}
+
+static bool Update(PassengerUnit& passenger, const SC2APIProtocol::PassengerUnit& passenger_proto) {
+    PassengerUnit converted;
+    if (passenger_proto.has_tag())
+        converted.tag = passenger_proto.tag();
+    if (passenger_proto.has_health())
+        converted.health = passenger_proto.health();
+    if (passenger_proto.has_health_max())
+        converted.health_max = passenger_proto.health_max();
+    if (passenger_proto.has_shield())
+        converted.shield = passenger_proto.shield();
+    if (passenger_proto.has_shield_max())
+        converted.shield_max = passenger_proto.shield_max();
+    if (passenger_proto.has_energy())
+        converted.energy = passenger_proto.energy();
+    if (passenger_proto.has_energy_max())
+        converted.energy_max = passenger_proto.energy_max();
+    if (passenger_proto.has_unit_type())
+        converted.unit_type = passenger_proto.unit_type();
+
+    bool changed = Update(passenger.tag, converted.tag);
+    changed |= Update(passenger.health, converted.health);
+    changed |= Update(passenger.health_max, converted.health_max);
+    changed |= Update(passenger.shield, converted.shield);
+    changed |= Update(passenger.shield_max, converted.shield_max);
+    changed |= Update(passenger.energy, converted.energy);
+    changed |= Update(passenger.energy_max, converted.energy_max);
+    changed |= Update(passenger.unit_type, converted.unit_type);
+    return changed;
+}
+
+// Brings a list in line with a repeated proto field element by element, without clearing it first.
+template<typename List, typename ProtoList, typename UpdateElement>
+static bool UpdateList(List& list, const ProtoList& protos, UpdateElement update_element) {
+    const std::size_t size = static_cast<std::size_t>(protos.size());
+    bool changed = list.size() != size;
+    if (list.size() > size) {
+        list.resize(size);
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+        if (i == list.size()) {
+            list.emplace_back();
         }
+        changed |= update_element(list[i], protos[static_cast<int>(i)]);
+    }
+    return changed;
+}
+
+template<typename List>
+static bool ClearList(List& list) {
+    if (list.empty()) {
+        return false;
+    }
+    list.clear();
+    return true;
+}
+
+namespace {
 
-        unit->tag = observation_unit.tag();
-        unit->unit_type = UnitTypeID(observation_unit.unit_type());
-        unit->owner = observation_unit.owner();
+// Events found while converting a range of units, in the order of the units in the observation.
+struct UnitEvents {
+    Units completed_buildings;
+    Units idled;
+    UnitsDamaged damaged;
+    Units entered_vision;
+    Units changed;
 
-        const SC2APIProtocol::Point& pt = observation_unit.pos();
-        unit->pos.x = pt.x();
-        unit->pos.y = pt.y();
-        unit->pos.z = pt.z();
-        unit->facing = observation_unit.facing();
-        unit->radius = observation_unit.radius();
+    void Clear() {
+        completed_buildings.clear();
+        idled.clear();
+        damaged.clear();
+        entered_vision.clear();
+        changed.clear();
+    }
 
-        const auto bp = observation_unit.build_progress();
-        if (bp >= 1.0f && unit->build_progress > 0.0f && unit->build_progress < 1.0f) {
+    void AppendTo(UnitPool& unit_pool) const {
+        for (const Unit* unit : completed_buildings)
             unit_pool.AddCompletedBuilding(unit);
+        for (const Unit* unit : idled)
             unit_pool.AddUnitIdled(unit);
+        for (const UnitDamage& damage : damaged)
+            unit_pool.AddUnitDamaged(damage.unit, damage.health, damage.shields);
+        for (const Unit* unit : entered_vision)
+            unit_pool.AddUnitEnteredVision(unit);
+        for (const Unit* unit : changed)
+            unit_pool.AddUnitChanged(unit);
+    }
+};
+
+}
+
+// Only touches the given unit and events, so units can be converted concurrently once their slots are resolved.
+static bool ConvertUnit(const SC2APIProtocol::Unit& observation_unit, Unit* unit, bool created, uint32_t game_loop, uint32_t prev_game_loop, const UnitConversionOptions& options, UnitEvents& events) {
+    Unit::DisplayType display_type;
+    if (!Convert(observation_unit.display_type(), display_type)) {
+        return false;
+    }
+    Unit::Alliance alliance;
+    if (!Convert(observation_unit.alliance(), alliance)) {
+        return false;
+    }
+
+    // A new unit's fields are uninitialized, it counts as changed no matter what they compare to.
+    bool changed = created;
+    changed |= Update(unit->display_type, display_type);
+    changed |= Update(unit->alliance, alliance);
+
+    unit->tag = observation_unit.tag();
+    bool type_changed = Update(unit->unit_type, UnitTypeID(observation_unit.unit_type()));
+    changed |= type_changed;
+    changed |= Update(unit->owner, observation_unit.owner());
+
+    const SC2APIProtocol::Point& pt = observation_unit.pos();
+    changed |= Update(unit->pos.x, pt.x());
+    changed |= Update(unit->pos.y, pt.y());
+    changed |= Update(unit->pos.z, pt.z());
+    changed |= Update(unit->facing, observation_unit.facing());
+    changed |= Update(unit->radius, observation_unit.radius());
+
+    const auto bp = observation_unit.build_progress();
+    if (bp >= 1.0f && unit->build_progress > 0.0f && unit->build_progress < 1.0f) {
+        events.completed_buildings.push_back(unit);
+        events.idled.push_back(unit);
+    }
+    changed |= Update(unit->build_progress, bp);
+
+    Unit::CloakState cloak = Unit::CloakedUnknown;
+    if (observation_unit.has_cloak()) {
+        if (!Convert(observation_unit.cloak(), cloak)) {
+            return false;
         }
-        unit->build_progress = bp;
+    }
+    changed |= Update(unit->cloak, cloak);
+
+    // Parts left out by the conversion mask are reset rather than skipped outright, a new unit has to start out zeroed.
+    const bool convert_ranges = (options.mask & ConversionMask::Ranges) != 0;
+    changed |= Update(unit->detect_range, convert_ranges ? observation_unit.detect_range() : 0.0f);
+    changed |= Update(unit->radar_range, convert_ranges ? observation_unit.radar_range() : 0.0f);
+
+    changed |= Update(unit->is_selected, observation_unit.is_selected());
+    changed |= Update(unit->is_on_screen, (options.mask & ConversionMask::OnScreen) != 0 && observation_unit.is_on_screen());
+    changed |= Update(unit->is_blip, observation_unit.is_blip());
+
+    auto cur_health = observation_unit.health();
+    float damage = unit->health - cur_health;
+    changed |= Update(unit->health, cur_health);
+
+    auto cur_shield = observation_unit.shield();
+    float shield_damage = unit->shield - cur_shield;
+    changed |= Update(unit->shield, cur_shield);
+
+    if (damage > 0 || shield_damage > 0)
+        events.damaged.push_back({unit, damage, shield_damage});
+
+    changed |= Update(unit->health_max, observation_unit.health_max());
+    changed |= Update(unit->shield_max, observation_unit.shield_max());
+    changed |= Update(unit->energy, observation_unit.energy());
+    changed |= Update(unit->energy_max, observation_unit.energy_max());
+
+    changed |= Update(unit->mineral_contents, observation_unit.mineral_contents());
+    changed |= Update(unit->vespene_contents, observation_unit.vespene_contents());
+    changed |= Update(unit->is_flying, observation_unit.is_flying());
+    changed |= Update(unit->is_burrowed, observation_unit.is_burrowed());
+    changed |= Update(unit->is_hallucination, observation_unit.is_hallucination());
+    changed |= Update(unit->weapon_cooldown, observation_unit.weapon_cooldown());
+    changed |= Update(unit->engaged_target_tag, Tag(observation_unit.engaged_target_tag()));
+
+    bool hadOrders = !unit->orders.empty();
+    changed |= UpdateList(unit->orders, observation_unit.orders(),
+        [&options](UnitOrder& order, const SC2APIProtocol::UnitOrder& order_proto) {
+            return Update(order, order_proto, options.ability_remap);
+        });
+    if (hadOrders && unit->orders.empty())
+        events.idled.push_back(unit); 
+
+    changed |= Update(unit->add_on_tag, Tag(observation_unit.add_on_tag()));
+
+    if (options.mask & ConversionMask::Passengers) {
+        changed |= UpdateList(unit->passengers, observation_unit.passengers(),
+            [](PassengerUnit& passenger, const SC2APIProtocol::PassengerUnit& passenger_proto) {
+                return Update(passenger, passenger_proto);
+            });
+        changed |= Update(unit->cargo_space_taken, observation_unit.cargo_space_taken());
+        changed |= Update(unit->cargo_space_max, observation_unit.cargo_space_max());
+    }
+    else {
+        changed |= ClearList(unit->passengers);
+        changed |= Update(unit->cargo_space_taken, 0);
+        changed |= Update(unit->cargo_space_max, 0);
+    }
+    changed |= Update(unit->assigned_harvesters, observation_unit.assigned_harvesters());
+    changed |= Update(unit->ideal_harvesters, observation_unit.ideal_harvesters());
+
+    if (options.mask & ConversionMask::Buffs) {
+        changed |= UpdateList(unit->buffs, observation_unit.buff_ids(),
+            [](BuffID& buff, uint32_t buff_id) {
+                return Update(buff, BuffID(buff_id));
+            });
+    }
+    else {
+        changed |= ClearList(unit->buffs);
+    }
+
+    changed |= Update(unit->is_powered, observation_unit.is_powered());
+    changed |= Update(unit->is_alive, true);
+    if (unit->last_seen_game_loop < prev_game_loop)
+        events.entered_vision.push_back(unit);
+    unit->last_seen_game_loop = game_loop;
+
+    const bool convert_upgrades = (options.mask & ConversionMask::Upgrades) != 0;
+    changed |= Update(unit->attack_upgrade_level, convert_upgrades ? observation_unit.attack_upgrade_level() : 0);
+    changed |= Update(unit->armor_upgrade_level, convert_upgrades ? observation_unit.armor_upgrade_level() : 0);
+    changed |= Update(unit->shield_upgrade_level, convert_upgrades ? observation_unit.shield_upgrade_level() : 0);
+
+    // The type is all that decides whether a unit is a building, only look it up again when it morphs.
+    if (created || type_changed) {
+        unit->is_building = IsBuilding()(unit->unit_type);
+    }
 
-        if (observation_unit.has_cloak()) {
-            if (!Convert(observation_unit.cloak(), unit->cloak)) {
-                return false;
+    if (changed) {
+        unit->last_changed_game_loop = game_loop;
+        events.changed.push_back(unit);
+    }
+    return true;
+}
+
+bool Convert(const ObservationRawPtr& observation_raw, UnitPool& unit_pool, uint32_t game_loop, uint32_t prev_game_loop, const UnitConversionOptions& options) {
+    const std::size_t unit_count = static_cast<std::size_t>(observation_raw->units_size());
+
+    // Scratch space kept between calls, like everything else about conversion it doesn't allocate in steady state.
+    // The references are what the workers see, naming a thread_local from a worker would give it its own empty copy.
+    thread_local std::vector<Unit*> units_scratch;
+    thread_local std::vector<char> created_scratch;
+    thread_local std::vector<UnitEvents> events_scratch;
+    std::vector<Unit*>& units = units_scratch;
+    std::vector<char>& created = created_scratch;
+    std::vector<UnitEvents>& events = events_scratch;
+
+    // Resolving tags to slots may allocate and records new units, it stays sequential so slots and the order of new
+    // units are the same no matter how many threads convert the units.
+    units.resize(unit_count);
+    created.resize(unit_count);
+    for (std::size_t i = 0; i < unit_count; ++i) {
+        bool unit_created = false;
+        units[i] = unit_pool.CreateUnit(observation_raw->units(static_cast<int>(i)).tag(), &unit_created);
+        created[i] = unit_created;
+    }
+
+    const std::size_t units_per_task = std::max<std::size_t>(options.units_per_task, 1);
+    const bool parallel = options.workers && options.workers->Threads() > 1 && unit_count >= 2 * units_per_task;
+    const std::size_t chunk_size = parallel ? units_per_task : std::max<std::size_t>(unit_count, 1);
+    const std::size_t chunks = (unit_count + chunk_size - 1) / chunk_size;
+    if (events.size() < chunks) {
+        events.resize(chunks);
+    }
+
+    std::atomic_bool succeeded = true;
+    auto convert_range = [&](std::size_t begin, std::size_t end) {
+        UnitEvents& chunk_events = events[begin / chunk_size];
+        chunk_events.Clear();
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!units[i]) {
+                continue;
+            }
+            if (!ConvertUnit(observation_raw->units(static_cast<int>(i)), units[i], created[i] != 0, game_loop, prev_game_loop, options, chunk_events)) {
+                succeeded = false;
+                return;
             }
         }
-        else {
-            unit->cloak = Unit::CloakedUnknown;
-        }
-
-        unit->detect_range = observation_unit.detect_range();
-        unit->radar_range = observation_unit.radar_range();
-
-        unit->is_selected = observation_unit.is_selected();
-        unit->is_on_screen = observation_unit.is_on_screen();
-        unit->is_blip = observation_unit.is_blip();
-
-        auto cur_health = observation_unit.health();
-        float damage = unit->health - cur_health;
-        unit->health = cur_health;
-
-        auto cur_shield = observation_unit.shield();
-        float shield_damage = unit->shield - cur_shield;
-        unit->shield = cur_shield;
-
-        if (damage > 0 || shield_damage > 0)
-            unit_pool.AddUnitDamaged(unit, damage, shield_damage);
-
-        unit->health_max = observation_unit.health_max();
-        unit->shield_max = observation_unit.shield_max();
-        unit->energy = observation_unit.energy();
-        unit->energy_max = observation_unit.energy_max();
-
-        unit->mineral_contents = observation_unit.mineral_contents();
-        unit->vespene_contents = observation_unit.vespene_contents();
-        unit->is_flying = observation_unit.is_flying();
-        unit->is_burrowed = observation_unit.is_burrowed();
-        unit->is_hallucination = observation_unit.is_hallucination();
-        unit->weapon_cooldown = observation_unit.weapon_cooldown();
-        unit->engaged_target_tag = observation_unit.engaged_target_tag();
-
-        bool hadOrders = !unit->orders.empty();
-        unit->orders.clear();
-        for (int order_index = 0; order_index < observation_unit.orders_size(); ++order_index) {
-            const SC2APIProtocol::UnitOrder& order_proto = observation_unit.orders(order_index);
-
-            UnitOrder order;
-            order.ability_id = order_proto.ability_id();
-            order.target_unit_tag = order_proto.target_unit_tag();
-            order.target_pos.x = order_proto.target_world_space_pos().x();
-            order.target_pos.y = order_proto.target_world_space_pos().y();
-            order.progress = order_proto.progress();
-            unit->orders.push_back(order);
-        }
-        if (hadOrders && unit->orders.empty())
-            unit_pool.AddUnitIdled(unit); 
-
-        unit->add_on_tag = observation_unit.add_on_tag();
-
-        unit->passengers.clear();
-        for (int passenger_index = 0; passenger_index < observation_unit.passengers_size(); ++passenger_index) {
-            const SC2APIProtocol::PassengerUnit& passengerProto = observation_unit.passengers(passenger_index);
-            PassengerUnit passengerUnit;
-            if (passengerProto.has_tag())
-                passengerUnit.tag = passengerProto.tag();
-            if (passengerProto.has_health())
-                passengerUnit.health = passengerProto.health();
-            if (passengerProto.has_health_max())
-                passengerUnit.health_max = passengerProto.health_max();
-            if (passengerProto.has_shield())
-                passengerUnit.shield = passengerProto.shield();
-            if (passengerProto.has_shield_max())
-                passengerUnit.shield_max = passengerProto.shield_max();
-            if (passengerProto.has_energy())
-                passengerUnit.energy = passengerProto.energy();
-            if (passengerProto.has_energy_max())
-                passengerUnit.energy_max = passengerProto.energy_max();
-            if (passengerProto.has_unit_type())
-                passengerUnit.unit_type = passengerProto.unit_type();
-            unit->passengers.push_back(passengerUnit);
-        }
-
-        unit->cargo_space_taken = observation_unit.cargo_space_taken();
-        unit->cargo_space_max = observation_unit.cargo_space_max();
-        unit->assigned_harvesters = observation_unit.assigned_harvesters();
-        unit->ideal_harvesters = observation_unit.ideal_harvesters();
-
-        unit->buffs.clear();
-        for (int buff_index = 0; buff_index < observation_unit.buff_ids_size(); ++buff_index) {
-            unit->buffs.push_back(observation_unit.buff_ids(buff_index));
-        }
-
-        unit->is_powered = observation_unit.is_powered();
-        unit->is_alive = true;
-        if (unit->last_seen_game_loop < prev_game_loop)
-            unit_pool.AddUnitEnteredVision(unit);
-        unit->last_seen_game_loop = game_loop;
+    };
 
-        unit->attack_upgrade_level = observation_unit.attack_upgrade_level();
-        unit->armor_upgrade_level = observation_unit.armor_upgrade_level();
-        unit->shield_upgrade_level = observation_unit.shield_upgrade_level();
+    if (parallel) {
+        options.workers->ParallelFor(unit_count, chunk_size, convert_range);
+    }
+    else {
+        convert_range(0, unit_count);
+    }
 
-        unit->is_building = IsBuilding()(unit->unit_type);
+    if (!succeeded) {
+        return false;
+    }
+
+    // Chunks cover the units in order, appending their events chunk by chunk gives the order a sequential pass would.
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        events[chunk].AppendTo(unit_pool);
     }
 
     return true;
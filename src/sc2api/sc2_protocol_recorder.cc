@@ -0,0 +1,209 @@
+#include "sc2api/sc2_protocol_recorder.h"
+
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+namespace sc2
+{
+    static const char kTraceMagic[8] = {'S', 'C', '2', 'T', 'R', 'A', 'C', 'E'};
+    static const uint32_t kTraceVersion = 1;
+    // Size of the fixed part of a record: direction, timestamp and length.
+    static const std::size_t kRecordHeaderSize = 1 + 8 + 4;
+
+    static void AppendLittleEndian(std::vector<char> &out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+        {
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    static uint64_t ReadLittleEndian(const unsigned char *in, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    ProtocolRecorder::ProtocolRecorder() : recording_(false),
+                                           file_(nullptr),
+                                           stop_(false) {}
+
+    ProtocolRecorder::~ProtocolRecorder()
+    {
+        Stop();
+    }
+
+    bool ProtocolRecorder::Start(const std::string &path)
+    {
+        Stop();
+
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_)
+        {
+            SPDLOG_ERROR("[RECORDER] Unable to create protocol trace {}", path);
+            return false;
+        }
+
+        std::vector<char> header(kTraceMagic, kTraceMagic + sizeof(kTraceMagic));
+        AppendLittleEndian(header, kTraceVersion, 4);
+        auto wall_clock = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        AppendLittleEndian(header, static_cast<uint64_t>(wall_clock.count()), 8);
+        std::fwrite(header.data(), 1, header.size(), file_);
+
+        start_ = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            pending_.clear();
+            stop_ = false;
+        }
+        writer_ = std::thread(&ProtocolRecorder::WriterThread, this);
+        recording_ = true;
+        SPDLOG_INFO("[RECORDER] Recording protocol trace to {}", path);
+        return true;
+    }
+
+    void ProtocolRecorder::Stop()
+    {
+        if (!writer_.joinable())
+        {
+            return;
+        }
+
+        recording_ = false;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_one();
+        writer_.join();
+
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    bool ProtocolRecorder::IsRecording() const
+    {
+        return recording_;
+    }
+
+    void ProtocolRecorder::Record(ProtocolDirection direction, const void *data, std::size_t size)
+    {
+        if (!recording_)
+        {
+            return;
+        }
+
+        auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            pending_.push_back(static_cast<char>(direction));
+            AppendLittleEndian(pending_, static_cast<uint64_t>(timestamp.count()), 8);
+            AppendLittleEndian(pending_, static_cast<uint64_t>(size), 4);
+            const char *bytes = static_cast<const char *>(data);
+            pending_.insert(pending_.end(), bytes, bytes + size);
+        }
+        condition_.notify_one();
+    }
+
+    void ProtocolRecorder::WriterThread()
+    {
+        // Swapped with pending_ so records can keep coming in while this one is written, both keep their capacity.
+        std::vector<char> writing;
+        bool stopping = false;
+        while (!stopping)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+                stopping = stop_;
+                writing.swap(pending_);
+            }
+
+            if (!writing.empty())
+            {
+                std::fwrite(writing.data(), 1, writing.size(), file_);
+                writing.clear();
+            }
+        }
+
+        std::fflush(file_);
+    }
+
+    ProtocolTraceReader::ProtocolTraceReader() : file_(nullptr) {}
+
+    ProtocolTraceReader::~ProtocolTraceReader()
+    {
+        Close();
+    }
+
+    bool ProtocolTraceReader::Open(const std::string &path)
+    {
+        Close();
+
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_)
+        {
+            return false;
+        }
+
+        unsigned char header[sizeof(kTraceMagic) + 4 + 8];
+        if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+            std::memcmp(header, kTraceMagic, sizeof(kTraceMagic)) != 0 ||
+            ReadLittleEndian(header + sizeof(kTraceMagic), 4) != kTraceVersion)
+        {
+            SPDLOG_ERROR("[RECORDER] {} is not a protocol trace", path);
+            Close();
+            return false;
+        }
+
+        auto wall_clock = std::chrono::microseconds(ReadLittleEndian(header + sizeof(kTraceMagic) + 4, 8));
+        start_time_ = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(wall_clock));
+        return true;
+    }
+
+    void ProtocolTraceReader::Close()
+    {
+        if (file_)
+        {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    bool ProtocolTraceReader::Next(ProtocolTraceRecord &record)
+    {
+        if (!file_)
+        {
+            return false;
+        }
+
+        unsigned char header[kRecordHeaderSize];
+        if (std::fread(header, 1, sizeof(header), file_) != sizeof(header))
+        {
+            return false;
+        }
+
+        record.direction = static_cast<ProtocolDirection>(header[0]);
+        record.timestamp = std::chrono::microseconds(ReadLittleEndian(header + 1, 8));
+        std::size_t size = static_cast<std::size_t>(ReadLittleEndian(header + 9, 4));
+        record.payload.resize(size);
+        if (size > 0 && std::fread(record.payload.data(), 1, size, file_) != size)
+        {
+            SPDLOG_WARN("[RECORDER] Protocol trace is truncated");
+            return false;
+        }
+
+        return true;
+    }
+
+    std::chrono::system_clock::time_point ProtocolTraceReader::GetStartTime() const
+    {
+        return start_time_;
+    }
+}
@@ -2,6 +2,7 @@
 #include "sc2api/sc2_server.h"
 #include "s2clientprotocol/sc2api.pb.h"
 
+#include <chrono>
 #include <spdlog/spdlog.h>
 
 namespace sc2
@@ -28,7 +29,10 @@ namespace sc2
 
     Server::~Server()
     {
-        webSocketServer->stop();
+        if (webSocketServer)
+        {
+            webSocketServer->stop();
+        }
     }
 
     bool Server::Listen(int listeningPort, const char *requestTimeoutMs, const char *websocketTimeoutMs, const char *numThreads)
@@ -86,6 +90,7 @@ namespace sc2
         request_mutex.lock();
         requests.emplace(conn, request);
         request_mutex.unlock();
+        request_condition.notify_one();
     }
 
     void Server::QueueResponse(ix::WebSocket *conn, SC2APIProtocol::Response *&response)
@@ -134,4 +139,28 @@ namespace sc2
     {
         return responses.front();
     }
+
+    RequestData Server::PopRequest()
+    {
+        std::lock_guard<std::mutex> guard(request_mutex);
+        if (requests.empty())
+        {
+            return RequestData(nullptr, nullptr);
+        }
+
+        RequestData request = requests.front();
+        requests.pop();
+        return request;
+    }
+
+    bool Server::WaitForRequest(unsigned int timeout_ms)
+    {
+        std::unique_lock<std::mutex> lock(request_mutex);
+        return request_condition.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return !requests.empty(); });
+    }
+
+    int Server::GetPort() const
+    {
+        return webSocketServer ? webSocketServer->getPort() : 0;
+    }
 }
@@ -2,12 +2,54 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 #include "s2clientprotocol/sc2api.pb.h"
 
 namespace sc2 {
 
-Unit::Unit() {
+Unit::Unit() :
+    display_type(Visible),
+    alliance(Self),
+    tag(NullTag),
+    unit_type(0),
+    owner(0),
+    facing(0.0f),
+    radius(0.0f),
+    build_progress(0.0f),
+    cloak(CloakedUnknown),
+    detect_range(0.0f),
+    radar_range(0.0f),
+    is_selected(false),
+    is_on_screen(false),
+    is_blip(false),
+    health(0.0f),
+    health_max(0.0f),
+    shield(0.0f),
+    shield_max(0.0f),
+    energy(0.0f),
+    energy_max(0.0f),
+    mineral_contents(0),
+    vespene_contents(0),
+    is_flying(false),
+    is_burrowed(false),
+    is_hallucination(false),
+    weapon_cooldown(0.0f),
+    add_on_tag(NullTag),
+    cargo_space_taken(0),
+    cargo_space_max(0),
+    assigned_harvesters(0),
+    ideal_harvesters(0),
+    engaged_target_tag(NullTag),
+    is_powered(false),
+    is_alive(false),
+    last_seen_game_loop(0),
+    last_changed_game_loop(0),
+    generation(0),
+    attack_upgrade_level(0),
+    armor_upgrade_level(0),
+    shield_upgrade_level(0),
+    is_building(false) {
 }
 
 bool Unit::IsBuildFinished() const {
@@ -24,35 +66,57 @@ Tags ConvertToTags(const Units& units) {
     return tags;
 }
 
-Unit* UnitPool::CreateUnit(Tag tag) {
+Unit* UnitPool::CreateUnit(Tag tag, bool* created) {
     Unit* existing = GetUnit(tag);
+    if (created) {
+        *created = !existing;
+    }
     if (existing) {
-        tag_to_existing_unit_[tag] = existing;
+        tag_to_existing_unit_.Insert(tag, existing);
         return existing;
     }
 
-    if (unit_pool_.empty() || unit_pool_.size() == available_index_.first) {
-        unit_pool_.push_back(std::vector<Unit>(ENTRY_SIZE));
+    Unit* unit = nullptr;
+    if (!free_units_.empty()) {
+        unit = free_units_.back();
+        free_units_.pop_back();
+        // Start from the same state as a slot that was never used, nothing of the previous unit may leak through.
+        uint32_t generation = unit->generation + 1;
+        *unit = Unit();
+        unit->generation = generation;
+        ++recycled_;
+    }
+    else {
+        if (unit_pool_.empty() || unit_pool_.size() == available_index_.first) {
+            unit_pool_.push_back(std::vector<Unit>(ENTRY_SIZE));
+        }
+
+        std::vector<Unit>& pool = unit_pool_[available_index_.first];
+        unit = &pool[available_index_.second];
+        IncrementIndex();
     }
 
-    std::vector<Unit>& pool = unit_pool_[available_index_.first];
-    Unit* unit = &pool[available_index_.second];
     unit->last_seen_game_loop = 0; // initialization required for OnUnitEnterVision
-    tag_to_unit_[tag] = unit;
-    tag_to_existing_unit_[tag] = unit;
+    tag_to_unit_.Insert(tag, unit);
+    tag_to_existing_unit_.Insert(tag, unit);
+    high_water_mark_ = std::max(high_water_mark_, tag_to_unit_.Size());
     AddNewUnit(unit);
-    IncrementIndex();
     return unit;
 }
 
 Unit* UnitPool::GetUnit(Tag tag) const {
-    auto found = tag_to_unit_.find(tag);
-    return found == tag_to_unit_.end() ? nullptr : found->second;
+    Unit* const* found = tag_to_unit_.Find(tag);
+    return found ? *found : nullptr;
+}
+
+Unit* UnitPool::GetUnit(Tag tag, uint32_t generation) const {
+    Unit* unit = GetUnit(tag);
+    return unit && unit->generation == generation ? unit : nullptr;
 }
 
 Unit* UnitPool::GetExistingUnit(Tag tag) const {
-    auto found = tag_to_existing_unit_.find(tag);
-    return found == tag_to_existing_unit_.end() ? nullptr : found->second;
+    Unit* const* found = tag_to_existing_unit_.Find(tag);
+    return found ? *found : nullptr;
 }
 
 void UnitPool::IncrementIndex() {
@@ -70,27 +134,100 @@ void UnitPool::MarkDead(Tag tag) {
     }
     unit->is_alive = false;
     // CHeck if this is necessary, bro
-    tag_to_existing_unit_.erase(tag);
+    tag_to_existing_unit_.Erase(tag);
+    if (recycle_delay_ != kNeverRecycleUnits) {
+        dead_units_.emplace_back(tag, unit->last_seen_game_loop);
+    }
+}
+
+void UnitPool::RecycleDeadUnits(uint32_t game_loop) {
+    if (recycle_delay_ == kNeverRecycleUnits) {
+        last_recycle_game_loop_ = game_loop;
+        return;
+    }
+
+    if (game_loop < last_recycle_game_loop_) {
+        // A new game, nothing from the previous one can be observed anymore.
+        for (auto& entry : tag_to_unit_) {
+            free_units_.push_back(entry.value);
+        }
+        tag_to_unit_.Clear();
+        tag_to_existing_unit_.Clear();
+        dead_units_.clear();
+        next_sweep_game_loop_ = 0;
+    }
+    last_recycle_game_loop_ = game_loop;
+
+    while (!dead_units_.empty() && uint64_t(dead_units_.front().second) + recycle_delay_ <= game_loop) {
+        Tag tag = dead_units_.front().first;
+        dead_units_.pop_front();
+
+        Unit* unit = GetUnit(tag);
+        // The unit may have been seen again since, the stamp on the unit itself is the one that counts.
+        if (!unit || unit->is_alive || uint64_t(unit->last_seen_game_loop) + recycle_delay_ > game_loop) {
+            continue;
+        }
+        free_units_.push_back(unit);
+        tag_to_unit_.Erase(tag);
+    }
+
+    // Units that left the observation without a death event never get into dead_units_. Looking for them walks every
+    // unit, so it only runs once the first of them is due, which is never sooner than the delay from now.
+    if (game_loop < next_sweep_game_loop_) {
+        return;
+    }
+    uint32_t first_seen_game_loop = game_loop;
+    std::vector<Tag> vanished;
+    for (auto& entry : tag_to_unit_) {
+        const Unit* unit = entry.value;
+        if (!unit->is_alive || tag_to_existing_unit_.Find(entry.key)) {
+            continue;
+        }
+        if (uint64_t(unit->last_seen_game_loop) + recycle_delay_ <= game_loop) {
+            vanished.push_back(entry.key);
+        }
+        else {
+            first_seen_game_loop = std::min(first_seen_game_loop, unit->last_seen_game_loop);
+        }
+    }
+    next_sweep_game_loop_ =
+        static_cast<uint32_t>(std::min<uint64_t>(uint64_t(first_seen_game_loop) + recycle_delay_, kNeverRecycleUnits));
+    for (Tag tag : vanished) {
+        free_units_.push_back(GetUnit(tag));
+        tag_to_unit_.Erase(tag);
+    }
+}
+
+UnitPoolStats UnitPool::GetStats() const {
+    UnitPoolStats stats;
+    stats.capacity = unit_pool_.size() * ENTRY_SIZE;
+    stats.in_use = tag_to_unit_.Size();
+    stats.free = free_units_.size();
+    stats.high_water_mark = high_water_mark_;
+    stats.recycled = recycled_;
+    return stats;
 }
 
 void UnitPool::ForEachExistingUnit(const std::function<void(Unit& unit)>& functor) const {
     for (auto& u : tag_to_existing_unit_) {
-        assert(u.second);
-        functor(*u.second);
+        assert(u.value);
+        functor(*u.value);
     }
 }
 
 void UnitPool::ClearExisting() {
-    tag_to_existing_unit_.clear();
+    // Keeps its slots, the next observation is usually about as large as this one.
+    tag_to_existing_unit_.Clear();
     units_newly_created_.clear();
     units_entering_vision_.clear();
     buildings_constructed_.clear();
     units_idled_.clear();
     units_damaged_.clear();
+    units_changed_.clear();
 }
 
 bool UnitPool::UnitExists(Tag tag) {
-    return tag_to_existing_unit_.find(tag) != tag_to_existing_unit_.end();
+    return tag_to_existing_unit_.Contains(tag);
 }
 
 }
@@ -1,7 +1,181 @@
 #include "sc2api/sc2_unit_filters.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
 namespace sc2 {
 
+// Category flags of a unit type.
+static constexpr uint8_t kTownHall = 1 << 0;
+static constexpr uint8_t kMineralPatch = 1 << 1;
+static constexpr uint8_t kGeyser = 1 << 2;
+static constexpr uint8_t kBuilding = 1 << 3;
+static constexpr uint8_t kWorker = 1 << 4;
+
+static constexpr UNIT_TYPEID kTownHallTypes[] = {
+    UNIT_TYPEID::PROTOSS_NEXUS,
+    UNIT_TYPEID::TERRAN_COMMANDCENTER,
+    UNIT_TYPEID::TERRAN_COMMANDCENTERFLYING,
+    UNIT_TYPEID::TERRAN_ORBITALCOMMAND,
+    UNIT_TYPEID::TERRAN_ORBITALCOMMANDFLYING,
+    UNIT_TYPEID::TERRAN_PLANETARYFORTRESS,
+    UNIT_TYPEID::ZERG_HATCHERY,
+    UNIT_TYPEID::ZERG_HIVE,
+    UNIT_TYPEID::ZERG_LAIR,
+};
+
+static constexpr UNIT_TYPEID kMineralPatchTypes[] = {
+    UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD,
+    UNIT_TYPEID::NEUTRAL_LABMINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_LABMINERALFIELD,
+    UNIT_TYPEID::NEUTRAL_MINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_MINERALFIELD,
+    UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD,
+    UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD,
+    UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD750,
+    UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD,
+};
+
+static constexpr UNIT_TYPEID kGeyserTypes[] = {
+    UNIT_TYPEID::NEUTRAL_VESPENEGEYSER,
+    UNIT_TYPEID::NEUTRAL_PROTOSSVESPENEGEYSER,
+    UNIT_TYPEID::NEUTRAL_SPACEPLATFORMGEYSER,
+    UNIT_TYPEID::NEUTRAL_PURIFIERVESPENEGEYSER,
+    UNIT_TYPEID::NEUTRAL_SHAKURASVESPENEGEYSER,
+    UNIT_TYPEID::NEUTRAL_RICHVESPENEGEYSER,
+};
+
+static constexpr UNIT_TYPEID kBuildingTypes[] = {
+    // Terran
+    UNIT_TYPEID::TERRAN_ARMORY,
+    UNIT_TYPEID::TERRAN_BARRACKS,
+    UNIT_TYPEID::TERRAN_BARRACKSFLYING,
+    UNIT_TYPEID::TERRAN_BARRACKSREACTOR,
+    UNIT_TYPEID::TERRAN_BARRACKSTECHLAB,
+    UNIT_TYPEID::TERRAN_BUNKER,
+    UNIT_TYPEID::TERRAN_COMMANDCENTER,
+    UNIT_TYPEID::TERRAN_COMMANDCENTERFLYING,
+    UNIT_TYPEID::TERRAN_ENGINEERINGBAY,
+    UNIT_TYPEID::TERRAN_FACTORY,
+    UNIT_TYPEID::TERRAN_FACTORYFLYING,
+    UNIT_TYPEID::TERRAN_FACTORYREACTOR,
+    UNIT_TYPEID::TERRAN_FACTORYTECHLAB,
+    UNIT_TYPEID::TERRAN_FUSIONCORE,
+    UNIT_TYPEID::TERRAN_GHOSTACADEMY,
+    UNIT_TYPEID::TERRAN_MISSILETURRET,
+    UNIT_TYPEID::TERRAN_ORBITALCOMMAND,
+    UNIT_TYPEID::TERRAN_ORBITALCOMMANDFLYING,
+    UNIT_TYPEID::TERRAN_PLANETARYFORTRESS,
+    UNIT_TYPEID::TERRAN_REFINERY,
+    UNIT_TYPEID::TERRAN_SENSORTOWER,
+    UNIT_TYPEID::TERRAN_STARPORT,
+    UNIT_TYPEID::TERRAN_STARPORTFLYING,
+    UNIT_TYPEID::TERRAN_STARPORTREACTOR,
+    UNIT_TYPEID::TERRAN_STARPORTTECHLAB,
+    UNIT_TYPEID::TERRAN_SUPPLYDEPOT,
+    UNIT_TYPEID::TERRAN_SUPPLYDEPOTLOWERED,
+    UNIT_TYPEID::TERRAN_REACTOR,
+    UNIT_TYPEID::TERRAN_TECHLAB,
+
+    // Zerg
+    UNIT_TYPEID::ZERG_BANELINGNEST,
+    UNIT_TYPEID::ZERG_CREEPTUMOR,
+    UNIT_TYPEID::ZERG_CREEPTUMORBURROWED,
+    UNIT_TYPEID::ZERG_CREEPTUMORQUEEN,
+    UNIT_TYPEID::ZERG_EVOLUTIONCHAMBER,
+    UNIT_TYPEID::ZERG_EXTRACTOR,
+    UNIT_TYPEID::ZERG_GREATERSPIRE,
+    UNIT_TYPEID::ZERG_HATCHERY,
+    UNIT_TYPEID::ZERG_HIVE,
+    UNIT_TYPEID::ZERG_HYDRALISKDEN,
+    UNIT_TYPEID::ZERG_INFESTATIONPIT,
+    UNIT_TYPEID::ZERG_LAIR,
+    UNIT_TYPEID::ZERG_LURKERDENMP,
+    UNIT_TYPEID::ZERG_NYDUSCANAL,
+    UNIT_TYPEID::ZERG_NYDUSNETWORK,
+    UNIT_TYPEID::ZERG_ROACHWARREN,
+    UNIT_TYPEID::ZERG_SPAWNINGPOOL,
+    UNIT_TYPEID::ZERG_SPINECRAWLER,
+    UNIT_TYPEID::ZERG_SPINECRAWLERUPROOTED,
+    UNIT_TYPEID::ZERG_SPIRE,
+    UNIT_TYPEID::ZERG_SPORECRAWLER,
+    UNIT_TYPEID::ZERG_SPORECRAWLERUPROOTED,
+    UNIT_TYPEID::ZERG_ULTRALISKCAVERN,
+
+    // Protoss
+    UNIT_TYPEID::PROTOSS_ASSIMILATOR,
+    UNIT_TYPEID::PROTOSS_CYBERNETICSCORE,
+    UNIT_TYPEID::PROTOSS_DARKSHRINE,
+    UNIT_TYPEID::PROTOSS_FLEETBEACON,
+    UNIT_TYPEID::PROTOSS_FORGE,
+    UNIT_TYPEID::PROTOSS_GATEWAY,
+    UNIT_TYPEID::PROTOSS_NEXUS,
+    UNIT_TYPEID::PROTOSS_PHOTONCANNON,
+    UNIT_TYPEID::PROTOSS_PYLON,
+    UNIT_TYPEID::PROTOSS_PYLONOVERCHARGED,
+    UNIT_TYPEID::PROTOSS_ROBOTICSBAY,
+    UNIT_TYPEID::PROTOSS_ROBOTICSFACILITY,
+    UNIT_TYPEID::PROTOSS_STARGATE,
+    UNIT_TYPEID::PROTOSS_TEMPLARARCHIVE,
+    UNIT_TYPEID::PROTOSS_TWILIGHTCOUNCIL,
+    UNIT_TYPEID::PROTOSS_WARPGATE,
+    UNIT_TYPEID::PROTOSS_SHIELDBATTERY,
+};
+
+static constexpr UNIT_TYPEID kWorkerTypes[] = {
+    UNIT_TYPEID::TERRAN_SCV,
+    UNIT_TYPEID::ZERG_DRONE,
+    UNIT_TYPEID::PROTOSS_PROBE,
+};
+
+template <size_t N>
+static constexpr size_t TableSizeFor(const UNIT_TYPEID (&types)[N], size_t size) {
+    for (UNIT_TYPEID type : types) {
+        size = std::max(size, static_cast<size_t>(type) + 1);
+    }
+    return size;
+}
+
+// Large enough to index every type in the lists, other types have no category.
+static constexpr size_t kUnitTypeTableSize =
+    TableSizeFor(kWorkerTypes, TableSizeFor(kBuildingTypes, TableSizeFor(kGeyserTypes,
+    TableSizeFor(kMineralPatchTypes, TableSizeFor(kTownHallTypes, 0)))));
+
+using UnitTypeCategories = std::array<uint8_t, kUnitTypeTableSize>;
+
+template <size_t N>
+static constexpr void AddCategory(UnitTypeCategories& table, const UNIT_TYPEID (&types)[N], uint8_t category) {
+    for (UNIT_TYPEID type : types) {
+        table[static_cast<size_t>(type)] |= category;
+    }
+}
+
+static constexpr UnitTypeCategories MakeUnitTypeCategories() {
+    UnitTypeCategories table{};
+    AddCategory(table, kTownHallTypes, kTownHall);
+    AddCategory(table, kMineralPatchTypes, kMineralPatch);
+    AddCategory(table, kGeyserTypes, kGeyser);
+    AddCategory(table, kBuildingTypes, kBuilding);
+    AddCategory(table, kWorkerTypes, kWorker);
+    return table;
+}
+
+// Category flags of every unit type indexed by UNIT_TYPEID. It is generated at compile time from the lists above, so
+// it follows the typeenums of the game version the API is built for.
+static constexpr UnitTypeCategories kUnitTypeCategories = MakeUnitTypeCategories();
+
+static_assert(kUnitTypeCategories[static_cast<size_t>(UNIT_TYPEID::TERRAN_COMMANDCENTER)] == (kTownHall | kBuilding));
+static_assert(kUnitTypeCategories[static_cast<size_t>(UNIT_TYPEID::TERRAN_SCV)] == kWorker);
+
+static bool HasCategory(UNIT_TYPEID type, uint8_t category) {
+    size_t index = static_cast<size_t>(type);
+    return index < kUnitTypeTableSize && (kUnitTypeCategories[index] & category) != 0;
+}
+
 IsUnit::IsUnit(UNIT_TYPEID type_): m_type(type_) {
 }
 
@@ -9,16 +183,21 @@ bool IsUnit::operator()(const Unit& unit_) const {
     return unit_.unit_type == m_type;
 }
 
-IsUnits::IsUnits(const std::vector<UNIT_TYPEID>& types_): m_types(types_) {
+IsUnits::IsUnits(const std::vector<UNIT_TYPEID>& types_) {
+    for (UNIT_TYPEID type : types_) {
+        size_t index = static_cast<size_t>(type);
+        if (index / 64 >= m_types.size())
+            m_types.resize(index / 64 + 1, 0);
+        m_types[index / 64] |= uint64_t(1) << (index % 64);
+    }
 }
 
 bool IsUnits::operator()(const Unit& unit_) const {
-    for (const auto& type : m_types) {
-        if (unit_.unit_type == type)
-            return true;
-    }
+    uint32_t index = unit_.unit_type;
+    if (index / 64 >= m_types.size())
+        return false;
 
-    return false;
+    return (m_types[index / 64] >> (index % 64)) & 1;
 }
 
 bool IsTownHall::operator()(const Unit& unit_) const {
@@ -26,15 +205,7 @@ bool IsTownHall::operator()(const Unit& unit_) const {
 }
 
 bool IsTownHall::operator()(UNIT_TYPEID type_) const {
-    return type_ == UNIT_TYPEID::PROTOSS_NEXUS ||
-           type_ == UNIT_TYPEID::TERRAN_COMMANDCENTER ||
-           type_ == UNIT_TYPEID::TERRAN_COMMANDCENTERFLYING ||
-           type_ == UNIT_TYPEID::TERRAN_ORBITALCOMMAND ||
-           type_ == UNIT_TYPEID::TERRAN_ORBITALCOMMANDFLYING ||
-           type_ == UNIT_TYPEID::TERRAN_PLANETARYFORTRESS ||
-           type_ == UNIT_TYPEID::ZERG_HATCHERY ||
-           type_ == UNIT_TYPEID::ZERG_HIVE ||
-           type_ == UNIT_TYPEID::ZERG_LAIR;
+    return HasCategory(type_, kTownHall);
 }
 
 bool IsMineralPatch::operator()(const Unit& unit_) const {
@@ -42,18 +213,7 @@ bool IsMineralPatch::operator()(const Unit& unit_) const {
 }
 
 bool IsMineralPatch::operator()(UNIT_TYPEID type_) const {
-    return type_ == UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_BATTLESTATIONMINERALFIELD ||
-           type_ == UNIT_TYPEID::NEUTRAL_LABMINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_LABMINERALFIELD ||
-           type_ == UNIT_TYPEID::NEUTRAL_MINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_MINERALFIELD ||
-           type_ == UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_PURIFIERMINERALFIELD ||
-           type_ == UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_PURIFIERRICHMINERALFIELD ||
-           type_ == UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD750 ||
-           type_ == UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD;
+    return HasCategory(type_, kMineralPatch);
 }
 
 bool IsVisibleMineralPatch::operator()(const Unit& unit_) const {
@@ -65,12 +225,7 @@ bool IsGeyser::operator()(const Unit& unit_) const {
 }
 
 bool IsGeyser::operator()(UNIT_TYPEID type_) const {
-    return type_ == UNIT_TYPEID::NEUTRAL_VESPENEGEYSER ||
-           type_ == UNIT_TYPEID::NEUTRAL_PROTOSSVESPENEGEYSER ||
-           type_ == UNIT_TYPEID::NEUTRAL_SPACEPLATFORMGEYSER ||
-           type_ == UNIT_TYPEID::NEUTRAL_PURIFIERVESPENEGEYSER ||
-           type_ == UNIT_TYPEID::NEUTRAL_SHAKURASVESPENEGEYSER ||
-           type_ == UNIT_TYPEID::NEUTRAL_RICHVESPENEGEYSER;
+    return HasCategory(type_, kGeyser);
 }
 
 bool IsVisibleGeyser::operator()(const Unit& unit_) const {
@@ -82,86 +237,7 @@ bool IsBuilding::operator()(const Unit& unit_) const {
 }
 
 bool IsBuilding::operator()(UNIT_TYPEID type_) const {
-    switch (type_) {
-        // Terran
-        case UNIT_TYPEID::TERRAN_ARMORY:
-        case UNIT_TYPEID::TERRAN_BARRACKS:
-        case UNIT_TYPEID::TERRAN_BARRACKSFLYING:
-        case UNIT_TYPEID::TERRAN_BARRACKSREACTOR:
-        case UNIT_TYPEID::TERRAN_BARRACKSTECHLAB:
-        case UNIT_TYPEID::TERRAN_BUNKER:
-        case UNIT_TYPEID::TERRAN_COMMANDCENTER:
-        case UNIT_TYPEID::TERRAN_COMMANDCENTERFLYING:
-        case UNIT_TYPEID::TERRAN_ENGINEERINGBAY:
-        case UNIT_TYPEID::TERRAN_FACTORY:
-        case UNIT_TYPEID::TERRAN_FACTORYFLYING:
-        case UNIT_TYPEID::TERRAN_FACTORYREACTOR:
-        case UNIT_TYPEID::TERRAN_FACTORYTECHLAB:
-        case UNIT_TYPEID::TERRAN_FUSIONCORE:
-        case UNIT_TYPEID::TERRAN_GHOSTACADEMY:
-        case UNIT_TYPEID::TERRAN_MISSILETURRET:
-        case UNIT_TYPEID::TERRAN_ORBITALCOMMAND:
-        case UNIT_TYPEID::TERRAN_ORBITALCOMMANDFLYING:
-        case UNIT_TYPEID::TERRAN_PLANETARYFORTRESS:
-        case UNIT_TYPEID::TERRAN_REFINERY:
-        case UNIT_TYPEID::TERRAN_SENSORTOWER:
-        case UNIT_TYPEID::TERRAN_STARPORT:
-        case UNIT_TYPEID::TERRAN_STARPORTFLYING:
-        case UNIT_TYPEID::TERRAN_STARPORTREACTOR:
-        case UNIT_TYPEID::TERRAN_STARPORTTECHLAB:
-        case UNIT_TYPEID::TERRAN_SUPPLYDEPOT:
-        case UNIT_TYPEID::TERRAN_SUPPLYDEPOTLOWERED:
-        case UNIT_TYPEID::TERRAN_REACTOR:
-        case UNIT_TYPEID::TERRAN_TECHLAB:
-
-        // Zerg
-        case UNIT_TYPEID::ZERG_BANELINGNEST:
-        case UNIT_TYPEID::ZERG_CREEPTUMOR:
-        case UNIT_TYPEID::ZERG_CREEPTUMORBURROWED:
-        case UNIT_TYPEID::ZERG_CREEPTUMORQUEEN:
-        case UNIT_TYPEID::ZERG_EVOLUTIONCHAMBER:
-        case UNIT_TYPEID::ZERG_EXTRACTOR:
-        case UNIT_TYPEID::ZERG_GREATERSPIRE:
-        case UNIT_TYPEID::ZERG_HATCHERY:
-        case UNIT_TYPEID::ZERG_HIVE:
-        case UNIT_TYPEID::ZERG_HYDRALISKDEN:
-        case UNIT_TYPEID::ZERG_INFESTATIONPIT:
-        case UNIT_TYPEID::ZERG_LAIR:
-        case UNIT_TYPEID::ZERG_LURKERDENMP:
-        case UNIT_TYPEID::ZERG_NYDUSCANAL:
-        case UNIT_TYPEID::ZERG_NYDUSNETWORK:
-        case UNIT_TYPEID::ZERG_ROACHWARREN:
-        case UNIT_TYPEID::ZERG_SPAWNINGPOOL:
-        case UNIT_TYPEID::ZERG_SPINECRAWLER:
-        case UNIT_TYPEID::ZERG_SPINECRAWLERUPROOTED:
-        case UNIT_TYPEID::ZERG_SPIRE:
-        case UNIT_TYPEID::ZERG_SPORECRAWLER:
-        case UNIT_TYPEID::ZERG_SPORECRAWLERUPROOTED:
-        case UNIT_TYPEID::ZERG_ULTRALISKCAVERN:
-
-        // Protoss
-        case sc2::UNIT_TYPEID::PROTOSS_ASSIMILATOR:
-        case sc2::UNIT_TYPEID::PROTOSS_CYBERNETICSCORE:
-        case sc2::UNIT_TYPEID::PROTOSS_DARKSHRINE:
-        case sc2::UNIT_TYPEID::PROTOSS_FLEETBEACON:
-        case sc2::UNIT_TYPEID::PROTOSS_FORGE:
-        case sc2::UNIT_TYPEID::PROTOSS_GATEWAY:
-        case sc2::UNIT_TYPEID::PROTOSS_NEXUS:
-        case sc2::UNIT_TYPEID::PROTOSS_PHOTONCANNON:
-        case sc2::UNIT_TYPEID::PROTOSS_PYLON:
-        case sc2::UNIT_TYPEID::PROTOSS_PYLONOVERCHARGED:
-        case sc2::UNIT_TYPEID::PROTOSS_ROBOTICSBAY:
-        case sc2::UNIT_TYPEID::PROTOSS_ROBOTICSFACILITY:
-        case sc2::UNIT_TYPEID::PROTOSS_STARGATE:
-        case sc2::UNIT_TYPEID::PROTOSS_TEMPLARARCHIVE:
-        case sc2::UNIT_TYPEID::PROTOSS_TWILIGHTCOUNCIL:
-        case sc2::UNIT_TYPEID::PROTOSS_WARPGATE:
-        case sc2::UNIT_TYPEID::PROTOSS_SHIELDBATTERY:
-            return true;
-
-        default:
-            return false;
-    }
+    return HasCategory(type_, kBuilding);
 }
 
 bool IsWorker::operator()(const Unit& unit_) const {
@@ -169,9 +245,7 @@ bool IsWorker::operator()(const Unit& unit_) const {
 }
 
 bool IsWorker::operator()(UNIT_TYPEID type_) const {
-    return type_ == sc2::UNIT_TYPEID::TERRAN_SCV ||
-        type_ == sc2::UNIT_TYPEID::ZERG_DRONE ||
-        type_ == sc2::UNIT_TYPEID::PROTOSS_PROBE;
+    return HasCategory(type_, kWorker);
 }
 
 bool IsVisible::operator()(const Unit& unit_) const {
@@ -0,0 +1,106 @@
+#include "sc2utils/worker_pool.h"
+
+#include <algorithm>
+
+namespace sc2
+{
+    WorkerPool::WorkerPool(std::size_t threads)
+    {
+        for (std::size_t i = 1; i < threads; ++i)
+        {
+            threads_.emplace_back(&WorkerPool::WorkerThread, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        work_condition_.notify_all();
+        for (std::thread &thread: threads_)
+        {
+            thread.join();
+        }
+    }
+
+    std::size_t WorkerPool::Threads() const
+    {
+        return threads_.size() + 1;
+    }
+
+    void WorkerPool::ParallelFor(std::size_t count, std::size_t chunk_size, const Task &task)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        chunk_size = std::max<std::size_t>(chunk_size, 1);
+        const std::size_t chunks = (count + chunk_size - 1) / chunk_size;
+        if (threads_.empty() || chunks == 1)
+        {
+            task(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            task_ = &task;
+            count_ = count;
+            chunk_size_ = chunk_size;
+            chunks_ = chunks;
+            next_chunk_ = 0;
+            chunks_done_ = 0;
+            ++generation_;
+        }
+        work_condition_.notify_all();
+
+        RunChunks();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_condition_.wait(lock, [this] { return chunks_done_ == chunks_; });
+        task_ = nullptr;
+    }
+
+    void WorkerPool::RunChunks()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (task_ && next_chunk_ < chunks_)
+        {
+            const std::size_t chunk = next_chunk_++;
+            const Task &task = *task_;
+            const std::size_t begin = chunk * chunk_size_;
+            const std::size_t end = std::min(begin + chunk_size_, count_);
+            lock.unlock();
+
+            task(begin, end);
+
+            lock.lock();
+            if (++chunks_done_ == chunks_)
+            {
+                done_condition_.notify_one();
+            }
+        }
+    }
+
+    void WorkerPool::WorkerThread()
+    {
+        std::size_t seen_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_condition_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+                if (stop_)
+                {
+                    return;
+                }
+                seen_generation = generation_;
+            }
+
+            RunChunks();
+        }
+    }
+}
@@ -0,0 +1,61 @@
+// Measures client throughput against the fake game server, no StarCraft II required. Every step sends Step and
+// Observation requests and converts an observation with the requested number of units.
+//
+// Usage: benchmark_fake_server [units] [steps] [port]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "sc2api/sc2_api.h"
+#include "sc2api/sc2_fake_game_server.h"
+
+namespace {
+
+class CountingBot : public sc2::Agent {
+public:
+    void OnStep() final {
+        units_seen_ += Observation()->GetUnits().size();
+    }
+
+    std::size_t units_seen_ = 0;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    int units = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int steps = argc > 2 ? std::atoi(argv[2]) : 1000;
+    int port = argc > 3 ? std::atoi(argv[3]) : 8170;
+
+    sc2::FakeGameScenario scenario;
+    scenario.self_units = units / 2;
+    scenario.enemy_units = units - units / 2;
+
+    sc2::FakeGameServer server;
+    server.SetScenario(scenario);
+    if (!server.Start(port)) {
+        std::cerr << "Unable to start the fake game server on port " << port << std::endl;
+        return 1;
+    }
+
+    CountingBot bot;
+    sc2::Coordinator coordinator;
+    coordinator.SetParticipants({ sc2::CreateParticipant(sc2::Race::Terran, &bot) });
+    coordinator.Connect(port);
+    if (!coordinator.StartGame()) {
+        std::cerr << "Unable to start a game on the fake game server" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps && coordinator.Update(); ++i) {
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << units << " units, " << steps << " steps in " << seconds << " s: "
+        << steps / seconds << " steps/s, " << bot.units_seen_ / seconds << " units/s" << std::endl;
+    std::cout << bot.Control()->Proto().GetRequestStats().ToJson() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Compares parsing observations into a fresh heap allocated Response (what Connection used to do) with parsing them
+// into a ResponsePool arena, and reports the number of heap allocations each takes per response. The observation
+// carries 500 units, roughly a mid game frame.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "s2clientprotocol/sc2api.pb.h"
+#include "sc2api/sc2_connection.h"
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+const int kIterations = 2000;
+const int kUnits = 500;
+
+std::string MakeObservation() {
+    SC2APIProtocol::Response response;
+    SC2APIProtocol::Observation* observation = response.mutable_observation()->mutable_observation();
+    observation->set_game_loop(22400);
+    SC2APIProtocol::ObservationRaw* raw = observation->mutable_raw_data();
+    for (int i = 0; i < kUnits; ++i) {
+        SC2APIProtocol::Unit* unit = raw->add_units();
+        unit->set_display_type(SC2APIProtocol::Visible);
+        unit->set_alliance(i % 2 == 0 ? SC2APIProtocol::Self : SC2APIProtocol::Enemy);
+        unit->set_tag(0x100000000ULL + i);
+        unit->set_unit_type(48);
+        unit->set_owner(i % 2 == 0 ? 1 : 2);
+        unit->mutable_pos()->set_x(static_cast<float>(i % 128));
+        unit->mutable_pos()->set_y(static_cast<float>(i / 128));
+        unit->mutable_pos()->set_z(8.0f);
+        unit->set_facing(0.5f);
+        unit->set_radius(0.375f);
+        unit->set_build_progress(1.0f);
+        unit->set_health(45.0f);
+        unit->set_health_max(45.0f);
+        if (i % 4 == 0) {
+            SC2APIProtocol::UnitOrder* order = unit->add_orders();
+            order->set_ability_id(16);
+            order->mutable_target_world_space_pos()->set_x(64.0f);
+            order->mutable_target_world_space_pos()->set_y(64.0f);
+        }
+        if (i % 8 == 0) {
+            unit->add_buff_ids(27);
+        }
+    }
+    return response.SerializeAsString();
+}
+
+template <typename Fn>
+void Measure(const char* name, Fn fn) {
+    // One untimed round so the pool reaches its steady state.
+    std::size_t checksum = fn();
+    uint64_t allocations_before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        checksum += fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocated = allocations.load() - allocations_before;
+
+    std::cout << name << ": " << std::chrono::duration<double, std::micro>(elapsed).count() / kIterations
+        << " us/response, " << static_cast<double>(allocated) / kIterations << " allocations/response"
+        << " (checksum " << checksum << ")" << std::endl;
+}
+
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    const std::string observation = MakeObservation();
+    std::cout << "ResponseObservation with " << kUnits << " units, " << observation.size() << " bytes" << std::endl;
+
+    Measure("new Response", [&observation]() {
+        auto* response = new SC2APIProtocol::Response();
+        response->ParseFromString(observation);
+        std::size_t units = response->observation().observation().raw_data().units_size();
+        delete response;
+        return units;
+    });
+
+    auto pool = std::make_shared<sc2::ResponsePool>();
+    Measure("ResponsePool", [&observation, &pool]() {
+        SC2APIProtocol::Response* response = pool->Acquire();
+        response->ParseFromString(observation);
+        // Go through MakeShared as the client does, the control block is one of the allocations.
+        std::shared_ptr<const SC2APIProtocol::Response> shared = pool->MakeShared(response);
+        return static_cast<std::size_t>(shared->observation().observation().raw_data().units_size());
+    });
+
+    sc2::ResponsePool::Stats stats = pool->GetStats();
+    std::cout << "Pool: " << stats.responses << " responses, " << stats.arenas_created << " arenas created, "
+        << stats.blocks_grown << " blocks grown, " << stats.bytes_retained << " bytes retained" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Compares the serialization path Connection::Send used to take (a fresh std::string per request) with the current one
+// (a reused buffer filled with SerializeToArray) on a RequestAction the size of a busy frame.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "s2clientprotocol/sc2api.pb.h"
+
+namespace {
+
+const int kIterations = 20000;
+const int kActions = 200;
+const int kUnitsPerAction = 24;
+
+void FillRequest(SC2APIProtocol::Request& request) {
+    SC2APIProtocol::RequestAction* request_action = request.mutable_action();
+    for (int i = 0; i < kActions; ++i) {
+        SC2APIProtocol::ActionRawUnitCommand* command =
+            request_action->add_actions()->mutable_action_raw()->mutable_unit_command();
+        command->set_ability_id(16 + i % 8);
+        SC2APIProtocol::Point2D* target = command->mutable_target_world_space_pos();
+        target->set_x(static_cast<float>(i % 128));
+        target->set_y(static_cast<float>(i / 128));
+        for (int j = 0; j < kUnitsPerAction; ++j) {
+            command->add_unit_tags(0x100000000ULL * (i + 1) + j);
+        }
+        command->set_queue_command(i % 2 == 0);
+    }
+}
+
+template <typename Fn>
+double Measure(Fn fn, std::size_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        checksum += fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / kIterations;
+}
+
+}
+
+int main() {
+    SC2APIProtocol::Request request;
+    FillRequest(request);
+    std::cout << "RequestAction with " << kActions << " actions, " << request.ByteSizeLong() << " bytes" << std::endl;
+
+    std::size_t checksum = 0;
+
+    double string_ns = Measure([&request]() {
+        std::string output;
+        request.SerializeToString(&output);
+        return output.size();
+    }, checksum);
+
+    std::vector<char> buffer;
+    double buffer_ns = Measure([&request, &buffer]() {
+        const std::size_t size = request.ByteSizeLong();
+        if (buffer.size() < size) {
+            buffer.resize(size);
+        }
+        request.SerializeToArray(buffer.data(), static_cast<int>(size));
+        return size;
+    }, checksum);
+
+    std::cout << "SerializeToString, new string: " << string_ns << " ns/request" << std::endl;
+    std::cout << "SerializeToArray, reused buffer: " << buffer_ns << " ns/request" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Rebuilds the tag to unit index of a 1,000 unit frame the way UnitPool does every step, once with std::unordered_map
+// and once with FlatTagMap, followed by a lookup of every unit.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "sc2utils/flat_tag_map.h"
+
+namespace {
+
+const int kIterations = 10000;
+const int kUnits = 1000;
+
+template <typename Fn>
+double Measure(Fn fn, std::size_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        checksum += fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / kIterations;
+}
+
+}
+
+int main() {
+    // Tags look like the game's: an index in the low bits and a recycle count in the high bits.
+    std::mt19937 random(1);
+    std::vector<uint64_t> tags;
+    for (int i = 0; i < kUnits; ++i) {
+        tags.push_back((uint64_t(random() % 4 + 1) << 18) | uint64_t(i * 3 + 1));
+    }
+    std::vector<int> units(kUnits);
+
+    std::size_t checksum = 0;
+
+    std::unordered_map<uint64_t, int*> unordered;
+    double unordered_ns = Measure([&]() {
+        unordered.clear();
+        for (int i = 0; i < kUnits; ++i) {
+            unordered[tags[i]] = &units[i];
+        }
+        std::size_t found = 0;
+        for (uint64_t tag : tags) {
+            auto it = unordered.find(tag);
+            found += it != unordered.end() && it->second != nullptr;
+        }
+        return found;
+    }, checksum);
+
+    sc2::FlatTagMap<int*> flat;
+    double flat_ns = Measure([&]() {
+        flat.Clear();
+        for (int i = 0; i < kUnits; ++i) {
+            flat.Insert(tags[i], &units[i]);
+        }
+        std::size_t found = 0;
+        for (uint64_t tag : tags) {
+            int* const* unit = flat.Find(tag);
+            found += unit != nullptr && *unit != nullptr;
+        }
+        return found;
+    }, checksum);
+
+    std::cout << kUnits << " units, " << kIterations << " frames" << std::endl;
+    std::cout << "std::unordered_map: " << unordered_ns / 1000.0 << " us/frame" << std::endl;
+    std::cout << "FlatTagMap: " << flat_ns / 1000.0 << " us/frame" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Builders for the maps and structures the terrain, path finding and map analysis tests run on.
+
+#include "sc2api/sc2_map_info.h"
+#include "sc2api/sc2_unit.h"
+
+#include <vector>
+
+namespace sc2
+{
+    // An 8 bit image with every cell set to the value.
+    inline ImageData MakeByteImage(int width, int height, unsigned char value) {
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.bits_per_pixel = 8;
+        image.data.assign(width * height, static_cast<char>(value));
+        return image;
+    }
+
+    // An 8 bit pathing grid where every cell is pathable except the given ones.
+    inline GameInfo MakeGameInfo(int width, int height, const std::vector<Point2DI>& blocked) {
+        GameInfo info;
+        info.width = width;
+        info.height = height;
+        info.pathing_grid = MakeByteImage(width, height, 0);
+        for (const Point2DI& point : blocked) {
+            info.pathing_grid.data[point.x + point.y * width] = static_cast<char>(255);
+        }
+        return info;
+    }
+
+    inline Unit MakeStructure(UNIT_TYPEID type, const Point2D& pos, float radius) {
+        Unit unit;
+        unit.unit_type = type;
+        unit.pos = Point3D(pos.x, pos.y, 0.0f);
+        unit.radius = radius;
+        unit.display_type = Unit::Visible;
+        unit.is_flying = false;
+        return unit;
+    }
+}
@@ -0,0 +1,50 @@
+#include "sc2api/sc2_data.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    static Abilities MakeAbilities() {
+        // 1 and 2 remap to 3, 3 and 4 stay as they are.
+        Abilities abilities(5);
+        abilities[1].remaps_to_ability_id = 3;
+        abilities[2].remaps_to_ability_id = 3;
+        return abilities;
+    }
+
+    TEST(AbilityRemapTable, PassesIdsThroughUntilBuilt) {
+        AbilityRemapTable table;
+        EXPECT_FALSE(table.IsBuilt());
+        EXPECT_EQ(table.Remap(0), AbilityID(0));
+        EXPECT_EQ(table.Remap(1), AbilityID(1));
+        EXPECT_EQ(table.Remap(3674), AbilityID(3674));
+    }
+
+    TEST(AbilityRemapTable, RemapsToTheGeneralizedId) {
+        AbilityRemapTable table;
+        table.Build(MakeAbilities());
+        EXPECT_TRUE(table.IsBuilt());
+        EXPECT_EQ(table.Remap(0), AbilityID(0));
+        EXPECT_EQ(table.Remap(1), AbilityID(3));
+        EXPECT_EQ(table.Remap(2), AbilityID(3));
+        EXPECT_EQ(table.Remap(3), AbilityID(3));
+        EXPECT_EQ(table.Remap(4), AbilityID(4));
+        EXPECT_EQ(table.Remap(5), AbilityID(5));
+
+        table.Clear();
+        EXPECT_EQ(table.Remap(1), AbilityID(1));
+    }
+
+    TEST(AbilityRemapTable, BulkRemapMatchesSingleRemap) {
+        AbilityRemapTable table;
+        table.Build(MakeAbilities());
+        std::vector<uint32_t> ids = {0, 1, 2, 3, 4, 5, 1000, 2, 1};
+        std::vector<uint32_t> expected;
+        for (uint32_t id : ids) {
+            expected.push_back(table.Remap(id));
+        }
+
+        table.Remap(ids.data(), ids.size());
+        EXPECT_EQ(ids, expected);
+    }
+}
@@ -0,0 +1,50 @@
+#include "sc2api/sc2_interfaces.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    TEST(AsyncResult, GetWaitsOnceAndKeepsTheResult) {
+        int waits = 0;
+        int discards = 0;
+        {
+            AsyncResult<int> result([] { return true; }, [&waits] { return ++waits; }, [&discards] { ++discards; });
+            EXPECT_TRUE(result.IsReady());
+            EXPECT_EQ(result.Get(), 1);
+            EXPECT_EQ(result.Get(), 1);
+        }
+        EXPECT_EQ(waits, 1);
+        EXPECT_EQ(discards, 0);
+    }
+
+    TEST(AsyncResult, DroppingDiscardsTheResponse) {
+        int waits = 0;
+        int discards = 0;
+        {
+            AsyncResult<int> result([] { return false; }, [&waits] { return ++waits; }, [&discards] { ++discards; });
+            EXPECT_FALSE(result.IsReady());
+        }
+        EXPECT_EQ(waits, 0);
+        EXPECT_EQ(discards, 1);
+    }
+
+    TEST(AsyncResult, MovingHandsTheResponseOver) {
+        int discards = 0;
+        {
+            AsyncResult<int> first([] { return true; }, [] { return 7; }, [&discards] { ++discards; });
+            AsyncResult<int> second(std::move(first));
+            EXPECT_EQ(discards, 0);
+
+            // Assigning over a pending result gives up the response it was waiting for.
+            AsyncResult<int> third([] { return true; }, [] { return 8; }, [&discards] { ++discards; });
+            third = std::move(second);
+            EXPECT_EQ(discards, 1);
+            EXPECT_EQ(third.Get(), 7);
+        }
+        EXPECT_EQ(discards, 1);
+
+        AsyncResult<int> immediate(3);
+        EXPECT_TRUE(immediate.IsReady());
+        EXPECT_EQ(immediate.Get(), 3);
+    }
+}
@@ -0,0 +1,124 @@
+#include "sc2api/sc2_fake_game_server.h"
+#include "sc2api/sc2_map_info.h"
+#include "sc2api/sc2_proto_interface.h"
+#include "sc2api/sc2_proto_to_pods.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "s2clientprotocol/sc2api.pb.h"
+
+namespace sc2
+{
+    // Answers without starting the server, the response is owned by the returned pointer.
+    static GameResponsePtr Answer(FakeGameServer& server, const SC2APIProtocol::Request& request) {
+        return GameResponsePtr(server.Answer(request));
+    }
+
+    static FakeGameScenario SmallScenario() {
+        FakeGameScenario scenario;
+        scenario.map_width = 32;
+        scenario.map_height = 24;
+        scenario.self_units = 3;
+        scenario.enemy_units = 2;
+        return scenario;
+    }
+
+    TEST(FakeGameServer, ReportsTheStatusOfTheGame) {
+        FakeGameServer server;
+        SC2APIProtocol::Request request;
+
+        request.mutable_create_game();
+        EXPECT_EQ(Answer(server, request)->status(), SC2APIProtocol::Status::init_game);
+        request.mutable_join_game();
+        GameResponsePtr joined = Answer(server, request);
+        EXPECT_EQ(joined->status(), SC2APIProtocol::Status::in_game);
+        EXPECT_EQ(joined->join_game().player_id(), 1u);
+        request.mutable_leave_game();
+        EXPECT_EQ(Answer(server, request)->status(), SC2APIProtocol::Status::launched);
+        EXPECT_EQ(server.GetRequestsServed(), 3u);
+    }
+
+    TEST(FakeGameServer, GameInfoIsAnOpenMap) {
+        FakeGameServer server;
+        server.SetScenario(SmallScenario());
+        SC2APIProtocol::Request request;
+        request.mutable_game_info();
+        GameResponsePtr response = Answer(server, request);
+        ASSERT_TRUE(response->has_game_info());
+        EXPECT_EQ(response->error_size(), 0);
+
+        ResponseGameInfoPtr game_info_ptr;
+        SET_MESSAGE_RESPONSE(game_info_ptr, response, game_info);
+        GameInfo game_info;
+        ASSERT_TRUE(Convert(game_info_ptr, game_info));
+        EXPECT_EQ(game_info.width, 32);
+        EXPECT_EQ(game_info.height, 24);
+
+        TerrainGrids grids(game_info);
+        EXPECT_TRUE(grids.IsPathable(Rect2DI(Point2DI(0, 0), Point2DI(32, 24))));
+        EXPECT_TRUE(grids.IsPlacable(Rect2DI(Point2DI(0, 0), Point2DI(32, 24))));
+    }
+
+    TEST(FakeGameServer, DataListsAbilitiesByIndex) {
+        FakeGameServer server;
+        SC2APIProtocol::Request request;
+        request.mutable_data()->set_ability_id(true);
+        GameResponsePtr response = Answer(server, request);
+        ASSERT_TRUE(response->has_data());
+
+        const SC2APIProtocol::ResponseData& data = response->data();
+        ASSERT_GT(data.abilities_size(), 23);
+        for (int i = 0; i < data.abilities_size(); ++i) {
+            EXPECT_EQ(data.abilities(i).ability_id(), static_cast<uint32_t>(i));
+        }
+        EXPECT_TRUE(data.abilities(16).available());
+        EXPECT_FALSE(data.abilities(2).available());
+
+        // Only what was asked for.
+        request.mutable_data()->set_ability_id(false);
+        request.mutable_data()->set_unit_type_id(true);
+        EXPECT_EQ(Answer(server, request)->data().abilities_size(), 0);
+    }
+
+    TEST(FakeGameServer, StepsMoveTheUnits) {
+        FakeGameServer server;
+        server.SetScenario(SmallScenario());
+        SC2APIProtocol::Request observation_request;
+        observation_request.mutable_observation();
+
+        GameResponsePtr first = Answer(server, observation_request);
+        ASSERT_TRUE(first->has_observation());
+        const SC2APIProtocol::Observation& observation = first->observation().observation();
+        EXPECT_EQ(observation.game_loop(), 0u);
+        ASSERT_EQ(observation.raw_data().units_size(), 5);
+        EXPECT_EQ(observation.raw_data().units(0).alliance(), SC2APIProtocol::Self);
+        EXPECT_EQ(observation.raw_data().units(4).alliance(), SC2APIProtocol::Enemy);
+        EXPECT_EQ(observation.player_common().player_id(), 1u);
+
+        SC2APIProtocol::Request step_request;
+        step_request.mutable_step()->set_count(4);
+        GameResponsePtr step = Answer(server, step_request);
+        ASSERT_TRUE(step->has_step());
+        EXPECT_EQ(step->step().simulation_loop(), 4u);
+
+        GameResponsePtr second = Answer(server, observation_request);
+        const SC2APIProtocol::Observation& next = second->observation().observation();
+        EXPECT_EQ(next.game_loop(), 4u);
+        ASSERT_EQ(next.raw_data().units_size(), 5);
+        for (int i = 0; i < 5; ++i) {
+            const SC2APIProtocol::Unit& before = observation.raw_data().units(i);
+            const SC2APIProtocol::Unit& after = next.raw_data().units(i);
+            EXPECT_EQ(before.tag(), after.tag());
+            EXPECT_TRUE(before.pos().x() != after.pos().x() || before.pos().y() != after.pos().y());
+        }
+    }
+
+    TEST(FakeGameServer, RejectsUnsupportedRequests) {
+        FakeGameServer server;
+        SC2APIProtocol::Request request;
+        request.mutable_save_replay();
+        EXPECT_GT(Answer(server, request)->error_size(), 0);
+    }
+}
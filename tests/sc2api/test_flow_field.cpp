@@ -0,0 +1,199 @@
+#include "sc2api/sc2_flow_field.h"
+#include "sc2api/sc2_map_info.h"
+#include "map_test_utils.h"
+
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    // Dijkstra with the moves the field uses, for comparison.
+    static std::vector<float> ReferenceDistances(const FlowFieldCache& cache, int width, int height,
+                                                 const std::vector<Point2DI>& sources) {
+        std::vector<float> distance(width * height, DistanceField::Unreachable);
+        using Node = std::pair<float, int>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> open;
+        for (const Point2DI& source : sources) {
+            if (cache.IsWalkable(source)) {
+                distance[source.x + source.y * width] = 0.0f;
+                open.push(Node(0.0f, source.x + source.y * width));
+            }
+        }
+        while (!open.empty()) {
+            Node node = open.top();
+            open.pop();
+            if (node.first > distance[node.second]) {
+                continue;
+            }
+            int x = node.second % width;
+            int y = node.second / width;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if (!cache.IsWalkable(Point2DI(x + dx, y + dy))) {
+                        continue;
+                    }
+                    if (dx != 0 && dy != 0 &&
+                        (!cache.IsWalkable(Point2DI(x + dx, y)) || !cache.IsWalkable(Point2DI(x, y + dy)))) {
+                        continue;
+                    }
+                    float cost = node.first + (dx != 0 && dy != 0 ? 1.41421356f : 1.0f);
+                    int neighbour = x + dx + (y + dy) * width;
+                    if (cost < distance[neighbour]) {
+                        distance[neighbour] = cost;
+                        open.push(Node(cost, neighbour));
+                    }
+                }
+            }
+        }
+        return distance;
+    }
+
+    static void ExpectMatchesReference(const FlowFieldCache& cache, const DistanceField& field,
+                                       const std::vector<Point2DI>& sources) {
+        std::vector<float> expected = ReferenceDistances(cache, field.Width(), field.Height(), sources);
+        for (int y = 0; y < field.Height(); ++y) {
+            for (int x = 0; x < field.Width(); ++x) {
+                float reference = expected[x + y * field.Width()];
+                if (reference == DistanceField::Unreachable) {
+                    EXPECT_EQ(field.Distance(Point2DI(x, y)), DistanceField::Unreachable) << x << ", " << y;
+                }
+                else {
+                    EXPECT_NEAR(field.Distance(Point2DI(x, y)), reference, 1e-3f) << x << ", " << y;
+                }
+            }
+        }
+    }
+
+    static std::vector<Point2DI> RandomWalls(int width, int height, int count, unsigned seed) {
+        std::mt19937 random(seed);
+        std::vector<Point2DI> blocked;
+        for (int i = 0; i < count; ++i) {
+            int x = random() % width;
+            int y = random() % height;
+            int length = 1 + random() % 12;
+            bool horizontal = random() % 2 == 0;
+            for (int j = 0; j < length; ++j) {
+                blocked.push_back(horizontal ? Point2DI(std::min(x + j, width - 1), y) :
+                                               Point2DI(x, std::min(y + j, height - 1)));
+            }
+        }
+        return blocked;
+    }
+
+    TEST(FlowField, OpenGridDistances) {
+        FlowFieldCache cache;
+        cache.SetTerrain(TerrainGrids(MakeGameInfo(30, 20, {})));
+        const DistanceField& field = cache.Get({Point2DI(5, 5)});
+
+        EXPECT_EQ(field.Distance(Point2DI(5, 5)), 0.0f);
+        EXPECT_FLOAT_EQ(field.Distance(Point2DI(15, 5)), 10.0f);
+        EXPECT_NEAR(field.Distance(Point2DI(8, 8)), 3.0f * 1.41421356f, 1e-4f);
+        EXPECT_NEAR(field.Distance(Point2D(25.3f, 0.9f)), 15.0f + 5.0f * 1.41421356f, 1e-4f);
+        EXPECT_EQ(field.Distance(Point2DI(30, 5)), DistanceField::Unreachable);
+        EXPECT_EQ(field.Distance(Point2DI(-1, 5)), DistanceField::Unreachable);
+    }
+
+    TEST(FlowField, MatchesDijkstraWithManySources) {
+        for (unsigned seed = 1; seed <= 4; ++seed) {
+            FlowFieldCache cache;
+            cache.SetTerrain(TerrainGrids(MakeGameInfo(61, 47, RandomWalls(61, 47, 90, seed))));
+            std::vector<Point2DI> sources = {Point2DI(3, 4), Point2DI(58, 40), Point2DI(30, 20), Point2DI(1, 45)};
+            ExpectMatchesReference(cache, cache.Get(sources), sources);
+        }
+    }
+
+    TEST(FlowField, NextCellsLeadToTheSources) {
+        FlowFieldCache cache;
+        cache.SetTerrain(TerrainGrids(MakeGameInfo(40, 40, RandomWalls(40, 40, 40, 7))));
+        std::vector<Point2DI> sources = {Point2DI(0, 0), Point2DI(39, 39)};
+        const DistanceField& field = cache.Get(sources);
+
+        for (int y = 0; y < 40; y += 3) {
+            for (int x = 0; x < 40; x += 3) {
+                Point2DI cell(x, y);
+                if (field.Distance(cell) == DistanceField::Unreachable) {
+                    EXPECT_FALSE(field.NextCell(cell, nullptr));
+                    continue;
+                }
+                int steps = 0;
+                Point2DI next;
+                while (field.NextCell(cell, &next)) {
+                    EXPECT_LT(field.Distance(next), field.Distance(cell));
+                    EXPECT_LE(std::abs(next.x - cell.x), 1);
+                    EXPECT_LE(std::abs(next.y - cell.y), 1);
+                    cell = next;
+                    ASSERT_LT(++steps, 200);
+                }
+                EXPECT_EQ(field.Distance(cell), 0.0f);
+            }
+        }
+
+        Point2D direction = field.Direction(Point2D(5.5f, 0.5f));
+        EXPECT_FLOAT_EQ(direction.x, -1.0f);
+        EXPECT_FLOAT_EQ(direction.y, 0.0f);
+        direction = field.Direction(Point2D(0.5f, 0.5f));
+        EXPECT_EQ(direction.x, 0.0f);
+        EXPECT_EQ(direction.y, 0.0f);
+    }
+
+    TEST(FlowField, CachesBySourceSet) {
+        FlowFieldCache cache(2);
+        cache.SetTerrain(TerrainGrids(MakeGameInfo(20, 20, {})));
+
+        const DistanceField* first = &cache.Get({Point2DI(1, 1), Point2DI(10, 10)});
+        EXPECT_EQ(&cache.Get({Point2DI(10, 10), Point2DI(1, 1), Point2DI(10, 10)}), first);
+        EXPECT_EQ(first->Sources().size(), 2u);
+        EXPECT_EQ(cache.Size(), 1u);
+
+        cache.Get({Point2DI(2, 2)});
+        EXPECT_EQ(&cache.Get({Point2DI(1, 1), Point2DI(10, 10)}), first);
+        EXPECT_EQ(cache.Size(), 2u);
+
+        // The field of (2, 2) is the least recently used one and makes room.
+        const DistanceField& third = cache.Get({Point2DI(3, 3)});
+        EXPECT_EQ(cache.Size(), 2u);
+        EXPECT_EQ(third.Distance(Point2DI(3, 3)), 0.0f);
+        EXPECT_EQ(&cache.Get({Point2DI(1, 1), Point2DI(10, 10)}), first);
+        EXPECT_EQ(first->Distance(Point2DI(10, 10)), 0.0f);
+
+        cache.Clear();
+        EXPECT_EQ(cache.Size(), 0u);
+    }
+
+    TEST(FlowField, StructuresAreRepairedIncrementally) {
+        const int width = 50;
+        const int height = 40;
+        FlowFieldCache cache;
+        cache.SetTerrain(TerrainGrids(MakeGameInfo(width, height, RandomWalls(width, height, 30, 3))));
+        std::vector<Point2DI> sources = {Point2DI(4, 4), Point2DI(45, 30)};
+        cache.Get(sources);
+
+        Unit command_center = MakeStructure(UNIT_TYPEID::TERRAN_COMMANDCENTER, Point2D(20.5f, 20.5f), 2.75f);
+        Unit barracks = MakeStructure(UNIT_TYPEID::TERRAN_BARRACKS, Point2D(6.5f, 6.5f), 1.8125f);
+        Unit depot = MakeStructure(UNIT_TYPEID::TERRAN_SUPPLYDEPOT, Point2D(4.0f, 4.0f), 1.375f);
+
+        cache.AddObstacle(command_center);
+        EXPECT_FALSE(cache.IsWalkable(Point2DI(20, 20)));
+        ExpectMatchesReference(cache, cache.Get(sources), sources);
+
+        cache.SetObstacles({&command_center, &barracks, &depot});
+        EXPECT_FALSE(cache.IsWalkable(Point2DI(4, 4)));
+        const DistanceField& blocked = cache.Get(sources);
+        EXPECT_EQ(blocked.Distance(Point2DI(4, 4)), DistanceField::Unreachable);
+        ExpectMatchesReference(cache, blocked, sources);
+
+        cache.RemoveObstacle(depot);
+        cache.RemoveObstacle(command_center);
+        EXPECT_TRUE(cache.IsWalkable(Point2DI(20, 20)));
+        const DistanceField& freed = cache.Get(sources);
+        EXPECT_EQ(freed.Distance(Point2DI(4, 4)), 0.0f);
+        ExpectMatchesReference(cache, freed, sources);
+
+        cache.SetObstacles({});
+        ExpectMatchesReference(cache, cache.Get(sources), sources);
+    }
+}
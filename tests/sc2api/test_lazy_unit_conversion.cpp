@@ -0,0 +1,57 @@
+#include "sc2api/sc2_api.h"
+#include "sc2api/sc2_fake_game_server.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    static const int kLazyConversionPort = 8171;
+
+    // Looks at its units and commands all of them in one step, then counts the idle events that come with the next
+    // step. Units never have orders in the fake game, so every one of them is idle when it is commanded.
+    class CommandingBot : public Agent {
+    public:
+        void OnStep() final {
+            ++steps_;
+            if (steps_ == kCommandStep) {
+                Units units = Observation()->GetUnits(Unit::Alliance::Self);
+                Actions()->UnitCommand(units, ABILITY_ID::MOVE_MOVE, Point2D(8.0f, 8.0f));
+                commanded_ = units.size();
+            }
+        }
+
+        void OnUnitIdle(const Unit*) final {
+            if (steps_ == kCommandStep) {
+                ++idled_after_command_;
+            }
+        }
+
+        static const int kCommandStep = 3;
+        int steps_ = 0;
+        size_t commanded_ = 0;
+        int idled_after_command_ = 0;
+    };
+
+    TEST(LazyUnitConversion, CommandedUnitsAreNotIdledByAnEarlierConversion) {
+        FakeGameScenario scenario;
+        scenario.self_units = 4;
+        scenario.enemy_units = 4;
+        FakeGameServer server;
+        server.SetScenario(scenario);
+        ASSERT_TRUE(server.Start(kLazyConversionPort));
+
+        CommandingBot bot;
+        Coordinator coordinator;
+        coordinator.SetLazyUnitConversion(true);
+        coordinator.SetParticipants({ CreateParticipant(Race::Terran, &bot) });
+        coordinator.Connect(kLazyConversionPort);
+        ASSERT_TRUE(coordinator.StartGame());
+
+        // Nothing asks for the units in the step after the commands, its unit events come from the conversion GetUnits
+        // did before the units were commanded.
+        while (bot.steps_ <= CommandingBot::kCommandStep && coordinator.Update()) {
+        }
+        EXPECT_EQ(bot.commanded_, 4u);
+        EXPECT_EQ(bot.idled_after_command_, 0);
+    }
+}
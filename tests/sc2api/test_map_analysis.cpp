@@ -0,0 +1,172 @@
+#include "sc2api/sc2_map_info.h"
+#include "map_test_utils.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    static void SetCell(ImageData& image, int x, int y, unsigned char value) {
+        image.data[x + y * image.width] = static_cast<char>(value);
+    }
+
+    // A high plateau on the left and low ground on the right, joined by a ramp four cells wide. The middle is a cliff
+    // except for the ramp. The plateau has a patch nobody can build on, which is not a ramp because it is flat.
+    static GameInfo MakeTwoLevelMap() {
+        const int width = 40;
+        const int height = 20;
+        GameInfo info;
+        info.width = width;
+        info.height = height;
+        info.pathing_grid = MakeByteImage(width, height, 0);
+        info.placement_grid = MakeByteImage(width, height, 255);
+        info.terrain_height = MakeByteImage(width, height, 127);
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (x < 15)
+                    SetCell(info.terrain_height, x, y, 143);
+                if (x >= 15 && x < 25) {
+                    bool ramp = y >= 8 && y < 12;
+                    SetCell(info.pathing_grid, x, y, ramp ? 0 : 255);
+                    SetCell(info.placement_grid, x, y, 0);
+                    SetCell(info.terrain_height, x, y, static_cast<unsigned char>(143 - (x - 15) * 16 / 10));
+                }
+            }
+        }
+        for (int y = 2; y < 5; ++y) {
+            for (int x = 2; x < 5; ++x)
+                SetCell(info.placement_grid, x, y, 0);
+        }
+        return info;
+    }
+
+    TEST(MapAnalysis, FindsRegionsRampsAndChokes) {
+        MapAnalysis analysis(MakeTwoLevelMap());
+
+        ASSERT_EQ(analysis.Regions().size(), 3u);
+        int high = analysis.GetRegionIndex(Point2DI(5, 10));
+        int ramp = analysis.GetRegionIndex(Point2DI(20, 9));
+        int low = analysis.GetRegionIndex(Point2DI(30, 10));
+        ASSERT_GE(high, 0);
+        ASSERT_GE(ramp, 0);
+        ASSERT_GE(low, 0);
+        EXPECT_NE(high, low);
+
+        const MapRegion& ramp_region = analysis.Regions()[ramp];
+        EXPECT_TRUE(ramp_region.is_ramp);
+        EXPECT_EQ(ramp_region.cell_count, 40);
+        EXPECT_EQ(ramp_region.bounds.from, Point2DI(15, 8));
+        EXPECT_EQ(ramp_region.bounds.to, Point2DI(25, 12));
+        EXPECT_FLOAT_EQ(ramp_region.center.x, 20.0f);
+        EXPECT_FLOAT_EQ(ramp_region.center.y, 10.0f);
+
+        const MapRegion& high_region = analysis.Regions()[high];
+        EXPECT_FALSE(high_region.is_ramp);
+        EXPECT_EQ(high_region.cell_count, 15 * 20);
+        EXPECT_FLOAT_EQ(high_region.height, 2.0f);
+        EXPECT_EQ(analysis.GetRegionIndex(Point2DI(3, 3)), high);
+        EXPECT_FLOAT_EQ(analysis.Regions()[low].height, 0.0f);
+
+        EXPECT_EQ(analysis.GetRegionIndex(Point2DI(20, 3)), -1);
+        EXPECT_EQ(analysis.GetRegion(Point2DI(40, 3)), nullptr);
+        EXPECT_EQ(analysis.GetRegion(Point2DI(30, 10)), &analysis.Regions()[low]);
+
+        ASSERT_EQ(analysis.Chokes().size(), 2u);
+        for (const MapChoke& choke : analysis.Chokes()) {
+            EXPECT_EQ(choke.ramp, ramp);
+            EXPECT_FLOAT_EQ(choke.width, 4.0f);
+            EXPECT_FLOAT_EQ(choke.center.y, 10.0f);
+            EXPECT_FLOAT_EQ(choke.center.x, choke.region == high ? 15.5f : 24.5f);
+        }
+
+        EXPECT_EQ(analysis.GetNeighbours(high), std::vector<int>({ramp}));
+        EXPECT_EQ(analysis.GetNeighbours(low), std::vector<int>({ramp}));
+        EXPECT_EQ(analysis.GetNeighbours(ramp).size(), 2u);
+        EXPECT_TRUE(analysis.GetNeighbours(7).empty());
+    }
+
+    TEST(MapAnalysis, SavesAndLoads) {
+        GameInfo info = MakeTwoLevelMap();
+        MapAnalysis analysis(info);
+        std::string file_path = testing::TempDir() + "map_analysis_test.analysis";
+        ASSERT_TRUE(analysis.Save(file_path));
+
+        MapAnalysis loaded;
+        ASSERT_TRUE(loaded.Load(file_path, MapAnalysis::Hash(info)));
+        EXPECT_EQ(loaded.Key(), analysis.Key());
+        ASSERT_EQ(loaded.Regions().size(), analysis.Regions().size());
+        ASSERT_EQ(loaded.Chokes().size(), analysis.Chokes().size());
+        for (size_t i = 0; i < analysis.Regions().size(); ++i) {
+            EXPECT_EQ(loaded.Regions()[i].is_ramp, analysis.Regions()[i].is_ramp);
+            EXPECT_EQ(loaded.Regions()[i].cell_count, analysis.Regions()[i].cell_count);
+            EXPECT_EQ(loaded.Regions()[i].chokes, analysis.Regions()[i].chokes);
+        }
+        for (int y = 0; y < 20; ++y) {
+            for (int x = 0; x < 40; ++x)
+                EXPECT_EQ(loaded.GetRegionIndex(Point2DI(x, y)), analysis.GetRegionIndex(Point2DI(x, y)));
+        }
+        EXPECT_FLOAT_EQ(loaded.Chokes()[0].width, analysis.Chokes()[0].width);
+
+        // Another map, or a damaged file, leaves the analysis empty.
+        GameInfo other = info;
+        SetCell(other.pathing_grid, 0, 0, 255);
+        EXPECT_FALSE(loaded.Load(file_path, MapAnalysis::Hash(other)));
+        EXPECT_TRUE(loaded.Regions().empty());
+        EXPECT_EQ(loaded.GetRegionIndex(Point2DI(5, 10)), -1);
+
+        std::ofstream(file_path, std::ios::binary | std::ios::trunc) << "SC2MAPAN";
+        EXPECT_FALSE(loaded.Load(file_path, MapAnalysis::Hash(info)));
+        std::remove(file_path.c_str());
+    }
+
+    static std::filesystem::path CacheFileName(const GameInfo& info) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.analysis", static_cast<unsigned long long>(MapAnalysis::Hash(info)));
+        return name;
+    }
+
+    TEST(MapAnalysis, CachesPerMap) {
+        GameInfo info = MakeTwoLevelMap();
+        std::string directory = testing::TempDir();
+        std::filesystem::path file_path = std::filesystem::path(directory) / CacheFileName(info);
+        std::filesystem::remove(file_path);
+
+        MapAnalysis first;
+        EXPECT_FALSE(first.AnalyzeCached(info, directory));
+        EXPECT_TRUE(std::filesystem::exists(file_path));
+        MapAnalysis second;
+        EXPECT_TRUE(second.AnalyzeCached(info, directory));
+        EXPECT_EQ(second.Regions().size(), 3u);
+        EXPECT_EQ(second.Chokes().size(), 2u);
+        std::filesystem::remove(file_path);
+    }
+
+    TEST(MapAnalysis, AnEmptyCacheDirectoryTurnsTheCacheOff) {
+        GameInfo info = MakeTwoLevelMap();
+        std::filesystem::remove(CacheFileName(info));
+
+        MapAnalysis analysis;
+        EXPECT_FALSE(analysis.AnalyzeCached(info, ""));
+        EXPECT_EQ(analysis.Regions().size(), 3u);
+        EXPECT_FALSE(analysis.AnalyzeCached(info, ""));
+        EXPECT_FALSE(std::filesystem::exists(CacheFileName(info)));
+    }
+
+    TEST(MapAnalysis, HashCoversEveryGrid) {
+        GameInfo info = MakeTwoLevelMap();
+        uint64_t hash = MapAnalysis::Hash(info);
+        EXPECT_EQ(MapAnalysis::Hash(MakeTwoLevelMap()), hash);
+
+        GameInfo placement = info;
+        SetCell(placement.placement_grid, 1, 1, 0);
+        EXPECT_NE(MapAnalysis::Hash(placement), hash);
+
+        GameInfo height = info;
+        SetCell(height.terrain_height, 1, 1, 0);
+        EXPECT_NE(MapAnalysis::Hash(height), hash);
+    }
+}
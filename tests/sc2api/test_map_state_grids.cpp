@@ -0,0 +1,95 @@
+#include "sc2api/sc2_interfaces.h"
+#include "sc2api/sc2_map_info.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    // A map state with a width x height visibility layer filled with the given value and no creep.
+    static SC2APIProtocol::MapState MakeMapState(int width, int height, Visibility visibility) {
+        SC2APIProtocol::MapState map_state;
+        SC2APIProtocol::ImageData* image = map_state.mutable_visibility();
+        image->set_bits_per_pixel(8);
+        image->mutable_size()->set_x(width);
+        image->mutable_size()->set_y(height);
+        image->set_data(std::string(width * height, static_cast<char>(visibility)));
+
+        SC2APIProtocol::ImageData* creep = map_state.mutable_creep();
+        creep->set_bits_per_pixel(1);
+        creep->mutable_size()->set_x(width);
+        creep->mutable_size()->set_y(height);
+        creep->set_data(std::string((width * height + 7) / 8, '\0'));
+        return map_state;
+    }
+
+    static void SetVisibility(SC2APIProtocol::MapState& map_state, const Point2DI& cell, Visibility visibility) {
+        std::string& data = *map_state.mutable_visibility()->mutable_data();
+        data[cell.x + cell.y * map_state.visibility().size().x()] = static_cast<char>(visibility);
+    }
+
+    TEST(MapStateGrids, PointLookups) {
+        SC2APIProtocol::MapState map_state = MakeMapState(20, 10, Visibility::Fogged);
+        SetVisibility(map_state, {3, 4}, Visibility::Visible);
+        map_state.mutable_creep()->mutable_data()->at(0) = static_cast<char>(0x80);
+
+        MapStateGrids grids;
+        grids.Update(map_state);
+        EXPECT_EQ(grids.GetVisibility({3, 4}), Visibility::Visible);
+        EXPECT_EQ(grids.GetVisibility({4, 4}), Visibility::Fogged);
+        EXPECT_EQ(grids.GetVisibility({20, 4}), Visibility::FullHidden);
+        EXPECT_TRUE(grids.HasCreep({0, 0}));
+        EXPECT_FALSE(grids.HasCreep({1, 0}));
+        EXPECT_EQ(grids.CountCreep(grids.Creep().Area()), 1);
+    }
+
+    TEST(MapStateGrids, CountsVisibilityInRectangles) {
+        SC2APIProtocol::MapState map_state = MakeMapState(40, 20, Visibility::Hidden);
+        for (int x = 5; x < 35; ++x) {
+            SetVisibility(map_state, {x, 7}, Visibility::Visible);
+        }
+
+        MapStateGrids grids;
+        grids.Update(map_state);
+        EXPECT_EQ(grids.CountVisibility(Rect2DI({0, 0}, {40, 20}), Visibility::Visible), 30);
+        EXPECT_EQ(grids.CountVisibility(Rect2DI({10, 7}, {31, 8}), Visibility::Visible), 21);
+        EXPECT_EQ(grids.CountVisibility(Rect2DI({0, 0}, {40, 20}), Visibility::Hidden), 40 * 20 - 30);
+        EXPECT_EQ(grids.CountVisibility(Rect2DI({-10, -10}, {2, 2}), Visibility::Hidden), 4);
+    }
+
+    TEST(MapStateGrids, FindsTheFirstFoggedCellAlongASegment) {
+        SC2APIProtocol::MapState map_state = MakeMapState(30, 30, Visibility::Visible);
+        SetVisibility(map_state, {20, 10}, Visibility::Fogged);
+        SetVisibility(map_state, {25, 10}, Visibility::Hidden);
+
+        MapStateGrids grids;
+        grids.Update(map_state);
+        Point2DI cell;
+        EXPECT_TRUE(grids.FindFirstFogged(Point2D(2.5f, 10.5f), Point2D(28.5f, 10.5f), &cell));
+        EXPECT_EQ(cell, Point2DI(20, 10));
+        EXPECT_TRUE(grids.FindFirstFogged(Point2D(28.5f, 10.5f), Point2D(2.5f, 10.5f), &cell));
+        EXPECT_EQ(cell, Point2DI(25, 10));
+        EXPECT_FALSE(grids.FindFirstFogged(Point2D(2.5f, 2.5f), Point2D(27.5f, 20.5f)));
+        EXPECT_TRUE(grids.FindFirstFogged(Point2D(25.5f, 25.5f), Point2D(35.5f, 27.5f), &cell));
+        EXPECT_EQ(cell, Point2DI(30, 26));
+    }
+
+    TEST(MapStateGrids, ListsNewlyRevealedCells) {
+        SC2APIProtocol::MapState map_state = MakeMapState(37, 3, Visibility::Fogged);
+        SetVisibility(map_state, {1, 1}, Visibility::Visible);
+
+        MapStateGrids grids;
+        grids.Update(map_state);
+        EXPECT_EQ(grids.CountRevealed(), 1);
+
+        SetVisibility(map_state, {20, 2}, Visibility::Visible);
+        SetVisibility(map_state, {36, 0}, Visibility::Visible);
+        grids.Update(map_state);
+        std::vector<Point2DI> revealed;
+        grids.GetRevealedCells(revealed);
+        EXPECT_EQ(grids.CountRevealed(), 2);
+        EXPECT_EQ(revealed, std::vector<Point2DI>({{36, 0}, {20, 2}}));
+
+        grids.Update(map_state);
+        EXPECT_EQ(grids.CountRevealed(), 0);
+    }
+}
@@ -0,0 +1,122 @@
+#include "sc2api/sc2_path_finder.h"
+#include "sc2api/sc2_map_info.h"
+#include "map_test_utils.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    TEST(PathFinder, StraightAndDiagonalPaths) {
+        PathFinder path_finder(TerrainGrids(MakeGameInfo(20, 20, {})));
+
+        Path path;
+        ASSERT_TRUE(path_finder.FindPath(Point2D(2.5f, 2.5f), Point2D(12.5f, 2.5f), &path));
+        ASSERT_EQ(path.waypoints.size(), 1u);
+        EXPECT_FLOAT_EQ(path.distance, 10.0f);
+
+        ASSERT_TRUE(path_finder.FindPath(Point2D(2.5f, 2.5f), Point2D(7.5f, 7.5f), &path));
+        EXPECT_EQ(path.waypoints.size(), 1u);
+        EXPECT_NEAR(path.distance, 5.0f * 1.41421356f, 1e-4f);
+
+        // Straightened into a single segment instead of diagonal and straight moves.
+        ASSERT_TRUE(path_finder.FindPath(Point2D(2.5f, 2.5f), Point2D(12.5f, 7.5f), &path));
+        EXPECT_EQ(path.waypoints.size(), 1u);
+        EXPECT_NEAR(path.distance, std::sqrt(125.0f), 1e-4f);
+        EXPECT_NEAR(path_finder.Distance(Point2D(2.5f, 2.5f), Point2D(12.5f, 7.5f)), path.distance, 1e-6f);
+    }
+
+    TEST(PathFinder, GoesAroundWalls) {
+        // A wall along x = 10 from y = 0 to y = 15, the gap is above it.
+        std::vector<Point2DI> wall;
+        for (int y = 0; y < 16; ++y) {
+            wall.push_back(Point2DI(10, y));
+        }
+        PathFinder path_finder(TerrainGrids(MakeGameInfo(20, 20, wall)));
+
+        Path path;
+        ASSERT_TRUE(path_finder.FindPath(Point2D(5.5f, 5.5f), Point2D(15.5f, 5.5f), &path));
+        EXPECT_GT(path.distance, 20.0f);
+        for (const Point2D& waypoint : path.waypoints) {
+            EXPECT_TRUE(path_finder.IsWalkable(Point2DI(static_cast<int>(waypoint.x), static_cast<int>(waypoint.y))));
+        }
+        // The path may not squeeze past the corner at (10, 15).
+        ASSERT_EQ(path.waypoints.size(), 3u);
+        EXPECT_EQ(path.waypoints[0].x, 9.5f);
+        EXPECT_EQ(path.waypoints[0].y, 16.5f);
+        EXPECT_EQ(path.waypoints[1].x, 11.5f);
+        EXPECT_EQ(path.waypoints[1].y, 16.5f);
+    }
+
+    TEST(PathFinder, UnreachableGoals) {
+        // The top right corner is walled off.
+        PathFinder path_finder(TerrainGrids(MakeGameInfo(10, 10, {{7, 9}, {7, 8}, {7, 7}, {8, 7}, {9, 7}})));
+
+        EXPECT_FALSE(path_finder.FindPath(Point2D(1.5f, 1.5f), Point2D(8.5f, 8.5f)));
+        EXPECT_EQ(path_finder.Distance(Point2D(1.5f, 1.5f), Point2D(8.5f, 8.5f)), 0.0f);
+        EXPECT_EQ(path_finder.Distance(Point2D(1.5f, 1.5f), Point2D(7.5f, 7.5f)), 0.0f);
+        EXPECT_EQ(path_finder.Distance(Point2D(1.5f, 1.5f), Point2D(12.5f, 1.5f)), 0.0f);
+        EXPECT_EQ(path_finder.Distance(Point2D(-1.5f, 1.5f), Point2D(1.5f, 1.5f)), 0.0f);
+
+        // Diagonal moves can't slip between two blocked cells either.
+        PathFinder diagonal(TerrainGrids(MakeGameInfo(3, 3, {{1, 0}, {0, 1}, {2, 1}, {1, 2}})));
+        EXPECT_FALSE(diagonal.FindPath(Point2D(0.5f, 0.5f), Point2D(2.5f, 2.5f)));
+    }
+
+    TEST(PathFinder, StructuresAreObstacles) {
+        PathFinder path_finder(TerrainGrids(MakeGameInfo(20, 20, {})));
+        Unit command_center = MakeStructure(UNIT_TYPEID::TERRAN_COMMANDCENTER, Point2D(10.5f, 10.5f), 2.75f);
+        Unit depot = MakeStructure(UNIT_TYPEID::TERRAN_SUPPLYDEPOTLOWERED, Point2D(3.0f, 3.0f), 1.375f);
+        Unit flying = MakeStructure(UNIT_TYPEID::TERRAN_BARRACKSFLYING, Point2D(15.5f, 15.5f), 1.8125f);
+        flying.is_flying = true;
+        Unit marine = MakeStructure(UNIT_TYPEID::TERRAN_MARINE, Point2D(5.5f, 15.5f), 0.375f);
+
+        path_finder.SetObstacles({&command_center, &depot, &flying, &marine});
+        for (int y = 8; y < 13; ++y) {
+            for (int x = 8; x < 13; ++x) {
+                EXPECT_FALSE(path_finder.IsWalkable(Point2DI(x, y)));
+            }
+        }
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(7, 10)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(13, 10)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(10, 7)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(10, 13)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(2, 2)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(15, 15)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(5, 15)));
+
+        // A unit standing next to the structure walks around it, and may start inside its footprint.
+        float around = path_finder.Distance(Point2D(6.5f, 10.5f), Point2D(14.5f, 10.5f));
+        EXPECT_GT(around, 8.0f);
+        EXPECT_GT(path_finder.Distance(Point2D(8.5f, 10.5f), Point2D(14.5f, 10.5f)), 0.0f);
+        EXPECT_EQ(path_finder.Distance(Point2D(6.5f, 10.5f), Point2D(10.5f, 10.5f)), 0.0f);
+
+        // Obstacles from the previous call are lifted.
+        depot.unit_type = UNIT_TYPEID::TERRAN_SUPPLYDEPOT;
+        path_finder.SetObstacles({&depot});
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(10, 10)));
+        EXPECT_FALSE(path_finder.IsWalkable(Point2DI(2, 2)));
+        EXPECT_FALSE(path_finder.IsWalkable(Point2DI(3, 3)));
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(4, 4)));
+        EXPECT_FLOAT_EQ(path_finder.Distance(Point2D(6.5f, 10.5f), Point2D(14.5f, 10.5f)), 8.0f);
+
+        path_finder.ClearObstacles();
+        EXPECT_TRUE(path_finder.IsWalkable(Point2DI(2, 2)));
+    }
+
+    TEST(PathFinder, RepeatedSearchesAgree) {
+        std::vector<Point2DI> blocked;
+        for (int i = 0; i < 400; i += 7) {
+            blocked.push_back(Point2DI((i * 13) % 32, (i * 5) % 32));
+        }
+        PathFinder path_finder(TerrainGrids(MakeGameInfo(32, 32, blocked)));
+
+        float first = path_finder.Distance(Point2D(0.5f, 0.5f), Point2D(31.5f, 31.5f));
+        ASSERT_GT(first, 0.0f);
+        for (int i = 0; i < 10; ++i) {
+            path_finder.Distance(Point2D(31.5f, 0.5f), Point2D(0.5f, 31.5f));
+            EXPECT_EQ(path_finder.Distance(Point2D(0.5f, 0.5f), Point2D(31.5f, 31.5f)), first);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include "sc2api/sc2_proto_stats.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    using std::chrono::microseconds;
+
+    TEST(LatencyHistogram, EmptyHistogramReportsZero) {
+        LatencyHistogram histogram;
+        EXPECT_EQ(histogram.Count(), 0u);
+        EXPECT_EQ(histogram.Percentile(50.0).count(), 0);
+        EXPECT_EQ(histogram.Max().count(), 0);
+    }
+
+    TEST(LatencyHistogram, SmallValuesAreExact) {
+        LatencyHistogram histogram;
+        histogram.Record(microseconds(1));
+        histogram.Record(microseconds(2));
+        histogram.Record(microseconds(3));
+        EXPECT_EQ(histogram.Percentile(0.0).count(), 1);
+        EXPECT_EQ(histogram.Percentile(50.0).count(), 2);
+        EXPECT_EQ(histogram.Percentile(100.0).count(), 3);
+    }
+
+    TEST(LatencyHistogram, PercentilesAreWithinBucketResolution) {
+        LatencyHistogram histogram;
+        for (int i = 1; i <= 1000; ++i) {
+            histogram.Record(microseconds(i * 10));
+        }
+
+        EXPECT_EQ(histogram.Count(), 1000u);
+        EXPECT_EQ(histogram.Max().count(), 10000);
+        EXPECT_EQ(histogram.Mean().count(), 5005);
+
+        // Upper bounds, never more than a quarter above the exact value.
+        auto p50 = histogram.Percentile(50.0).count();
+        EXPECT_GE(p50, 5000);
+        EXPECT_LE(p50, 5000 * 5 / 4);
+        auto p99 = histogram.Percentile(99.0).count();
+        EXPECT_GE(p99, 9900);
+        EXPECT_LE(p99, 10000);
+    }
+
+    TEST(LatencyHistogram, ResetClearsEverything) {
+        LatencyHistogram histogram;
+        histogram.Record(microseconds(123456));
+        histogram.Reset();
+        EXPECT_EQ(histogram.Count(), 0u);
+        EXPECT_EQ(histogram.Max().count(), 0);
+    }
+
+    TEST(ProtoStats, AccumulatesPerRequestType) {
+        ProtoStats stats;
+        stats.RecordRequest(12, 10);
+        stats.RecordRequest(12, 10);
+        stats.RecordResponse(12, 100, microseconds(500), microseconds(20), microseconds(400));
+        stats.RecordResponse(12, 300, microseconds(700), microseconds(40), microseconds(600));
+
+        const RequestStats& step = stats.Get(12);
+        EXPECT_EQ(step.requests, 2u);
+        EXPECT_EQ(step.responses, 2u);
+        EXPECT_EQ(step.request_bytes, 20u);
+        EXPECT_EQ(step.response_bytes, 400u);
+        EXPECT_EQ(step.max_response_bytes, 300u);
+        EXPECT_EQ(step.latency.Max().count(), 700);
+
+        EXPECT_EQ(stats.Get(10).requests, 0u);
+        EXPECT_EQ(stats.Get(1000).requests, 0u);
+    }
+
+    TEST(ProtoStats, ExportsUsedRequestTypesAsJson) {
+        ProtoStats stats;
+        stats.RecordRequest(19, 2);
+        stats.RecordResponse(19, 8, microseconds(50), microseconds(1), microseconds(45));
+
+        std::string json = stats.ToJson();
+        EXPECT_EQ(json.front(), '{');
+        EXPECT_EQ(json.back(), '}');
+        EXPECT_NE(json.find("\"Ping\":{\"requests\":1,\"responses\":1"), std::string::npos);
+        EXPECT_NE(json.find("\"latency_us\":{\"count\":1"), std::string::npos);
+        EXPECT_EQ(json.find("Step"), std::string::npos);
+    }
+}
@@ -0,0 +1,55 @@
+#include "sc2api/sc2_protocol_recorder.h"
+
+#include <gtest/gtest.h>
+#include <cstdio>
+
+namespace sc2
+{
+    TEST(ProtocolRecorder, RoundTripsRecordsInOrder) {
+        const std::string path = "./test_protocol_trace.bin";
+        {
+            ProtocolRecorder recorder;
+            ASSERT_TRUE(recorder.Start(path));
+            EXPECT_TRUE(recorder.IsRecording());
+            recorder.Record(ProtocolDirection::Request, "ping", 4);
+            recorder.Record(ProtocolDirection::Response, "pong!", 5);
+            recorder.Record(ProtocolDirection::Request, "", 0);
+            recorder.Stop();
+            EXPECT_FALSE(recorder.IsRecording());
+            // Not recording anymore, must be ignored.
+            recorder.Record(ProtocolDirection::Request, "late", 4);
+        }
+
+        ProtocolTraceReader reader;
+        ASSERT_TRUE(reader.Open(path));
+
+        ProtocolTraceRecord record;
+        ASSERT_TRUE(reader.Next(record));
+        EXPECT_EQ(record.direction, ProtocolDirection::Request);
+        EXPECT_EQ(record.payload, "ping");
+        std::chrono::microseconds first = record.timestamp;
+
+        ASSERT_TRUE(reader.Next(record));
+        EXPECT_EQ(record.direction, ProtocolDirection::Response);
+        EXPECT_EQ(record.payload, "pong!");
+        EXPECT_GE(record.timestamp, first);
+
+        ASSERT_TRUE(reader.Next(record));
+        EXPECT_TRUE(record.payload.empty());
+
+        EXPECT_FALSE(reader.Next(record));
+        reader.Close();
+        std::remove(path.c_str());
+    }
+
+    TEST(ProtocolTraceReader, RejectsOtherFiles) {
+        const std::string path = "./test_not_a_trace.bin";
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        std::fputs("definitely not a trace", file);
+        std::fclose(file);
+
+        ProtocolTraceReader reader;
+        EXPECT_FALSE(reader.Open(path));
+        std::remove(path.c_str());
+    }
+}
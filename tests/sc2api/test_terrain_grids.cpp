@@ -0,0 +1,72 @@
+#include "sc2api/sc2_map_info.h"
+#include "map_test_utils.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    // A 1 bit per pixel image with the given cells set.
+    static ImageData MakeBitImage(int width, int height, const std::vector<Point2DI>& set) {
+        ImageData image;
+        image.width = width;
+        image.height = height;
+        image.bits_per_pixel = 1;
+        image.data.assign((width * height + 7) / 8, '\0');
+        for (const Point2DI& point : set) {
+            int index = point.x + point.y * width;
+            image.data[index / 8] = static_cast<char>(image.data[index / 8] | (1 << (7 - index % 8)));
+        }
+        return image;
+    }
+
+    TEST(TerrainGrids, MatchesTheSampledGrids) {
+        GameInfo info;
+        info.width = 37;
+        info.height = 5;
+        info.pathing_grid = MakeBitImage(37, 5, {{0, 0}, {3, 1}, {36, 4}, {20, 2}});
+        info.placement_grid = MakeByteImage(37, 5, 255);
+        info.terrain_height = MakeByteImage(37, 5, 135);
+        info.placement_grid.data[1 + 2 * 37] = 0;
+
+        TerrainGrids grids(info);
+        PathingGrid pathing(info);
+        PlacementGrid placement(info);
+        HeightMap height(info);
+        for (int y = -1; y <= 5; ++y) {
+            for (int x = -1; x <= 37; ++x) {
+                EXPECT_EQ(grids.IsPathable(Point2DI(x, y)), pathing.IsPathable(Point2DI(x, y)));
+                EXPECT_EQ(grids.IsPlacable(Point2DI(x, y)), placement.IsPlacable(Point2DI(x, y)));
+                EXPECT_EQ(grids.TerrainHeight(Point2DI(x, y)), height.TerrainHeight(Point2DI(x, y)));
+            }
+        }
+    }
+
+    TEST(TerrainGrids, RectangleTests) {
+        GameInfo info;
+        info.placement_grid = MakeByteImage(40, 40, 255);
+        info.placement_grid.data[25 + 10 * 40] = 0;
+        info.pathing_grid = MakeBitImage(40, 40, {{1, 1}, {2, 1}, {30, 1}, {39, 39}});
+        TerrainGrids grids(info);
+
+        EXPECT_TRUE(grids.IsPlacable(Rect2DI({0, 0}, {40, 10})));
+        EXPECT_FALSE(grids.IsPlacable(Rect2DI({0, 0}, {40, 11})));
+        EXPECT_FALSE(grids.IsPlacable(Rect2DI({23, 9}, {26, 12})));
+        EXPECT_TRUE(grids.IsPlacable(Rect2DI({26, 9}, {29, 12})));
+        EXPECT_FALSE(grids.IsPlacable(Rect2DI({38, 38}, {41, 41})));
+        EXPECT_EQ(grids.CountPlacable(Rect2DI({0, 0}, {40, 40})), 40 * 40 - 1);
+        EXPECT_EQ(grids.CountPlacable(Rect2DI({-5, -5}, {2, 2})), 4);
+
+        EXPECT_EQ(grids.CountPathable(Rect2DI({0, 0}, {40, 40})), 4);
+        EXPECT_EQ(grids.CountPathable(Rect2DI({2, 0}, {31, 2})), 2);
+        EXPECT_EQ(grids.CountPathable(Rect2DI({3, 0}, {30, 2})), 0);
+        EXPECT_TRUE(grids.IsPathable(Rect2DI({1, 1}, {3, 2})));
+        EXPECT_FALSE(grids.IsPathable(Rect2DI({1, 1}, {4, 2})));
+    }
+
+    TEST(TerrainGrids, EmptyWithoutGameInfo) {
+        TerrainGrids grids{GameInfo()};
+        EXPECT_FALSE(grids.IsPathable(Point2DI(0, 0)));
+        EXPECT_EQ(grids.TerrainHeight(Point2DI(0, 0)), 0.0f);
+        EXPECT_EQ(grids.CountPlacable(Rect2DI({0, 0}, {10, 10})), 0);
+    }
+}
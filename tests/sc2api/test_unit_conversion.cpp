@@ -0,0 +1,344 @@
+#include "sc2api/sc2_proto_interface.h"
+#include "sc2api/sc2_proto_to_pods.h"
+#include "sc2api/sc2_unit.h"
+#include "sc2utils/worker_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "s2clientprotocol/sc2api.pb.h"
+
+namespace sc2
+{
+    typedef std::shared_ptr<SC2APIProtocol::Response> MutableResponsePtr;
+
+    // An observation of marines that all have a move order. Odd tags belong to this player, even ones to the enemy.
+    static MutableResponsePtr MakeObservation(int units) {
+        MutableResponsePtr response = std::make_shared<SC2APIProtocol::Response>();
+        SC2APIProtocol::ObservationRaw* raw = response->mutable_observation()->mutable_observation()->mutable_raw_data();
+        for (int i = 0; i < units; ++i) {
+            SC2APIProtocol::Unit* unit = raw->add_units();
+            unit->set_display_type(SC2APIProtocol::Visible);
+            unit->set_alliance(i % 2 == 0 ? SC2APIProtocol::Self : SC2APIProtocol::Enemy);
+            unit->set_tag(i + 1);
+            unit->set_unit_type(static_cast<uint32_t>(UNIT_TYPEID::TERRAN_MARINE));
+            unit->set_owner(i % 2 == 0 ? 1 : 2);
+            unit->mutable_pos()->set_x(static_cast<float>(i % 64));
+            unit->mutable_pos()->set_y(static_cast<float>(i / 64));
+            unit->set_radius(0.375f);
+            unit->set_build_progress(1.0f);
+            unit->set_health(45.0f);
+            unit->set_health_max(45.0f);
+            SC2APIProtocol::UnitOrder* order = unit->add_orders();
+            order->set_ability_id(static_cast<uint32_t>(ABILITY_ID::MOVE_MOVE));
+            order->mutable_target_world_space_pos()->set_x(32.0f);
+            order->mutable_target_world_space_pos()->set_y(32.0f);
+        }
+        return response;
+    }
+
+    static SC2APIProtocol::Unit* RawUnit(const MutableResponsePtr& response, int index) {
+        return response->mutable_observation()->mutable_observation()->mutable_raw_data()->mutable_units(index);
+    }
+
+    // Converts the units of the observation as the client does at the start of a step.
+    static bool ConvertUnits(const MutableResponsePtr& response, UnitPool& pool, uint32_t game_loop,
+        uint32_t prev_game_loop, const UnitConversionOptions& options = {}) {
+        ObservationRawPtr observation_raw;
+        observation_raw.Set(response, &response->observation().observation().raw_data());
+        pool.ClearExisting();
+        return Convert(observation_raw, pool, game_loop, prev_game_loop, options);
+    }
+
+    static Tags ChangedTags(const UnitPool& pool) {
+        return ConvertToTags(pool.GetChangedUnits());
+    }
+
+    // A large fight at the given game loop. Units take damage, run out of orders and finish construction, a few leave
+    // vision for a while, units 950 and up die at loop 4 and new ones arrive at loop 5.
+    static MutableResponsePtr MakeBattle(uint32_t game_loop) {
+        MutableResponsePtr response = MakeObservation(1030);
+        SC2APIProtocol::ObservationRaw* raw = response->mutable_observation()->mutable_observation()->mutable_raw_data();
+        for (int i = 0; i < raw->units_size(); ++i) {
+            SC2APIProtocol::Unit* unit = raw->mutable_units(i);
+            if (i % 50 == 0) {
+                unit->set_unit_type(static_cast<uint32_t>(UNIT_TYPEID::TERRAN_BARRACKS));
+                unit->set_build_progress(std::min(1.0f, 0.25f * game_loop));
+            }
+            if (i % 4 == 0) {
+                unit->set_health(45.0f - game_loop);
+            }
+            if (game_loop >= 2 + i % 6) {
+                unit->clear_orders();
+            }
+        }
+
+        SC2APIProtocol::ObservationRaw observed;
+        for (int i = 0; i < raw->units_size(); ++i) {
+            bool hidden = i >= 100 && i < 120 && game_loop >= 3 && game_loop < 5;
+            bool dead = i >= 950 && i < 1000 && game_loop >= 4;
+            bool arrived = i < 1000 || game_loop >= 5;
+            if (!hidden && !dead && arrived) {
+                *observed.add_units() = raw->units(i);
+            }
+        }
+        raw->Swap(&observed);
+        return response;
+    }
+
+    static void ExpectSameUnit(const Unit& expected, const Unit& unit) {
+        EXPECT_EQ(unit.display_type, expected.display_type);
+        EXPECT_EQ(unit.alliance, expected.alliance);
+        EXPECT_EQ(unit.tag, expected.tag);
+        EXPECT_EQ(unit.unit_type, expected.unit_type);
+        EXPECT_EQ(unit.owner, expected.owner);
+        EXPECT_EQ(unit.pos, expected.pos);
+        EXPECT_EQ(unit.facing, expected.facing);
+        EXPECT_EQ(unit.radius, expected.radius);
+        EXPECT_EQ(unit.build_progress, expected.build_progress);
+        EXPECT_EQ(unit.cloak, expected.cloak);
+        EXPECT_EQ(unit.detect_range, expected.detect_range);
+        EXPECT_EQ(unit.radar_range, expected.radar_range);
+        EXPECT_EQ(unit.is_selected, expected.is_selected);
+        EXPECT_EQ(unit.is_on_screen, expected.is_on_screen);
+        EXPECT_EQ(unit.is_blip, expected.is_blip);
+        EXPECT_EQ(unit.health, expected.health);
+        EXPECT_EQ(unit.health_max, expected.health_max);
+        EXPECT_EQ(unit.shield, expected.shield);
+        EXPECT_EQ(unit.shield_max, expected.shield_max);
+        EXPECT_EQ(unit.energy, expected.energy);
+        EXPECT_EQ(unit.energy_max, expected.energy_max);
+        EXPECT_EQ(unit.mineral_contents, expected.mineral_contents);
+        EXPECT_EQ(unit.vespene_contents, expected.vespene_contents);
+        EXPECT_EQ(unit.is_flying, expected.is_flying);
+        EXPECT_EQ(unit.is_burrowed, expected.is_burrowed);
+        EXPECT_EQ(unit.is_hallucination, expected.is_hallucination);
+        EXPECT_EQ(unit.weapon_cooldown, expected.weapon_cooldown);
+        ASSERT_EQ(unit.orders.size(), expected.orders.size());
+        for (size_t i = 0; i < unit.orders.size(); ++i) {
+            EXPECT_EQ(unit.orders[i].ability_id, expected.orders[i].ability_id);
+            EXPECT_EQ(unit.orders[i].target_unit_tag, expected.orders[i].target_unit_tag);
+            EXPECT_EQ(unit.orders[i].target_pos, expected.orders[i].target_pos);
+            EXPECT_EQ(unit.orders[i].progress, expected.orders[i].progress);
+        }
+        EXPECT_EQ(unit.add_on_tag, expected.add_on_tag);
+        ASSERT_EQ(unit.passengers.size(), expected.passengers.size());
+        EXPECT_EQ(unit.cargo_space_taken, expected.cargo_space_taken);
+        EXPECT_EQ(unit.cargo_space_max, expected.cargo_space_max);
+        EXPECT_EQ(unit.assigned_harvesters, expected.assigned_harvesters);
+        EXPECT_EQ(unit.ideal_harvesters, expected.ideal_harvesters);
+        EXPECT_EQ(unit.engaged_target_tag, expected.engaged_target_tag);
+        EXPECT_EQ(unit.buffs, expected.buffs);
+        EXPECT_EQ(unit.is_powered, expected.is_powered);
+        EXPECT_EQ(unit.is_alive, expected.is_alive);
+        EXPECT_EQ(unit.last_seen_game_loop, expected.last_seen_game_loop);
+        EXPECT_EQ(unit.last_changed_game_loop, expected.last_changed_game_loop);
+        EXPECT_EQ(unit.is_building, expected.is_building);
+    }
+
+    static Tags SortedTags(const std::unordered_set<const Unit*>& units) {
+        Tags tags = ConvertToTags(Units(units.begin(), units.end()));
+        std::sort(tags.begin(), tags.end());
+        return tags;
+    }
+
+    static void ExpectSameEvents(const UnitPool& expected, const UnitPool& pool) {
+        EXPECT_EQ(ConvertToTags(pool.GetNewUnits()), ConvertToTags(expected.GetNewUnits()));
+        EXPECT_EQ(ConvertToTags(pool.GetUnitsEnteringVision()), ConvertToTags(expected.GetUnitsEnteringVision()));
+        EXPECT_EQ(ConvertToTags(pool.GetCompletedBuildings()), ConvertToTags(expected.GetCompletedBuildings()));
+        EXPECT_EQ(ChangedTags(pool), ChangedTags(expected));
+        ASSERT_EQ(pool.GetDamagedUnits().size(), expected.GetDamagedUnits().size());
+        for (size_t i = 0; i < pool.GetDamagedUnits().size(); ++i) {
+            EXPECT_EQ(pool.GetDamagedUnits()[i].unit->tag, expected.GetDamagedUnits()[i].unit->tag);
+            EXPECT_EQ(pool.GetDamagedUnits()[i].health, expected.GetDamagedUnits()[i].health);
+            EXPECT_EQ(pool.GetDamagedUnits()[i].shields, expected.GetDamagedUnits()[i].shields);
+        }
+        // Idle units are kept in a set, only which units went idle can be compared.
+        EXPECT_EQ(SortedTags(pool.GetIdledUnits()), SortedTags(expected.GetIdledUnits()));
+    }
+
+    TEST(UnitConversion, OnlyUnitsThatDifferAreChanged) {
+        MutableResponsePtr observation = MakeObservation(4);
+        UnitPool pool;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 1, 0));
+        EXPECT_EQ(pool.GetNewUnits().size(), 4u);
+        EXPECT_EQ(pool.GetChangedUnits().size(), 4u);
+
+        ASSERT_TRUE(ConvertUnits(observation, pool, 2, 1));
+        EXPECT_TRUE(pool.GetNewUnits().empty());
+        EXPECT_TRUE(pool.GetChangedUnits().empty());
+        EXPECT_TRUE(pool.GetDamagedUnits().empty());
+        EXPECT_TRUE(pool.GetIdledUnits().empty());
+        EXPECT_EQ(pool.GetUnit(1)->last_seen_game_loop, 2u);
+        EXPECT_EQ(pool.GetUnit(1)->last_changed_game_loop, 1u);
+    }
+
+    TEST(UnitConversion, ADamagedUnitIsTheOnlyOneChanged) {
+        MutableResponsePtr observation = MakeObservation(4);
+        UnitPool pool;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 1, 0));
+
+        RawUnit(observation, 1)->set_health(40.0f);
+        ASSERT_TRUE(ConvertUnits(observation, pool, 2, 1));
+        EXPECT_EQ(ChangedTags(pool), Tags({2}));
+        EXPECT_EQ(pool.GetUnit(2)->last_changed_game_loop, 2u);
+        for (Tag tag : {1, 3, 4}) {
+            EXPECT_EQ(pool.GetUnit(tag)->last_changed_game_loop, 1u);
+        }
+
+        ASSERT_EQ(pool.GetDamagedUnits().size(), 1u);
+        EXPECT_EQ(pool.GetDamagedUnits()[0].unit, pool.GetUnit(2));
+        EXPECT_FLOAT_EQ(pool.GetDamagedUnits()[0].health, 5.0f);
+        EXPECT_FLOAT_EQ(pool.GetDamagedUnits()[0].shields, 0.0f);
+        EXPECT_TRUE(pool.GetIdledUnits().empty());
+    }
+
+    TEST(UnitConversion, AUnitThatLosesItsOrdersIsTheOnlyOneIdled) {
+        MutableResponsePtr observation = MakeObservation(4);
+        UnitPool pool;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 1, 0));
+
+        RawUnit(observation, 2)->clear_orders();
+        ASSERT_TRUE(ConvertUnits(observation, pool, 2, 1));
+        EXPECT_EQ(ChangedTags(pool), Tags({3}));
+        EXPECT_TRUE(pool.GetUnit(3)->orders.empty());
+        EXPECT_EQ(pool.GetIdledUnits().size(), 1u);
+        EXPECT_EQ(pool.GetIdledUnits().count(pool.GetUnit(3)), 1u);
+        EXPECT_TRUE(pool.GetDamagedUnits().empty());
+    }
+
+    // Gives the first unit of the observation a value in every field a ConversionMask flag covers.
+    static void FillMaskedFields(const MutableResponsePtr& response) {
+        SC2APIProtocol::Unit* unit = RawUnit(response, 0);
+        unit->set_detect_range(11.0f);
+        unit->set_radar_range(13.0f);
+        unit->set_is_on_screen(true);
+        unit->set_attack_upgrade_level(1);
+        unit->set_armor_upgrade_level(2);
+        unit->set_shield_upgrade_level(3);
+        unit->add_buff_ids(27);
+        unit->set_cargo_space_taken(1);
+        unit->set_cargo_space_max(8);
+        SC2APIProtocol::PassengerUnit* passenger = unit->add_passengers();
+        passenger->set_tag(100);
+        passenger->set_unit_type(static_cast<uint32_t>(UNIT_TYPEID::TERRAN_SCV));
+        passenger->set_health(45.0f);
+    }
+
+    static void ExpectMaskedFieldsEmpty(const Unit& unit) {
+        EXPECT_EQ(unit.detect_range, 0.0f);
+        EXPECT_EQ(unit.radar_range, 0.0f);
+        EXPECT_FALSE(unit.is_on_screen);
+        EXPECT_EQ(unit.attack_upgrade_level, 0);
+        EXPECT_EQ(unit.armor_upgrade_level, 0);
+        EXPECT_EQ(unit.shield_upgrade_level, 0);
+        EXPECT_TRUE(unit.buffs.empty());
+        EXPECT_TRUE(unit.passengers.empty());
+        EXPECT_EQ(unit.cargo_space_taken, 0);
+        EXPECT_EQ(unit.cargo_space_max, 0);
+    }
+
+    static const uint32_t kUnitFieldMask = ConversionMask::Ranges | ConversionMask::OnScreen |
+        ConversionMask::Upgrades | ConversionMask::Buffs | ConversionMask::Passengers;
+
+    TEST(UnitConversion, MaskedOutFieldsStayEmpty) {
+        MutableResponsePtr observation = MakeObservation(2);
+        FillMaskedFields(observation);
+        UnitConversionOptions options;
+        options.mask = ConversionMask::All & ~kUnitFieldMask;
+        UnitPool pool;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 1, 0, options));
+        ExpectMaskedFieldsEmpty(*pool.GetUnit(1));
+
+        // The rest of the unit is still converted and kept up to date.
+        RawUnit(observation, 0)->set_health(30.0f);
+        RawUnit(observation, 0)->mutable_pos()->set_x(5.0f);
+        ASSERT_TRUE(ConvertUnits(observation, pool, 2, 1, options));
+        const Unit* unit = pool.GetUnit(1);
+        ExpectMaskedFieldsEmpty(*unit);
+        EXPECT_EQ(unit->health, 30.0f);
+        EXPECT_EQ(unit->pos.x, 5.0f);
+        EXPECT_EQ(unit->orders.size(), 1u);
+        EXPECT_EQ(ChangedTags(pool), Tags({1}));
+    }
+
+    TEST(UnitConversion, UnmaskedFieldsAreConverted) {
+        MutableResponsePtr observation = MakeObservation(2);
+        FillMaskedFields(observation);
+        UnitPool pool;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 1, 0));
+        const Unit* unit = pool.GetUnit(1);
+        EXPECT_EQ(unit->detect_range, 11.0f);
+        EXPECT_EQ(unit->radar_range, 13.0f);
+        EXPECT_TRUE(unit->is_on_screen);
+        EXPECT_EQ(unit->attack_upgrade_level, 1);
+        EXPECT_EQ(unit->armor_upgrade_level, 2);
+        EXPECT_EQ(unit->shield_upgrade_level, 3);
+        ASSERT_EQ(unit->buffs.size(), 1u);
+        EXPECT_EQ(unit->buffs[0], BuffID(27));
+        ASSERT_EQ(unit->passengers.size(), 1u);
+        EXPECT_EQ(unit->passengers[0].tag, 100u);
+        EXPECT_EQ(unit->cargo_space_taken, 1);
+        EXPECT_EQ(unit->cargo_space_max, 8);
+
+        // Masking a part out later empties it instead of leaving the last values behind.
+        UnitConversionOptions options;
+        options.mask = ConversionMask::All & ~ConversionMask::Buffs;
+        ASSERT_TRUE(ConvertUnits(observation, pool, 2, 1, options));
+        EXPECT_TRUE(unit->buffs.empty());
+        EXPECT_EQ(unit->passengers.size(), 1u);
+        EXPECT_EQ(unit->detect_range, 11.0f);
+        EXPECT_EQ(ChangedTags(pool), Tags({1}));
+    }
+
+    TEST(UnitConversion, ParallelConversionMatchesTheSequentialOne) {
+        WorkerPool workers(4);
+        UnitConversionOptions parallel;
+        parallel.workers = &workers;
+        parallel.units_per_task = 64;
+        UnitPool sequential_pool;
+        UnitPool parallel_pool;
+        size_t entered_vision = 0;
+        size_t completed = 0;
+        size_t damaged = 0;
+        size_t idled = 0;
+
+        for (uint32_t game_loop = 1; game_loop <= 8; ++game_loop) {
+            SCOPED_TRACE(game_loop);
+            MutableResponsePtr battle = MakeBattle(game_loop);
+            ASSERT_TRUE(ConvertUnits(battle, sequential_pool, game_loop, game_loop - 1));
+            ASSERT_TRUE(ConvertUnits(battle, parallel_pool, game_loop, game_loop - 1, parallel));
+            ExpectSameEvents(sequential_pool, parallel_pool);
+            entered_vision += sequential_pool.GetUnitsEnteringVision().size();
+            completed += sequential_pool.GetCompletedBuildings().size();
+            damaged += sequential_pool.GetDamagedUnits().size();
+            idled += sequential_pool.GetIdledUnits().size();
+
+            // The client marks the units of the dead unit event after converting, as the destroyed events go out.
+            if (game_loop == 4) {
+                for (Tag tag = 951; tag <= 1000; ++tag) {
+                    sequential_pool.MarkDead(tag);
+                    parallel_pool.MarkDead(tag);
+                }
+            }
+
+            for (Tag tag = 1; tag <= 1030; ++tag) {
+                const Unit* expected = sequential_pool.GetUnit(tag);
+                const Unit* unit = parallel_pool.GetUnit(tag);
+                ASSERT_EQ(unit == nullptr, expected == nullptr);
+                if (unit) {
+                    ExpectSameUnit(*expected, *unit);
+                }
+            }
+        }
+
+        // Every kind of event came up along the way.
+        EXPECT_GT(entered_vision, 0u);
+        EXPECT_GT(completed, 0u);
+        EXPECT_GT(damaged, 0u);
+        EXPECT_GT(idled, 0u);
+        EXPECT_FALSE(parallel_pool.GetUnit(951)->is_alive);
+    }
+}
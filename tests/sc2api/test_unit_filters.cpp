@@ -0,0 +1,44 @@
+#include "sc2api/sc2_unit_filters.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    static Unit MakeUnit(UNIT_TYPEID type) {
+        Unit unit;
+        unit.unit_type = type;
+        return unit;
+    }
+
+    TEST(UnitFilters, CategoriesFollowTheUnitType) {
+        EXPECT_TRUE(IsBuilding()(UNIT_TYPEID::TERRAN_BARRACKS));
+        EXPECT_TRUE(IsBuilding()(UNIT_TYPEID::ZERG_HATCHERY));
+        EXPECT_FALSE(IsBuilding()(UNIT_TYPEID::TERRAN_MARINE));
+
+        EXPECT_TRUE(IsTownHall()(UNIT_TYPEID::ZERG_HIVE));
+        EXPECT_FALSE(IsTownHall()(UNIT_TYPEID::ZERG_SPIRE));
+
+        EXPECT_TRUE(IsMineralPatch()(UNIT_TYPEID::NEUTRAL_RICHMINERALFIELD750));
+        EXPECT_FALSE(IsMineralPatch()(UNIT_TYPEID::NEUTRAL_VESPENEGEYSER));
+        EXPECT_TRUE(IsGeyser()(UNIT_TYPEID::NEUTRAL_VESPENEGEYSER));
+
+        EXPECT_TRUE(IsWorker()(MakeUnit(UNIT_TYPEID::PROTOSS_PROBE)));
+        EXPECT_FALSE(IsWorker()(MakeUnit(UNIT_TYPEID::PROTOSS_ZEALOT)));
+    }
+
+    TEST(UnitFilters, UnknownTypesHaveNoCategory) {
+        UNIT_TYPEID unknown = static_cast<UNIT_TYPEID>(100000);
+        EXPECT_FALSE(IsBuilding()(unknown));
+        EXPECT_FALSE(IsWorker()(unknown));
+        EXPECT_FALSE(IsBuilding()(UNIT_TYPEID::INVALID));
+    }
+
+    TEST(UnitFilters, IsUnitsMatchesAnyOfTheTypes) {
+        IsUnits filter({UNIT_TYPEID::TERRAN_MARINE, UNIT_TYPEID::TERRAN_SCV});
+        EXPECT_TRUE(filter(MakeUnit(UNIT_TYPEID::TERRAN_SCV)));
+        EXPECT_TRUE(filter(MakeUnit(UNIT_TYPEID::TERRAN_MARINE)));
+        EXPECT_FALSE(filter(MakeUnit(UNIT_TYPEID::TERRAN_MARAUDER)));
+        EXPECT_FALSE(filter(MakeUnit(static_cast<UNIT_TYPEID>(100000))));
+        EXPECT_FALSE(IsUnits({})(MakeUnit(UNIT_TYPEID::TERRAN_SCV)));
+    }
+}
@@ -0,0 +1,125 @@
+#include "sc2api/sc2_unit.h"
+
+#include <gtest/gtest.h>
+
+namespace sc2
+{
+    static Unit* SeeUnit(UnitPool& pool, Tag tag, uint32_t game_loop) {
+        Unit* unit = pool.CreateUnit(tag);
+        unit->tag = tag;
+        unit->is_alive = true;
+        unit->last_seen_game_loop = game_loop;
+        return unit;
+    }
+
+    TEST(UnitPool, DeadUnitsAreKeptByDefault) {
+        UnitPool pool;
+        Unit* unit = SeeUnit(pool, 1, 10);
+        pool.MarkDead(1);
+        pool.RecycleDeadUnits(100000);
+
+        EXPECT_EQ(pool.GetUnit(1), unit);
+        EXPECT_FALSE(unit->is_alive);
+        EXPECT_EQ(pool.GetStats().free, 0u);
+    }
+
+    TEST(UnitPool, DeadUnitsAreRecycledAfterTheDelay) {
+        UnitPool pool;
+        pool.SetRecycleDelay(20);
+        Unit* dead = SeeUnit(pool, 1, 10);
+        pool.MarkDead(1);
+
+        pool.RecycleDeadUnits(29);
+        EXPECT_EQ(pool.GetUnit(1), dead);
+
+        pool.RecycleDeadUnits(30);
+        EXPECT_EQ(pool.GetUnit(1), nullptr);
+        EXPECT_EQ(pool.GetStats().free, 1u);
+
+        Unit* reused = SeeUnit(pool, 2, 30);
+        EXPECT_EQ(reused, dead);
+        EXPECT_EQ(pool.GetUnit(2), reused);
+        EXPECT_EQ(pool.GetStats().free, 0u);
+        EXPECT_EQ(pool.GetStats().recycled, 1u);
+    }
+
+    TEST(UnitPool, UnitsSeenAgainAreNotRecycled) {
+        UnitPool pool;
+        pool.SetRecycleDelay(5);
+        Unit* unit = SeeUnit(pool, 1, 10);
+        pool.MarkDead(1);
+        unit->last_seen_game_loop = 14;
+
+        pool.RecycleDeadUnits(16);
+        EXPECT_EQ(pool.GetUnit(1), unit);
+        pool.RecycleDeadUnits(19);
+        EXPECT_EQ(pool.GetUnit(1), unit);
+    }
+
+    TEST(UnitPool, RecycledUnitsGetANewGeneration) {
+        UnitPool pool;
+        pool.SetRecycleDelay(0);
+        Unit* dead = SeeUnit(pool, 1, 10);
+        uint32_t generation = dead->generation;
+        pool.MarkDead(1);
+        pool.RecycleDeadUnits(10);
+
+        Unit* reused = SeeUnit(pool, 2, 10);
+        ASSERT_EQ(reused, dead);
+        EXPECT_NE(reused->generation, generation);
+        EXPECT_EQ(pool.GetUnit(2, reused->generation), reused);
+        EXPECT_EQ(pool.GetUnit(2, generation), nullptr);
+    }
+
+    TEST(UnitPool, VanishedUnitsAreRecycledAfterTheDelay) {
+        UnitPool pool;
+        pool.SetRecycleDelay(20);
+        Unit* vanished = SeeUnit(pool, 1, 10);
+        Unit* seen = SeeUnit(pool, 2, 10);
+
+        // Only unit 2 is in the next observations, unit 1 leaves without a death event.
+        pool.ClearExisting();
+        SeeUnit(pool, 2, 20);
+        pool.RecycleDeadUnits(29);
+        EXPECT_EQ(pool.GetUnit(1), vanished);
+
+        pool.ClearExisting();
+        SeeUnit(pool, 2, 30);
+        pool.RecycleDeadUnits(30);
+        EXPECT_EQ(pool.GetUnit(1), nullptr);
+        EXPECT_EQ(pool.GetUnit(2), seen);
+        EXPECT_EQ(pool.GetStats().free, 1u);
+    }
+
+    TEST(UnitPool, NewGameFreesEveryUnit) {
+        UnitPool pool;
+        pool.SetRecycleDelay(100);
+        pool.RecycleDeadUnits(500);
+        SeeUnit(pool, 1, 500);
+        SeeUnit(pool, 2, 500);
+
+        pool.RecycleDeadUnits(1);
+        EXPECT_EQ(pool.GetUnit(1), nullptr);
+        EXPECT_EQ(pool.GetUnit(2), nullptr);
+        EXPECT_EQ(pool.GetStats().free, 2u);
+        EXPECT_EQ(pool.GetStats().in_use, 0u);
+    }
+
+    TEST(UnitPool, HighWaterMarkTracksPeakUsage) {
+        UnitPool pool;
+        pool.SetRecycleDelay(0);
+        for (Tag tag = 1; tag <= 3; ++tag) {
+            SeeUnit(pool, tag, 1);
+        }
+        pool.MarkDead(1);
+        pool.MarkDead(2);
+        pool.RecycleDeadUnits(2);
+        SeeUnit(pool, 4, 2);
+
+        UnitPoolStats stats = pool.GetStats();
+        EXPECT_EQ(stats.in_use, 2u);
+        EXPECT_EQ(stats.free, 1u);
+        EXPECT_EQ(stats.high_water_mark, 3u);
+        EXPECT_GE(stats.capacity, 3u);
+    }
+}
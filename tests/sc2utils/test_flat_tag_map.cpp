@@ -0,0 +1,100 @@
+#include "sc2utils/flat_tag_map.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+
+namespace sc2
+{
+    TEST(FlatTagMap, InsertFindAndReplace) {
+        FlatTagMap<int> map;
+        EXPECT_TRUE(map.Empty());
+        EXPECT_EQ(map.Find(1), nullptr);
+
+        EXPECT_TRUE(map.Insert(1, 10));
+        EXPECT_TRUE(map.Insert(2, 20));
+        EXPECT_FALSE(map.Insert(1, 11));
+        EXPECT_EQ(map.Size(), 2u);
+
+        ASSERT_NE(map.Find(1), nullptr);
+        EXPECT_EQ(*map.Find(1), 11);
+        EXPECT_EQ(*map.Find(2), 20);
+        EXPECT_FALSE(map.Contains(3));
+        EXPECT_FALSE(map.Contains(0));
+
+        // The null tag marks empty slots and is never stored.
+        EXPECT_FALSE(map.Insert(0, 30));
+        EXPECT_FALSE(map.Contains(0));
+        EXPECT_EQ(map.Size(), 2u);
+    }
+
+    TEST(FlatTagMap, ClearKeepsCapacity) {
+        FlatTagMap<int> map;
+        for (uint64_t tag = 1; tag <= 1000; ++tag) {
+            map.Insert(tag, static_cast<int>(tag));
+        }
+        std::size_t capacity = map.Capacity();
+        EXPECT_GE(capacity, 1000u);
+
+        map.Clear();
+        EXPECT_TRUE(map.Empty());
+        EXPECT_EQ(map.Capacity(), capacity);
+        EXPECT_FALSE(map.Contains(500));
+
+        for (uint64_t tag = 1; tag <= 1000; ++tag) {
+            map.Insert(tag + 5000, 0);
+        }
+        EXPECT_EQ(map.Capacity(), capacity);
+    }
+
+    TEST(FlatTagMap, IteratesOverEveryEntry) {
+        FlatTagMap<int> map;
+        uint64_t key_sum = 0;
+        for (uint64_t tag = 1; tag <= 100; ++tag) {
+            map.Insert(tag << 32, 1);
+            key_sum += tag << 32;
+        }
+
+        uint64_t seen_sum = 0;
+        int count = 0;
+        for (const auto& slot : map) {
+            seen_sum += slot.key;
+            count += slot.value;
+        }
+        EXPECT_EQ(count, 100);
+        EXPECT_EQ(seen_sum, key_sum);
+    }
+
+    TEST(FlatTagMap, MatchesUnorderedMapUnderRandomOperations) {
+        FlatTagMap<uint64_t> map;
+        std::unordered_map<uint64_t, uint64_t> reference;
+        std::mt19937_64 random(7);
+
+        for (int i = 0; i < 200000; ++i) {
+            // A small key range so erases hit often and probe runs wrap around the table.
+            uint64_t key = random() % 512 + 1;
+            switch (random() % 3) {
+                case 0:
+                    EXPECT_EQ(map.Insert(key, i), reference.insert_or_assign(key, i).second);
+                    break;
+                case 1:
+                    EXPECT_EQ(map.Erase(key), reference.erase(key) == 1);
+                    break;
+                default: {
+                    auto found = reference.find(key);
+                    const uint64_t* value = map.Find(key);
+                    ASSERT_EQ(value != nullptr, found != reference.end());
+                    if (value) {
+                        EXPECT_EQ(*value, found->second);
+                    }
+                    break;
+                }
+            }
+        }
+        EXPECT_EQ(map.Size(), reference.size());
+        for (const auto& entry : reference) {
+            ASSERT_NE(map.Find(entry.first), nullptr);
+            EXPECT_EQ(*map.Find(entry.first), entry.second);
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#include "sc2utils/small_vector.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+namespace sc2
+{
+    TEST(SmallVector, StaysInlineUpToItsInlineCapacity) {
+        SmallVector<int, 4> values;
+        EXPECT_TRUE(values.empty());
+        EXPECT_EQ(values.capacity(), 4u);
+
+        for (int i = 0; i < 4; ++i) {
+            values.push_back(i);
+        }
+        EXPECT_TRUE(values.is_inline());
+        EXPECT_EQ(values.size(), 4u);
+        EXPECT_EQ(values.front(), 0);
+        EXPECT_EQ(values.back(), 3);
+    }
+
+    TEST(SmallVector, SpillsToTheHeapAndKeepsCapacityOnClear) {
+        SmallVector<int, 2> values;
+        for (int i = 0; i < 5; ++i) {
+            values.push_back(i);
+        }
+        EXPECT_FALSE(values.is_inline());
+        for (int i = 0; i < 5; ++i) {
+            EXPECT_EQ(values[i], i);
+        }
+
+        std::size_t capacity = values.capacity();
+        values.clear();
+        EXPECT_TRUE(values.empty());
+        EXPECT_EQ(values.capacity(), capacity);
+        EXPECT_THROW(values.at(0), std::out_of_range);
+    }
+
+    TEST(SmallVector, PushingAnElementOfItselfWhileFull) {
+        SmallVector<std::string, 2> values = {"a", "b"};
+        values.push_back(values[0]);
+        ASSERT_EQ(values.size(), 3u);
+        EXPECT_EQ(values[2], "a");
+    }
+
+    TEST(SmallVector, CopiesAndMoves) {
+        SmallVector<std::string, 2> small = {"a"};
+        SmallVector<std::string, 2> large = {"a", "b", "c"};
+
+        SmallVector<std::string, 2> small_copy(small);
+        SmallVector<std::string, 2> large_copy(large);
+        EXPECT_EQ(small_copy, small);
+        EXPECT_EQ(large_copy, large);
+
+        const std::string* heap = large.data();
+        SmallVector<std::string, 2> large_moved(std::move(large));
+        EXPECT_EQ(large_moved.data(), heap);
+        EXPECT_TRUE(large.empty());
+        EXPECT_TRUE(large.is_inline());
+
+        SmallVector<std::string, 2> small_moved;
+        small_moved = std::move(small);
+        EXPECT_EQ(small_moved, small_copy);
+        EXPECT_TRUE(small.empty());
+
+        small_moved = large_copy;
+        EXPECT_EQ(small_moved, large_copy);
+    }
+
+    TEST(SmallVector, DestroysEveryElement) {
+        auto counter = std::make_shared<int>(0);
+        {
+            SmallVector<std::shared_ptr<int>, 2> values;
+            for (int i = 0; i < 5; ++i) {
+                values.push_back(counter);
+            }
+            EXPECT_EQ(counter.use_count(), 6);
+            values.pop_back();
+            values.erase(values.begin());
+            EXPECT_EQ(counter.use_count(), 4);
+        }
+        EXPECT_EQ(counter.use_count(), 1);
+    }
+
+    TEST(SmallVector, ResizeAndErase) {
+        SmallVector<int, 4> values;
+        values.resize(6, 7);
+        EXPECT_EQ(values.size(), 6u);
+        EXPECT_EQ(values[5], 7);
+
+        values.resize(3);
+        EXPECT_EQ(values.size(), 3u);
+
+        values = {1, 2, 3, 4};
+        values.erase(values.begin() + 1, values.begin() + 3);
+        EXPECT_EQ(values, (SmallVector<int, 4>{1, 4}));
+    }
+}
@@ -0,0 +1,105 @@
+#include "sc2utils/spsc_queue.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace sc2
+{
+    TEST(SpscQueue, RoundsCapacityUpToPowerOfTwo) {
+        SpscQueue<int> queue(100);
+        EXPECT_EQ(queue.Capacity(), 128u);
+        EXPECT_TRUE(queue.Empty());
+    }
+
+    TEST(SpscQueue, PopsInPushOrder) {
+        SpscQueue<int> queue(4);
+        std::atomic_bool stop(false);
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_TRUE(queue.Push(i, stop));
+        }
+        EXPECT_EQ(queue.Size(), 3u);
+
+        for (int i = 0; i < 3; ++i) {
+            std::optional<int> value = queue.TryPop();
+            ASSERT_TRUE(value.has_value());
+            EXPECT_EQ(*value, i);
+        }
+        EXPECT_FALSE(queue.TryPop().has_value());
+    }
+
+    TEST(SpscQueue, RejectsPushWhenFull) {
+        SpscQueue<int> queue(2);
+        int value = 1;
+        EXPECT_TRUE(queue.TryPush(value));
+        EXPECT_TRUE(queue.TryPush(value));
+        EXPECT_FALSE(queue.TryPush(value));
+
+        queue.TryPop();
+        EXPECT_TRUE(queue.TryPush(value));
+    }
+
+    TEST(SpscQueue, StopReleasesBlockedProducer) {
+        SpscQueue<int> queue(2);
+        std::atomic_bool stop(false);
+        EXPECT_TRUE(queue.Push(1, stop));
+        EXPECT_TRUE(queue.Push(2, stop));
+
+        bool pushed = true;
+        std::thread producer([&queue, &stop, &pushed] {
+            pushed = queue.Push(3, stop);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stop = true;
+        producer.join();
+
+        // The element that didn't fit is dropped, the queued ones are untouched.
+        EXPECT_FALSE(pushed);
+        EXPECT_EQ(queue.Size(), 2u);
+        EXPECT_EQ(*queue.TryPop(), 1);
+        EXPECT_EQ(*queue.TryPop(), 2);
+    }
+
+    TEST(SpscQueue, PopTimesOutWhenEmpty) {
+        SpscQueue<int> queue;
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(queue.Pop(std::chrono::milliseconds(20)).has_value());
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+    }
+
+    TEST(SpscQueue, WakesBlockedConsumer) {
+        SpscQueue<int> queue;
+        std::atomic_bool stop(false);
+        std::thread producer([&queue, &stop] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            queue.Push(42, stop);
+        });
+
+        std::optional<int> value = queue.Pop(std::chrono::seconds(10));
+        producer.join();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(*value, 42);
+    }
+
+    TEST(SpscQueue, TransfersEverythingAcrossThreads) {
+        const int count = 200000;
+        SpscQueue<int> queue(16);
+        std::atomic_bool stop(false);
+        std::thread producer([&queue, &stop] {
+            for (int i = 0; i < count; ++i) {
+                queue.Push(i, stop);
+            }
+        });
+
+        int expected = 0;
+        while (expected < count) {
+            std::optional<int> value = queue.Pop(std::chrono::seconds(10));
+            ASSERT_TRUE(value.has_value());
+            ASSERT_EQ(*value, expected);
+            ++expected;
+        }
+        producer.join();
+        EXPECT_TRUE(queue.Empty());
+    }
+}
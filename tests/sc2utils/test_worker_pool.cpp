@@ -0,0 +1,46 @@
+#include "sc2utils/worker_pool.h"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+
+namespace sc2
+{
+    TEST(WorkerPool, RunsEveryIndexExactlyOnce) {
+        WorkerPool pool(4);
+        EXPECT_EQ(pool.Threads(), 4u);
+
+        std::vector<std::atomic<int>> visits(1000);
+        for (int round = 0; round < 50; ++round) {
+            pool.ParallelFor(visits.size(), 7, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    ++visits[i];
+                }
+            });
+        }
+
+        for (const auto& count : visits) {
+            EXPECT_EQ(count.load(), 50);
+        }
+    }
+
+    TEST(WorkerPool, SingleThreadRunsOnTheCaller) {
+        WorkerPool pool(1);
+        std::thread::id caller = std::this_thread::get_id();
+        int calls = 0;
+        pool.ParallelFor(100, 10, [&](std::size_t begin, std::size_t end) {
+            EXPECT_EQ(std::this_thread::get_id(), caller);
+            EXPECT_EQ(begin, 0u);
+            EXPECT_EQ(end, 100u);
+            ++calls;
+        });
+        EXPECT_EQ(calls, 1);
+    }
+
+    TEST(WorkerPool, EmptyLoopDoesNothing) {
+        WorkerPool pool(2);
+        bool called = false;
+        pool.ParallelFor(0, 10, [&](std::size_t, std::size_t) { called = true; });
+        EXPECT_FALSE(called);
+    }
+}